@@ -48,7 +48,7 @@ typedef struct mtexinfo_s {  // used internally due to name len probs //ZOID
 #if REF_VKPT
 	struct pbr_material_s *material;
 #endif
-#if REF_GL
+#if REF_GL || REF_SOFT
 	struct image_s      *image; // used for texturing
 #endif
     int                 numframes;
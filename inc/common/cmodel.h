@@ -59,6 +59,20 @@ int         CM_TransformedPointContents(vec3_t p, mnode_t *headnode,
 void        CM_BoxTrace(trace_t *trace, vec3_t start, vec3_t end,
                         vec3_t mins, vec3_t maxs,
                         mnode_t *headnode, int brushmask);
+
+// a single trace of a CM_BoxTraceBatch
+typedef struct {
+    vec3_t      start, end;
+    vec3_t      mins, maxs;
+    int         brushmask;
+    trace_t     trace;          // result
+} cmtrace_t;
+
+// runs traces against a model of the given map on up to numthreads
+// threads (0 = one per CPU), with the same results as CM_BoxTrace
+void        CM_BoxTraceBatch(cm_t *cm, cmtrace_t *traces, int count,
+                             mnode_t *headnode, int numthreads);
+
 void        CM_TransformedBoxTrace(trace_t *trace, vec3_t start, vec3_t end,
                                    vec3_t mins, vec3_t maxs,
                                    mnode_t * headnode, int brushmask,
@@ -0,0 +1,43 @@
+/*
+Copyright (C) 2003-2008 Andrey Nazarov
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#ifndef DEMOINDEX_H
+#define DEMOINDEX_H
+
+#include "common/zone.h"
+
+//
+// seek snapshots of client and MVD demos, optionally stored next to the
+// demo in a sidecar index file
+//
+
+typedef struct {
+    list_t entry;
+    int framenum;
+    off_t filepos;
+    size_t msglen;
+    byte data[1];
+} demosnap_t;
+
+size_t DEMO_FreeSnapshots(list_t *snapshots);
+int DEMO_LoadIndex(const char *name, list_t *snapshots, memtag_t tag,
+                   size_t filesize, size_t fileoffset);
+int DEMO_WriteIndex(const char *name, list_t *snapshots,
+                    size_t filesize, size_t fileoffset);
+
+#endif // DEMOINDEX_H
@@ -0,0 +1,40 @@
+/*
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#ifndef BCN_H
+#define BCN_H
+
+//
+// bcn.h -- block compressed texture encoding and decoding
+//
+
+typedef enum {
+    BCN_BC1,    // RGB, 8 bytes per 4x4 block
+    BCN_BC3,    // RGBA, 16 bytes per 4x4 block
+    BCN_BC5,    // two channel (normal map XY), 16 bytes per 4x4 block
+    BCN_MAX
+} bcnformat_t;
+
+size_t  BCN_ImageSize(bcnformat_t fmt, int width, int height);
+
+// input and output are tightly packed RGBA8. edge blocks are padded by
+// clamping, so any width and height are valid.
+void    BCN_Compress(bcnformat_t fmt, byte *out, const byte *rgba, int width, int height);
+
+// BC5 blue is reconstructed as sqrt(1 - x^2 - y^2), alpha is set to 255
+void    BCN_Decompress(bcnformat_t fmt, byte *rgba, const byte *in, int width, int height);
+
+#endif // BCN_H
@@ -77,12 +77,16 @@ typedef struct image_s {
 	char            filepath[MAX_QPATH]; // actual path loaded, with correct format extension
 	int             is_srgb;
 	uint64_t        last_modified;
+    unsigned        decode_time; // microseconds, shown by imagelist
 #if REF_GL
     unsigned        texnum; // gl texture binding
     float           sl, sh, tl, th;
 #endif
 #if REF_VKPT
     byte            *pix_data; // todo: add miplevels
+    byte            *pix_bcn; // cooked block compressed mips, uploaded instead of pix_data
+    size_t          pix_bcn_size;
+    int             pix_bcn_format;
     vec3_t          light_color; // use this color if this is a light source
 	vec2_t          min_light_texcoord;
 	vec2_t          max_light_texcoord;
@@ -103,10 +107,20 @@ extern int registration_sequence;
 #define R_NOTEXTURE &r_images[0]
 
 extern uint32_t d_8to24table[256];
+extern float srgb_to_linear[256];
 
 // these are implemented in src/refresh/images.c
 void IMG_ReloadAll();
 image_t *IMG_Find(const char *name, imagetype_t type, imageflags_t flags);
+
+typedef struct {
+    const char      *name;
+    imagetype_t     type;
+    imageflags_t    flags;
+} imagereq_t;
+
+// like IMG_Find for each request, decoding in parallel
+void IMG_FindBatch(const imagereq_t *reqs, image_t **images, int count);
 void IMG_FreeUnused(void);
 void IMG_FreeAll(void);
 void IMG_Init(void);
@@ -0,0 +1,36 @@
+/*
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#ifndef LERP_H
+#define LERP_H
+
+//
+// lerp.h -- alias model frame interpolation for the CPU renderers
+//
+// Computes move + oldv * backv + newv * frontv for every vertex. Each output
+// vertex is four floats (the last one zero) and consecutive vertices are
+// outstride floats apart, so outstride must be at least 4.
+//
+
+// vertices are 8 bytes apart and start with three int16_t coordinates
+void    R_LerpVerts16(float *out, int outstride, const void *oldv, const void *newv,
+                      int count, const vec3_t backv, const vec3_t frontv, const vec3_t move);
+
+// vertices are 4 bytes apart and start with three uint8_t coordinates
+void    R_LerpVerts8(float *out, int outstride, const void *oldv, const void *newv,
+                     int count, const vec3_t backv, const vec3_t frontv, const vec3_t move);
+
+#endif // LERP_H
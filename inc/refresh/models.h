@@ -62,10 +62,10 @@ typedef struct model_s {
     // alias models
     int numframes;
     struct maliasframe_s *frames;
+	model_class_t model_class;
 #if USE_REF == REF_GL || USE_REF == REF_VKPT
     int nummeshes;
     struct maliasmesh_s *meshes;
-	model_class_t model_class;
 #else
     int numskins;
     struct image_s *skins[MAX_ALIAS_SKINS];
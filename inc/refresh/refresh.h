@@ -287,5 +287,8 @@ void R_RegisterFunctionsGL();
 #if REF_VKPT
 void R_RegisterFunctionsRTX();
 #endif
+#if REF_SOFT
+void R_RegisterFunctionsSW(void);
+#endif
 
 #endif // REFRESH_H
@@ -60,6 +60,11 @@
 #define USE_WINSVC !USE_CLIENT
 #endif
 
+// SSE2 is baseline on x86_64 and enabled explicitly on x86
+#if (defined __SSE2__) || (defined _M_X64) || (defined _M_IX86_FP && _M_IX86_FP >= 2)
+#define USE_SSE2 1
+#endif
+
 #define _USE_MATH_DEFINES
 #define inline __inline
 #define __func__ __FUNCTION__
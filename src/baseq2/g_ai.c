@@ -263,23 +263,111 @@ int range(edict_t *self, edict_t *other)
 visible
 
 returns 1 if the entity is visible to self, even if not infront ()
+
+Results are remembered for the rest of the frame as long as neither
+entity moves, since a monster usually checks the same target several
+times per think (FindTarget, ai_checkattack, attack code).
+=============
+*/
+#define SIGHT_CACHE_SIZE    256
+
+typedef struct {
+    int         framenum;
+    edict_t     *self;
+    edict_t     *other;
+    vec3_t      spot1;
+    vec3_t      spot2;
+    qboolean    result;
+} sightcache_t;
+
+static sightcache_t sightcache[SIGHT_CACHE_SIZE];
+
+// sight trace counters, for the current and the previous frame
+typedef struct {
+    int     framenum;
+    int     traces;
+    int     avoided;
+} sightstats_t;
+
+static sightstats_t sightstats, sightstats_last;
+
+static sightstats_t *AI_SightStats(void)
+{
+    if (sightstats.framenum != level.framenum) {
+        if (sightstats.framenum == level.framenum - 1)
+            sightstats_last = sightstats;
+        else
+            memset(&sightstats_last, 0, sizeof(sightstats_last));
+        memset(&sightstats, 0, sizeof(sightstats));
+        sightstats.framenum = level.framenum;
+    }
+    return &sightstats;
+}
+
+/*
+=============
+AI_SightAvoided
+
+Called when a sight trace was not needed
 =============
 */
+static void AI_SightAvoided(void)
+{
+    AI_SightStats()->avoided++;
+}
+
+/*
+=============
+Svcmd_SightStats_f
+
+Prints sight trace counters for the last complete frame
+=============
+*/
+void Svcmd_SightStats_f(void)
+{
+    AI_SightStats();
+    gi.cprintf(NULL, PRINT_HIGH, "frame %d: %d sight traces, %d avoided\n",
+               sightstats_last.framenum, sightstats_last.traces, sightstats_last.avoided);
+}
+
 qboolean visible(edict_t *self, edict_t *other)
 {
     vec3_t  spot1;
     vec3_t  spot2;
     trace_t trace;
+    sightcache_t *c;
 
     VectorCopy(self->s.origin, spot1);
     spot1[2] += self->viewheight;
     VectorCopy(other->s.origin, spot2);
     spot2[2] += other->viewheight;
+
+    c = &sightcache[((self - g_edicts) * 31 + (other - g_edicts)) & (SIGHT_CACHE_SIZE - 1)];
+    if (c->framenum == level.framenum && c->self == self && c->other == other &&
+        VectorCompare(c->spot1, spot1) && VectorCompare(c->spot2, spot2)) {
+        AI_SightAvoided();
+        return c->result;
+    }
+
+    c->framenum = level.framenum;
+    c->self = self;
+    c->other = other;
+    VectorCopy(spot1, c->spot1);
+    VectorCopy(spot2, c->spot2);
+
+    // nothing outside of the PVS can be seen, and the PVS test is much
+    // cheaper than a trace through the world
+    if (!gi.inPVS(spot1, spot2)) {
+        AI_SightAvoided();
+        c->result = qfalse;
+        return qfalse;
+    }
+
+    AI_SightStats()->traces++;
     trace = gi.trace(spot1, vec3_origin, vec3_origin, spot2, self, MASK_OPAQUE);
 
-    if (trace.fraction == 1.0)
-        return qtrue;
-    return qfalse;
+    c->result = (trace.fraction == 1.0);
+    return c->result;
 }
 
 
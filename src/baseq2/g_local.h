@@ -697,6 +697,7 @@ void func_clock_use(edict_t *self, edict_t *other, edict_t *activator);
 // g_ai.c
 //
 void AI_SetSightClient(void);
+void Svcmd_SightStats_f(void);
 
 void ai_stand(edict_t *self, float dist);
 void ai_move(edict_t *self, float dist);
@@ -26,6 +26,7 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include "common/cmodel.h"
 #include "common/common.h"
 #include "common/cvar.h"
+#include "common/demoindex.h"
 #include "common/field.h"
 #include "common/files.h"
 #include "common/pmove.h"
@@ -371,6 +372,23 @@ typedef struct {
     char        path[1];
 } dlqueue_t;
 
+// client subsystems timed during timedemo
+typedef enum {
+    TD_PARSE,           // CL_ParseServerMessage, including delta frame
+    TD_DELTAFRAME,      // CL_DeltaFrame
+    TD_ENTITIES,        // CL_AddEntities, including effects
+    TD_EFFECTS,         // temp entities, particles and lights
+    TD_REFRESH,         // SCR_UpdateScreen, including entities
+    TD_SOUND,           // S_Update
+
+    TD_NUM_SECTIONS
+} tdsection_t;
+
+#define CL_TIMEDEMO_BEGIN(start) \
+    ((start) = cls.demo.timing ? Sys_Microseconds() : 0)
+#define CL_TIMEDEMO_END(section, start) \
+    ((start) ? (void)(cls.demo.time_sections[section] += Sys_Microseconds() - (start)) : (void)0)
+
 typedef struct client_static_s {
     connstate_t state;
     keydest_t   key_dest;
@@ -454,6 +472,10 @@ typedef struct client_static_s {
         qhandle_t   recording;
         unsigned    time_start;
         unsigned    time_frames;
+        qboolean    timing;             // collecting timedemo statistics
+        uint64_t    time_last;          // end of previous timedemo frame
+        uint64_t    time_sections[TD_NUM_SECTIONS];
+        unsigned    *time_samples;      // frame times in microseconds
         int         last_server_frame;  // number of server frame the last svc_frame was written
         int         frames_written;     // number of frames written to demo file
         int         frames_dropped;     // number of svc_frames that didn't fit
@@ -699,6 +721,7 @@ void CL_SeekDemoMessage(void);
 //
 void CL_DeltaFrame(void);
 void CL_AddEntities(void);
+void CL_EntityBench_f(void);
 void CL_CalcViewValues(void);
 
 #ifdef _DEBUG
@@ -778,8 +801,6 @@ void CL_CheckPredictionError(void);
 #define INSTANT_PARTICLE    -10000.0
 
 typedef struct cparticle_s {
-    struct cparticle_s    *next;
-
     float   time;
 
     vec3_t  org;
@@ -1033,4 +1054,8 @@ byte COM_BlockSequenceCRCByte(byte *base, size_t length, int sequence);
 void FX_Init(void);
 
 // RTX development feature that loads and spawns a set of material sample balls
-#define CL_RTX_SHADERBALLS 1
\ No newline at end of file
+#if REF_VKPT
+#define CL_RTX_SHADERBALLS 1
+#else
+#define CL_RTX_SHADERBALLS 0
+#endif
\ No newline at end of file
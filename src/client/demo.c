@@ -27,6 +27,11 @@ static byte     demo_buffer[MAX_PACKETLEN];
 static cvar_t   *cl_demosnaps;
 static cvar_t   *cl_demomsglen;
 static cvar_t   *cl_demowait;
+static cvar_t   *cl_timedemo_log;
+
+static char     demo_filename[MAX_OSPATH];
+
+#define TIMEDEMO_SAMPLE_CHUNK   4096
 
 // =========================================================================
 
@@ -654,6 +659,7 @@ static void update_status(void)
 
 static int parse_next_message(int wait)
 {
+    uint64_t start;
     int ret;
 
     ret = read_next_message(cls.demo.playback);
@@ -669,7 +675,9 @@ static int parse_next_message(int wait)
         return -1;
     }
 
+    CL_TIMEDEMO_BEGIN(start);
     CL_ParseServerMessage();
+    CL_TIMEDEMO_END(TD_PARSE, start);
 
     // if recording demo, write the message out
     if (cls.demo.recording && !cls.demo.paused && CL_FRAMESYNC) {
@@ -731,6 +739,7 @@ static void CL_PlayDemo_f(void)
 
     cls.demo.playback = f;
     cls.state = ca_connected;
+    Q_strlcpy(demo_filename, name, sizeof(demo_filename));
     Q_strlcpy(cls.servername, COM_SkipPath(name), sizeof(cls.servername));
     cls.serverAddress.type = NA_LOOPBACK;
 
@@ -754,14 +763,6 @@ static void CL_Demo_c(genctx_t *ctx, int argnum)
     }
 }
 
-typedef struct {
-    list_t entry;
-    int framenum;
-    off_t filepos;
-    size_t msglen;
-    byte data[1];
-} demosnap_t;
-
 /*
 ====================
 CL_EmitDemoSnapshot
@@ -866,6 +867,61 @@ static demosnap_t *find_snapshot(int framenum)
     return prev;
 }
 
+/*
+====================
+Demo seek index
+
+Snapshots can be saved next to the demo in a sidecar file, so that later
+playback can seek anywhere without parsing everything in between.
+====================
+*/
+
+static qboolean index_filename(char *buffer, size_t size)
+{
+    return demo_filename[0] &&
+        Q_concat(buffer, size, demo_filename, ".idx", NULL) < size;
+}
+
+static void load_demo_index(void)
+{
+    char buffer[MAX_OSPATH];
+    int ret;
+
+    if (!index_filename(buffer, sizeof(buffer)))
+        return;
+
+    ret = DEMO_LoadIndex(buffer, &cls.demo.snapshots, TAG_GENERAL,
+                         cls.demo.file_size, cls.demo.file_offset);
+    if (ret == Q_ERR_NOENT)
+        return;
+
+    if (ret < 0) {
+        cls.demo.last_snapshot = INT_MIN;
+        Com_WPrintf("Ignoring invalid demo index %s: %s\n", buffer, Q_ErrorString(ret));
+        return;
+    }
+
+    if (ret)
+        cls.demo.last_snapshot = LIST_LAST(demosnap_t, &cls.demo.snapshots, entry)->framenum;
+    Com_DPrintf("Loaded %d snaps from %s\n", ret, buffer);
+}
+
+static void write_demo_index(void)
+{
+    char buffer[MAX_OSPATH];
+    int ret;
+
+    if (!index_filename(buffer, sizeof(buffer)))
+        return;
+
+    ret = DEMO_WriteIndex(buffer, &cls.demo.snapshots,
+                          cls.demo.file_size, cls.demo.file_offset);
+    if (ret < 0)
+        Com_EPrintf("Couldn't write %s: %s\n", buffer, Q_ErrorString(ret));
+    else
+        Com_Printf("Wrote %d snapshots to %s\n", ret, buffer);
+}
+
 /*
 ====================
 CL_FirstDemoFrame
@@ -894,17 +950,25 @@ void CL_FirstDemoFrame(void)
     if (com_timedemo->integer) {
         cls.demo.time_frames = 0;
         cls.demo.time_start = Sys_Milliseconds();
+        cls.demo.timing = qtrue;
+        cls.demo.time_last = Sys_Microseconds();
+        memset(cls.demo.time_sections, 0, sizeof(cls.demo.time_sections));
     }
 
     // force initial snapshot
     cls.demo.last_snapshot = INT_MIN;
+
+    // pick up snapshots saved by demoindex
+    if (LIST_EMPTY(&cls.demo.snapshots) && cls.demo.file_size)
+        load_demo_index();
 }
 
+static qboolean seek_demo(int dest, qboolean stop_at_eof);
+
 static void CL_Seek_f(void)
 {
-    demosnap_t *snap;
-    int i, j, ret, index, frames, dest, prev;
-    char *from, *to;
+    int frames, dest;
+    char *to;
 
     if (Cmd_Argc() < 2) {
         Com_Printf("Usage: %s [+-]<timespec>\n", Cmd_Argv(0));
@@ -940,16 +1004,63 @@ static void CL_Seek_f(void)
             Com_Printf("Invalid absolute timespec.\n");
             return;
         }
-        frames = dest - cls.demo.frames_read;
     }
 
+    seek_demo(dest, qfalse);
+}
+
+/*
+====================
+CL_IndexDemo_f
+
+Reads the demo through to the end, saving snapshots to a sidecar index,
+then returns to the current position.
+====================
+*/
+static void CL_IndexDemo_f(void)
+{
+    unsigned start;
+    int framenum, total;
+
+    if (!cls.demo.playback) {
+        Com_Printf("Not playing a demo.\n");
+        return;
+    }
+
+    if (!cls.demo.file_size || cl_demosnaps->integer <= 0) {
+        Com_Printf("This demo can't be indexed.\n");
+        return;
+    }
+
+    start = Sys_Milliseconds();
+    framenum = cls.demo.frames_read;
+
+    if (!seek_demo(INT_MAX, qtrue))
+        return;
+
+    total = cls.demo.frames_read;
+    write_demo_index();
+    seek_demo(framenum, qfalse);
+
+    Com_Printf("Indexed %d frames in %u ms\n", total, Sys_Milliseconds() - start);
+}
+
+// returns qfalse if the demo has been finished
+static qboolean seek_demo(int dest, qboolean stop_at_eof)
+{
+    demosnap_t *snap;
+    int i, j, ret, index, frames, prev;
+    char *from, *to;
+
+    frames = dest - cls.demo.frames_read;
+
     if (!frames)
         // already there
-        return;
+        return qtrue;
 
-    if (frames > 0 && cls.demo.eof && cl_demowait->integer)
+    if (frames > 0 && cls.demo.eof && (cl_demowait->integer || stop_at_eof))
         // already at end
-        return;
+        return qtrue;
 
     // disable effects processing
     cls.demo.seeking = qtrue;
@@ -969,6 +1080,10 @@ static void CL_Seek_f(void)
     if (frames < 0 || cls.demo.last_snapshot > cls.demo.frames_read) {
         snap = find_snapshot(dest);
 
+        // don't go back when seeking forward past the last snapshot
+        if (snap && frames > 0 && snap->framenum <= cls.demo.frames_read)
+            snap = NULL;
+
         if (snap) {
             Com_DPrintf("found snap at %d\n", snap->framenum);
             ret = FS_Seek(cls.demo.playback, snap->filepos);
@@ -1007,13 +1122,13 @@ static void CL_Seek_f(void)
     // skip forward to destination frame
     while (cls.demo.frames_read < dest) {
         ret = read_next_message(cls.demo.playback);
-        if (ret == 0 && cl_demowait->integer) {
+        if (ret == 0 && (cl_demowait->integer || stop_at_eof)) {
             cls.demo.eof = qtrue;
             break;
         }
         if (ret <= 0) {
             finish_demo(ret);
-            return;
+            return qfalse;
         }
 
         CL_SeekDemoMessage();
@@ -1059,6 +1174,7 @@ static void CL_Seek_f(void)
 
 done:
     cls.demo.seeking = qfalse;
+    return qtrue;
 }
 
 static void parse_info_string(demoInfo_t *info, int clientNum, int index, const char *string)
@@ -1174,11 +1290,175 @@ fail:
 
 }
 
+/*
+====================
+report_timedemo
+
+Prints frame time percentiles and time spent per client subsystem, and
+appends them as a JSON line to cl_timedemo_log if set.
+====================
+*/
+static const char *const timedemo_sections[TD_NUM_SECTIONS] = {
+    "parse", "deltaframe", "entities", "effects", "refresh", "sound"
+};
+
+static int samplecmp(const void *p1, const void *p2)
+{
+    unsigned a = *(const unsigned *)p1;
+    unsigned b = *(const unsigned *)p2;
+
+    return a < b ? -1 : a > b;
+}
+
+// quotes and backslashes are escaped, control characters dropped
+static void write_json_string(qhandle_t f, const char *s)
+{
+    FS_FPrintf(f, "\"");
+    for (; *s; s++) {
+        if (*s == '"' || *s == '\\')
+            FS_FPrintf(f, "\\%c", *s);
+        else if (Q_isprint(*s))
+            FS_FPrintf(f, "%c", *s);
+    }
+    FS_FPrintf(f, "\"");
+}
+
+static void report_timedemo(float sec)
+{
+    static const int percentiles[] = { 50, 90, 99 };
+    unsigned frames = cls.demo.time_frames, *samples = cls.demo.time_samples;
+    char buffer[MAX_OSPATH];
+    qhandle_t f;
+    int i;
+
+    if (!samples)
+        return;
+
+    // the first sample covers level load
+    samples++;
+    if (--frames < 1)
+        return;
+
+    qsort(samples, frames, sizeof(samples[0]), samplecmp);
+
+    Com_Printf("frame time:");
+    for (i = 0; i < q_countof(percentiles); i++)
+        Com_Printf(" %d%% %.2f ms", percentiles[i], samples[frames * percentiles[i] / 100] * 1e-3);
+    Com_Printf(", max %.2f ms\n", samples[frames - 1] * 1e-3);
+
+    Com_Printf("ms per frame:");
+    for (i = 0; i < TD_NUM_SECTIONS; i++)
+        Com_Printf(" %s %.3f", timedemo_sections[i], cls.demo.time_sections[i] * 1e-3 / frames);
+    Com_Printf("\n");
+
+    if (!cl_timedemo_log->string[0])
+        return;
+
+    f = FS_EasyOpenFile(buffer, sizeof(buffer), FS_MODE_APPEND | FS_FLAG_TEXT,
+                        "", cl_timedemo_log->string, ".json");
+    if (!f)
+        return;
+
+    FS_FPrintf(f, "{\"demo\":");
+    write_json_string(f, COM_SkipPath(demo_filename));
+    FS_FPrintf(f, ",\"frames\":%u,\"seconds\":%.3f,\"fps\":%.1f,\"frame_ms\":{",
+               cls.demo.time_frames, sec, cls.demo.time_frames / sec);
+    for (i = 0; i < q_countof(percentiles); i++)
+        FS_FPrintf(f, "\"p%d\":%.3f,", percentiles[i], samples[frames * percentiles[i] / 100] * 1e-3);
+    FS_FPrintf(f, "\"max\":%.3f},\"section_ms\":{", samples[frames - 1] * 1e-3);
+    for (i = 0; i < TD_NUM_SECTIONS; i++)
+        FS_FPrintf(f, "%s\"%s\":%.4f", i ? "," : "", timedemo_sections[i],
+                   cls.demo.time_sections[i] * 1e-3 / frames);
+    FS_FPrintf(f, "}}\n");
+
+    FS_FCloseFile(f);
+
+    Com_Printf("Appended timedemo results to %s\n", buffer);
+}
+
+/*
+====================
+CL_DemoScan_f
+
+Reads every demo in a directory and writes one JSON line per file with
+map, POV, size and message count. The output file is overwritten, so each
+scan lists the directory exactly once.
+====================
+*/
+static void CL_DemoScan_f(void)
+{
+    char path[MAX_OSPATH], buffer[MAX_OSPATH];
+    const char *dir, *name;
+    demoInfo_t info;
+    qhandle_t f, out;
+    void **list;
+    int i, count, msgs, errors;
+    ssize_t len;
+    unsigned start;
+
+    dir = Cmd_Argc() > 1 ? Cmd_Argv(1) : "demos";
+    name = Cmd_Argc() > 2 ? Cmd_Argv(2) : "demoscan";
+
+    list = FS_ListFiles(dir, ".dm2;.dm2.gz;.mvd2;.mvd2.gz", 0, &count);
+    if (!list) {
+        Com_Printf("No demos found in %s\n", dir);
+        return;
+    }
+
+    out = FS_EasyOpenFile(buffer, sizeof(buffer), FS_MODE_WRITE | FS_FLAG_TEXT,
+                          "", name, ".json");
+    if (!out) {
+        FS_FreeList(list);
+        return;
+    }
+
+    start = Sys_Milliseconds();
+    errors = 0;
+
+    for (i = 0; i < count; i++) {
+        Q_concat(path, sizeof(path), dir, "/", (char *)list[i], NULL);
+
+        memset(&info, 0, sizeof(info));
+        if (!CL_GetDemoInfo(path, &info)) {
+            Com_WPrintf("Couldn't read %s\n", path);
+            errors++;
+            continue;
+        }
+
+        // count messages; MVD frames have a different framing
+        msgs = -1;
+        len = FS_FOpenFile(path, &f, FS_MODE_READ);
+        if (f) {
+            if (!info.mvd && read_first_message(f) == 0) {
+                for (msgs = 1; read_next_message(f) > 0; msgs++)
+                    ;
+            }
+            FS_FCloseFile(f);
+        }
+
+        FS_FPrintf(out, "{\"file\":");
+        write_json_string(out, path);
+        FS_FPrintf(out, ",\"size\":%"PRIz",\"mvd\":%s,\"map\":",
+                   len > 0 ? (size_t)len : 0, info.mvd ? "true" : "false");
+        write_json_string(out, info.map);
+        FS_FPrintf(out, ",\"pov\":");
+        write_json_string(out, info.pov);
+        if (msgs >= 0)
+            FS_FPrintf(out, ",\"messages\":%d", msgs);
+        FS_FPrintf(out, "}\n");
+    }
+
+    FS_FCloseFile(out);
+    FS_FreeList(list);
+
+    Com_Printf("Scanned %d demos (%d errors) in %u ms, wrote %s\n",
+               count, errors, Sys_Milliseconds() - start, buffer);
+}
+
 // =========================================================================
 
 void CL_CleanupDemos(void)
 {
-    demosnap_t *snap, *next;
     size_t total;
 
     if (cls.demo.recording) {
@@ -1197,20 +1477,20 @@ void CL_CleanupDemos(void)
 
                 Com_Printf("%u frames, %3.1f seconds: %3.1f fps\n",
                            cls.demo.time_frames, sec, fps);
+
+                report_timedemo(sec);
             }
         }
     }
 
-    total = 0;
-    LIST_FOR_EACH_SAFE(demosnap_t, snap, next, &cls.demo.snapshots, entry) {
-        total += snap->msglen;
-        Z_Free(snap);
-    }
+    Z_Free(cls.demo.time_samples);
 
+    total = DEMO_FreeSnapshots(&cls.demo.snapshots);
     if (total)
         Com_DPrintf("Freed %"PRIz" bytes of snaps\n", total);
 
     memset(&cls.demo, 0, sizeof(cls.demo));
+    demo_filename[0] = 0;
 
     List_Init(&cls.demo.snapshots);
 }
@@ -1232,6 +1512,16 @@ void CL_DemoFrame(int msec)
     }
 
     if (com_timedemo->integer) {
+        if (cls.demo.timing) {
+            uint64_t now = Sys_Microseconds();
+
+            // the previous frame has been fully rendered by now
+            if (!(cls.demo.time_frames & (TIMEDEMO_SAMPLE_CHUNK - 1)))
+                cls.demo.time_samples = Z_Realloc(cls.demo.time_samples,
+                    (cls.demo.time_frames + TIMEDEMO_SAMPLE_CHUNK) * sizeof(cls.demo.time_samples[0]));
+            cls.demo.time_samples[cls.demo.time_frames] = now - cls.demo.time_last;
+            cls.demo.time_last = now;
+        }
         parse_next_message(0);
         cl.time = cl.servertime;
         cls.demo.time_frames++;
@@ -1261,6 +1551,8 @@ static const cmdreg_t c_demo[] = {
     { "stop", CL_Stop_f },
     { "suspend", CL_Suspend_f },
     { "seek", CL_Seek_f },
+    { "demoindex", CL_IndexDemo_f },
+    { "demoscan", CL_DemoScan_f },
 
     { NULL }
 };
@@ -1275,6 +1567,7 @@ void CL_InitDemos(void)
     cl_demosnaps = Cvar_Get("cl_demosnaps", "10", 0);
     cl_demomsglen = Cvar_Get("cl_demomsglen", va("%d", MAX_PACKETLEN_WRITABLE_DEFAULT), 0);
     cl_demowait = Cvar_Get("cl_demowait", "0", 0);
+    cl_timedemo_log = Cvar_Get("cl_timedemo_log", "", 0);
 
     Cmd_Register(c_demo);
     List_Init(&cls.demo.snapshots);
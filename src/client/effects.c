@@ -20,6 +20,10 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 
 #include "client.h"
 
+#if USE_SSE2
+#include <emmintrin.h>
+#endif
+
 static void CL_LogoutEffect(vec3_t org, int type);
 
 static vec3_t avelocities[NUMVERTEXNORMALS];
@@ -825,10 +829,39 @@ PARTICLE MANAGEMENT
 ==============================================================
 */
 
-static cparticle_t  *active_particles, *free_particles;
-
-static cparticle_t  particles[MAX_PARTICLES];
-static const int    cl_numparticles = MAX_PARTICLES;
+/*
+Live particles are kept as a dense structure of arrays, so the per frame
+evaluation streams through memory and runs 4 particles at a time.
+Effects fill in a cparticle_t as before; new particles are staged and
+merged into the pool once per frame by CL_AddParticles.
+*/
+typedef struct {
+    float       *time;
+    float       *org[3];
+    float       *vel[3];
+    float       *accel[3];
+    float       *alpha;
+    float       *alphavel;
+    float       *brightness;
+    int         *color;
+    color_t     *rgba;
+    float       *eval[4];       // origin and alpha at the current time
+    int         num;
+    int         max;
+} cparticlepool_t;
+
+#define PARTICLE_ARRAYS     19
+
+// the pool may hold more particles than the refresh draws per frame,
+// only the newest MAX_PARTICLES are submitted
+#define MAX_POOL_PARTICLES  262144
+
+static cparticlepool_t  cl_pool;
+static cparticle_t      *cl_spawned;
+static int              cl_numspawned;
+static void             *cl_poolmem;
+
+static cvar_t       *cl_maxparticles;
 
 extern uint32_t d_8to24table[256];
 
@@ -843,26 +876,56 @@ void FX_Init(void)
 
 static void CL_ClearParticles(void)
 {
-    int     i;
+    float   *f;
+    int     i, max;
+
+    cl_numspawned = 0;
+    cl_pool.num = 0;
+
+    if (!cl_maxparticles)
+        return;
+
+    max = Cvar_ClampInteger(cl_maxparticles, 1024, MAX_POOL_PARTICLES);
+    if (max == cl_pool.max)
+        return;
+
+    Z_Free(cl_poolmem);
+    Z_Free(cl_spawned);
 
-    free_particles = &particles[0];
-    active_particles = NULL;
+    cl_poolmem = Z_Malloc(max * PARTICLE_ARRAYS * sizeof(float));
+    cl_spawned = Z_Malloc(max * sizeof(cparticle_t));
 
-    for (i = 0; i < cl_numparticles; i++)
-        particles[i].next = &particles[i + 1];
-    particles[cl_numparticles - 1].next = NULL;
+    f = cl_poolmem;
+    cl_pool.time = f; f += max;
+    for (i = 0; i < 3; i++) {
+        cl_pool.org[i] = f; f += max;
+        cl_pool.vel[i] = f; f += max;
+        cl_pool.accel[i] = f; f += max;
+    }
+    cl_pool.alpha = f; f += max;
+    cl_pool.alphavel = f; f += max;
+    cl_pool.brightness = f; f += max;
+    cl_pool.color = (int *)f; f += max;
+    cl_pool.rgba = (color_t *)f; f += max;
+    for (i = 0; i < 4; i++) {
+        cl_pool.eval[i] = f; f += max;
+    }
+    cl_pool.max = max;
+}
+
+static void cl_maxparticles_changed(cvar_t *self)
+{
+    CL_ClearParticles();
 }
 
 cparticle_t *CL_AllocParticle(void)
 {
     cparticle_t *p;
 
-    if (!free_particles)
+    if (cl_pool.num + cl_numspawned >= cl_pool.max)
         return NULL;
-    p = free_particles;
-    free_particles = p->next;
-    p->next = active_particles;
-    active_particles = p;
+    p = &cl_spawned[cl_numspawned++];
+    memset(p, 0, sizeof(*p));
 
     return p;
 }
@@ -1981,6 +2044,112 @@ void CL_TeleportParticles(vec3_t org)
 extern int          r_numparticles;
 extern particle_t   r_particles[MAX_PARTICLES];
 
+/*
+===============
+CL_MergeParticles
+
+Moves particles spawned since the last frame into the pool.
+===============
+*/
+static void CL_MergeParticles(void)
+{
+    cparticle_t *p;
+    int         i, j, n;
+
+    for (i = 0, p = cl_spawned; i < cl_numspawned; i++, p++) {
+        n = cl_pool.num++;
+        cl_pool.time[n] = p->time;
+        for (j = 0; j < 3; j++) {
+            cl_pool.org[j][n] = p->org[j];
+            cl_pool.vel[j][n] = p->vel[j];
+            cl_pool.accel[j][n] = p->accel[j];
+        }
+        cl_pool.alpha[n] = p->alpha;
+        cl_pool.alphavel[n] = p->alphavel;
+        cl_pool.brightness[n] = p->brightness;
+        cl_pool.color[n] = p->color;
+        cl_pool.rgba[n] = p->rgba;
+    }
+
+    cl_numspawned = 0;
+}
+
+/*
+===============
+CL_EvalParticles
+
+Computes origin and alpha of every pooled particle at the given time.
+Instant particles are evaluated at their spawn position.
+===============
+*/
+static void CL_EvalParticle(int i, float now)
+{
+    float   time, time2;
+    int     j;
+
+    if (cl_pool.alphavel[i] == INSTANT_PARTICLE)
+        time = 0;
+    else
+        time = (now - cl_pool.time[i]) * 0.001f;
+    time2 = time * time;
+
+    for (j = 0; j < 3; j++)
+        cl_pool.eval[j][i] = cl_pool.org[j][i] + cl_pool.vel[j][i] * time + cl_pool.accel[j][i] * time2;
+    cl_pool.eval[3][i] = cl_pool.alpha[i] + time * cl_pool.alphavel[i];
+}
+
+static void CL_EvalParticles(float now)
+{
+    int     i = 0;
+
+#if USE_SSE2
+    __m128  vnow = _mm_set1_ps(now);
+    __m128  scale = _mm_set1_ps(0.001f);
+    __m128  instant = _mm_set1_ps(INSTANT_PARTICLE);
+    __m128  time, time2, alphavel, o;
+    int     j;
+
+    for (; i + 4 <= cl_pool.num; i += 4) {
+        alphavel = _mm_loadu_ps(&cl_pool.alphavel[i]);
+        time = _mm_mul_ps(_mm_sub_ps(vnow, _mm_loadu_ps(&cl_pool.time[i])), scale);
+        time = _mm_andnot_ps(_mm_cmpeq_ps(alphavel, instant), time);
+        time2 = _mm_mul_ps(time, time);
+
+        for (j = 0; j < 3; j++) {
+            o = _mm_add_ps(_mm_loadu_ps(&cl_pool.org[j][i]),
+                           _mm_mul_ps(_mm_loadu_ps(&cl_pool.vel[j][i]), time));
+            o = _mm_add_ps(o, _mm_mul_ps(_mm_loadu_ps(&cl_pool.accel[j][i]), time2));
+            _mm_storeu_ps(&cl_pool.eval[j][i], o);
+        }
+
+        o = _mm_add_ps(_mm_loadu_ps(&cl_pool.alpha[i]), _mm_mul_ps(time, alphavel));
+        _mm_storeu_ps(&cl_pool.eval[3][i], o);
+    }
+#endif
+
+    for (; i < cl_pool.num; i++)
+        CL_EvalParticle(i, now);
+}
+
+static void CL_MoveParticle(int dst, int src)
+{
+    int     j;
+
+    cl_pool.time[dst] = cl_pool.time[src];
+    for (j = 0; j < 3; j++) {
+        cl_pool.org[j][dst] = cl_pool.org[j][src];
+        cl_pool.vel[j][dst] = cl_pool.vel[j][src];
+        cl_pool.accel[j][dst] = cl_pool.accel[j][src];
+    }
+    cl_pool.alpha[dst] = cl_pool.alpha[src];
+    cl_pool.alphavel[dst] = cl_pool.alphavel[src];
+    cl_pool.brightness[dst] = cl_pool.brightness[src];
+    cl_pool.color[dst] = cl_pool.color[src];
+    cl_pool.rgba[dst] = cl_pool.rgba[src];
+    for (j = 0; j < 4; j++)
+        cl_pool.eval[j][dst] = cl_pool.eval[j][src];
+}
+
 /*
 ===============
 CL_AddParticles
@@ -1988,75 +2157,123 @@ CL_AddParticles
 */
 void CL_AddParticles(void)
 {
-    cparticle_t     *p, *next;
     float           alpha;
-    float           time = 0, time2;
-    int             color;
-    cparticle_t     *active, *tail;
+    int             i, live;
     particle_t      *part;
 
-    active = NULL;
-    tail = NULL;
+    CL_MergeParticles();
+    CL_EvalParticles(cl.time);
 
-    for (p = active_particles; p; p = next) {
-        next = p->next;
+    // drop faded particles, keeping spawn order
+    for (i = live = 0; i < cl_pool.num; i++) {
+        if (cl_pool.eval[3][i] <= 0 && cl_pool.alphavel[i] != INSTANT_PARTICLE)
+            continue;
+        if (live != i)
+            CL_MoveParticle(live, i);
+        live++;
+    }
+    cl_pool.num = live;
 
-        if (p->alphavel != INSTANT_PARTICLE) {
-            time = (cl.time - p->time) * 0.001;
-            alpha = p->alpha + time * p->alphavel;
-            if (alpha <= 0) {
-                // faded out
-                p->next = free_particles;
-                free_particles = p;
-                continue;
+    // submit newest first, so that when other effects have used up part of
+    // the refresh limit it is the oldest particles that are not drawn
+    for (i = cl_pool.num - 1; i >= 0; i--) {
+        if (r_numparticles < MAX_PARTICLES) {
+            part = &r_particles[r_numparticles++];
+
+            alpha = cl_pool.eval[3][i];
+            if (alpha > 1.0)
+                alpha = 1;
+
+            part->origin[0] = cl_pool.eval[0][i];
+            part->origin[1] = cl_pool.eval[1][i];
+            part->origin[2] = cl_pool.eval[2][i];
+
+            if (cl_pool.color[i] == -1) {
+                part->rgba = cl_pool.rgba[i];
+                part->rgba.u8[3] *= alpha;
             }
-        } else {
-            alpha = p->alpha;
-        }
 
-        if (r_numparticles >= MAX_PARTICLES)
-            break;
-        part = &r_particles[r_numparticles++];
+            part->color = cl_pool.color[i];
+            part->brightness = cl_pool.brightness[i];
+            part->alpha = alpha;
+            part->radius = 0.f;
+        }
 
-        p->next = NULL;
-        if (!tail)
-            active = tail = p;
-        else {
-            tail->next = p;
-            tail = p;
+        if (cl_pool.alphavel[i] == INSTANT_PARTICLE) {
+            cl_pool.alphavel[i] = 0.0;
+            cl_pool.alpha[i] = 0.0;
         }
+    }
+}
 
-        if (alpha > 1.0)
-            alpha = 1;
-        color = p->color;
+/*
+===============
+CL_ParticleBench_f
 
-        time2 = time * time;
+Spawns standard effects in bulk over a number of simulated 60 Hz frames
+and times spawning and per frame evaluation. Live particles are lost.
+===============
+*/
+static void CL_ParticleBench_f(void)
+{
+    static vec3_t   up = { 0, 0, 1 };
+    vec3_t          org, end;
+    int             i, j, frames, bursts, oldtime, peak;
+    uint64_t        start, mid, spawn, update;
 
-        part->origin[0] = p->org[0] + p->vel[0] * time + p->accel[0] * time2;
-        part->origin[1] = p->org[1] + p->vel[1] * time + p->accel[1] * time2;
-        part->origin[2] = p->org[2] + p->vel[2] * time + p->accel[2] * time2;
+    if (Cmd_Argc() < 2) {
+        Com_Printf("Usage: %s <frames> [bursts]\n", Cmd_Argv(0));
+        return;
+    }
 
-        if (color == -1) {
-            part->rgba.u8[0] = p->rgba.u8[0];
-            part->rgba.u8[1] = p->rgba.u8[1];
-            part->rgba.u8[2] = p->rgba.u8[2];
-            part->rgba.u8[3] = p->rgba.u8[3] * alpha;
-        }
+    if (!cl_particle_num_factor) {
+        Com_Printf("Refresh not initialized.\n");
+        return;
+    }
+
+    frames = atoi(Cmd_Argv(1));
+    clamp(frames, 1, 100000);
+    bursts = Cmd_Argc() > 2 ? atoi(Cmd_Argv(2)) : 4;
+    clamp(bursts, 1, 256);
 
-        part->color = color;
-		part->brightness = p->brightness;
-		part->alpha = alpha;
-		part->radius = 0.f;
+    oldtime = cl.time;
+    CL_ClearParticles();
 
-        if (p->alphavel == INSTANT_PARTICLE) {
-            p->alphavel = 0.0;
-            p->alpha = 0.0;
+    spawn = update = 0;
+    peak = 0;
+    for (i = 0; i < frames; i++) {
+        cl.time += 16;
+
+        start = Sys_Microseconds();
+        for (j = 0; j < bursts; j++) {
+            VectorSet(org, crand() * 1024, crand() * 1024, crand() * 256);
+            VectorSet(end, org[0] + crand() * 512, org[1] + crand() * 512, org[2]);
+            CL_ParticleEffect(org, up, 0xe0, 40);
+            CL_ExplosionParticles(org);
+            CL_BFGExplosionParticles(org);
+            CL_TeleportParticles(org);
+            CL_BlasterParticles(org, up);
+            CL_BlasterTrail(org, end);
+            CL_BubbleTrail(org, end);
         }
+        mid = Sys_Microseconds();
+
+        r_numparticles = 0;
+        CL_AddParticles();
+        update += Sys_Microseconds() - mid;
+        spawn += mid - start;
+
+        peak = max(peak, cl_pool.num);
     }
-	
-    active_particles = active;
-}
 
+    cl.time = oldtime;
+    r_numparticles = 0;
+    CL_ClearParticles();
+
+    Com_Printf("%d frames, %d live particles peak (max %d)\n", frames, peak, cl_pool.max);
+    Com_Printf("spawn %.3f ms/frame, update %.3f ms/frame\n",
+               spawn * 1e-3 / frames, update * 1e-3 / frames);
+}
 
 /*
 ==============
@@ -2080,5 +2297,10 @@ void CL_InitEffects(void)
         for (j = 0; j < 3; j++)
             avelocities[i][j] = (rand() & 255) * 0.01f;
 
+    cl_maxparticles = Cvar_Get("cl_maxparticles", "65536", 0);
+    cl_maxparticles->changed = cl_maxparticles_changed;
+    CL_ClearParticles();
+
+    Cmd_AddCommand("cl_particlebench", CL_ParticleBench_f);
 }
 
@@ -21,6 +21,10 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include "client.h"
 #include "refresh/models.h"
 
+#if USE_SSE2
+#include <emmintrin.h>
+#endif
+
 extern qhandle_t cl_mod_powerscreen;
 extern qhandle_t cl_mod_laser;
 extern qhandle_t cl_mod_dmspot;
@@ -508,6 +512,84 @@ CL_AddPacketEntities
 
 ===============
 */
+/*
+Origins and angles of the current frame's packet entities are gathered
+into packed arrays, indexed by position in the frame, and interpolated
+in one pass before the entities are emitted. Results are the same as
+with LerpVector and LerpAngles.
+*/
+typedef struct {
+    float   prev[6][MAX_PACKET_ENTITIES];   // origin, then angles
+    float   cur[6][MAX_PACKET_ENTITIES];
+    float   out[6][MAX_PACKET_ENTITIES];
+} entlerp_t;
+
+static entlerp_t    cl_entlerp;
+
+static void CL_LerpPacketEntities(void)
+{
+    entity_state_t  *s1;
+    centity_t       *cent;
+    float           frac = cl.lerpfrac;
+    int             i, j, pnum, count;
+
+    count = cl.frame.numEntities;
+    for (pnum = 0; pnum < count; pnum++) {
+        i = (cl.frame.firstEntity + pnum) & PARSE_ENTITIES_MASK;
+        s1 = &cl.entityStates[i];
+        cent = &cl_entities[s1->number];
+
+        for (j = 0; j < 3; j++) {
+            cl_entlerp.prev[j][pnum] = cent->prev.origin[j];
+            cl_entlerp.cur[j][pnum] = cent->current.origin[j];
+            cl_entlerp.prev[3 + j][pnum] = cent->prev.angles[j];
+            cl_entlerp.cur[3 + j][pnum] = cent->current.angles[j];
+        }
+    }
+
+#if USE_SSE2
+    {
+        __m128  vfrac = _mm_set1_ps(frac);
+        __m128  v180 = _mm_set1_ps(180), vm180 = _mm_set1_ps(-180);
+        __m128  v360 = _mm_set1_ps(360);
+        __m128  a, b, d;
+
+        // arrays are padded to a multiple of 4, extra lanes are ignored
+        for (pnum = 0; pnum < count; pnum += 4) {
+            for (j = 0; j < 3; j++) {
+                a = _mm_loadu_ps(&cl_entlerp.prev[j][pnum]);
+                b = _mm_loadu_ps(&cl_entlerp.cur[j][pnum]);
+                d = _mm_add_ps(a, _mm_mul_ps(vfrac, _mm_sub_ps(b, a)));
+                _mm_storeu_ps(&cl_entlerp.out[j][pnum], d);
+            }
+            for (j = 3; j < 6; j++) {
+                a = _mm_loadu_ps(&cl_entlerp.prev[j][pnum]);
+                b = _mm_loadu_ps(&cl_entlerp.cur[j][pnum]);
+                d = _mm_sub_ps(b, a);
+                b = _mm_sub_ps(b, _mm_and_ps(_mm_cmpgt_ps(d, v180), v360));
+                d = _mm_sub_ps(b, a);
+                b = _mm_add_ps(b, _mm_and_ps(_mm_cmplt_ps(d, vm180), v360));
+                d = _mm_add_ps(a, _mm_mul_ps(vfrac, _mm_sub_ps(b, a)));
+                _mm_storeu_ps(&cl_entlerp.out[j][pnum], d);
+            }
+        }
+    }
+#else
+    for (j = 0; j < 3; j++) {
+        for (pnum = 0; pnum < count; pnum++) {
+            cl_entlerp.out[j][pnum] = cl_entlerp.prev[j][pnum] +
+                frac * (cl_entlerp.cur[j][pnum] - cl_entlerp.prev[j][pnum]);
+        }
+    }
+    for (j = 3; j < 6; j++) {
+        for (pnum = 0; pnum < count; pnum++) {
+            cl_entlerp.out[j][pnum] = LerpAngle(cl_entlerp.prev[j][pnum],
+                                                cl_entlerp.cur[j][pnum], frac);
+        }
+    }
+#endif
+}
+
 static void CL_AddPacketEntities(void)
 {
     entity_t            ent;
@@ -528,6 +610,8 @@ static void CL_AddPacketEntities(void)
 
     memset(&ent, 0, sizeof(ent));
 
+    CL_LerpPacketEntities();
+
     for (pnum = 0; pnum < cl.frame.numEntities; pnum++) {
         i = (cl.frame.firstEntity + pnum) & PARSE_ENTITIES_MASK;
         s1 = &cl.entityStates[i];
@@ -589,8 +673,9 @@ static void CL_AddPacketEntities(void)
             VectorCopy(cent->current.old_origin, ent.oldorigin);  // FIXME
         } else if (renderfx & RF_BEAM) {
             // interpolate start and end points for beams
-            LerpVector(cent->prev.origin, cent->current.origin,
-                       cl.lerpfrac, ent.origin);
+            ent.origin[0] = cl_entlerp.out[0][pnum];
+            ent.origin[1] = cl_entlerp.out[1][pnum];
+            ent.origin[2] = cl_entlerp.out[2][pnum];
             LerpVector(cent->prev.old_origin, cent->current.old_origin,
                        cl.lerpfrac, ent.oldorigin);
         } else {
@@ -600,8 +685,9 @@ static void CL_AddPacketEntities(void)
                 VectorCopy(cl.playerEntityOrigin, ent.oldorigin);
             } else {
                 // interpolate origin
-                LerpVector(cent->prev.origin, cent->current.origin,
-                           cl.lerpfrac, ent.origin);
+                ent.origin[0] = cl_entlerp.out[0][pnum];
+                ent.origin[1] = cl_entlerp.out[1][pnum];
+                ent.origin[2] = cl_entlerp.out[2][pnum];
                 VectorCopy(ent.origin, ent.oldorigin);
             }
 
@@ -702,8 +788,9 @@ static void CL_AddPacketEntities(void)
         } else if (s1->number == cl.frame.clientNum + 1) {
             VectorCopy(cl.playerEntityAngles, ent.angles);      // use predicted angles
         } else { // interpolate angles
-            LerpAngles(cent->prev.angles, cent->current.angles,
-                       cl.lerpfrac, ent.angles);
+            ent.angles[0] = cl_entlerp.out[3][pnum];
+            ent.angles[1] = cl_entlerp.out[4][pnum];
+            ent.angles[2] = cl_entlerp.out[5][pnum];
 
             // mimic original ref_gl "leaning" bug (uuugly!)
             if (s1->modelindex == 255 && cl_rollhack->integer) {
@@ -1368,6 +1455,50 @@ void CL_AddShaderBalls(void)
 }
 #endif
 
+/*
+===============
+CL_EntityBench_f
+
+Runs the packet entity lerp kernel over the current frame a number of times
+at varying lerp fractions and reports the average cost. Only the lerp scratch
+arrays are written, which CL_AddPacketEntities refills every frame, so no
+trails, particles, sounds or entity state are touched.
+===============
+*/
+void CL_EntityBench_f(void)
+{
+    int         i, count;
+    float       lerpfrac;
+    uint64_t    start, time;
+
+    if (Cmd_Argc() < 2) {
+        Com_Printf("Usage: %s <count>\n", Cmd_Argv(0));
+        return;
+    }
+
+    if (cls.state != ca_active || !cl.frame.valid) {
+        Com_Printf("Must be in a level.\n");
+        return;
+    }
+
+    count = atoi(Cmd_Argv(1));
+    clamp(count, 1, 1000000);
+
+    lerpfrac = cl.lerpfrac;
+
+    start = Sys_Microseconds();
+    for (i = 0; i < count; i++) {
+        cl.lerpfrac = (i & 15) / 16.0f;
+        CL_LerpPacketEntities();
+    }
+    time = Sys_Microseconds() - start;
+
+    cl.lerpfrac = lerpfrac;
+
+    Com_Printf("%d packet entities: %.3f us per frame\n",
+               cl.frame.numEntities, (double)time / count);
+}
+
 /*
 ===============
 CL_AddEntities
@@ -1377,14 +1508,19 @@ Emits all entities, particles, and lights to the refresh
 */
 void CL_AddEntities(void)
 {
+    uint64_t start, fxstart;
+
+    CL_TIMEDEMO_BEGIN(start);
     CL_CalcViewValues();
     CL_FinishViewValues();
     CL_AddPacketEntities();
+    CL_TIMEDEMO_BEGIN(fxstart);
     CL_AddTEnts();
     CL_AddParticles();
 #if USE_DLIGHTS
     CL_AddDLights();
 #endif
+    CL_TIMEDEMO_END(TD_EFFECTS, fxstart);
 #if USE_LIGHTSTYLES
     CL_AddLightStyles();
 #endif
@@ -1392,6 +1528,7 @@ void CL_AddEntities(void)
 	CL_AddShaderBalls();
 #endif
     LOC_AddLocationsToScene();
+    CL_TIMEDEMO_END(TD_ENTITIES, start);
 }
 
 /*
@@ -2657,6 +2657,7 @@ static const cmdreg_t c_client[] = {
     { "cmd", CL_ForwardToServer_f },
     { "pause", CL_Pause_f },
     { "pingservers", CL_PingServers_f },
+    { "cl_entbench", CL_EntityBench_f },
     { "skins", CL_Skins_f },
     { "userinfo", CL_Userinfo_f },
     { "snd_restart", CL_RestartSound_f },
@@ -3204,6 +3205,7 @@ CL_Frame
 unsigned CL_Frame(unsigned msec)
 {
     qboolean phys_frame, ref_frame;
+    uint64_t start;
 
     time_after_ref = time_before_ref = 0;
 
@@ -3335,7 +3337,9 @@ unsigned CL_Frame(unsigned msec)
         if (host_speeds->integer)
             time_before_ref = Sys_Milliseconds();
 
+        CL_TIMEDEMO_BEGIN(start);
         SCR_UpdateScreen();
+        CL_TIMEDEMO_END(TD_REFRESH, start);
 
         if (host_speeds->integer)
             time_after_ref = Sys_Milliseconds();
@@ -3345,7 +3349,9 @@ unsigned CL_Frame(unsigned msec)
 
 run_fx:
         // update audio after the 3D view was drawn
+        CL_TIMEDEMO_BEGIN(start);
         S_Update();
+        CL_TIMEDEMO_END(TD_SOUND, start);
 
         // advance local effects for next frame
 #if USE_DLIGHTS
@@ -393,8 +393,13 @@ static void CL_ParseFrame(int extrabits)
 
     cls.demo.frames_read++;
 
-    if (!cls.demo.seeking)
+    if (!cls.demo.seeking) {
+        uint64_t start;
+
+        CL_TIMEDEMO_BEGIN(start);
         CL_DeltaFrame();
+        CL_TIMEDEMO_END(TD_DELTAFRAME, start);
+    }
 }
 
 /*
@@ -338,8 +338,10 @@ void CL_InitRefresh(void)
 	R_RegisterFunctionsGL();
 #elif REF_VKPT
 	R_RegisterFunctionsRTX();
+#elif REF_SOFT
+    R_RegisterFunctionsSW();
 #else
-#error "REF_GL and REF_VKPT are both disabled, at least one has to be enableds"
+#error "REF_GL, REF_VKPT and REF_SOFT are all disabled, at least one has to be enabled"
 #endif
 
     if (!R_Init(qtrue)) {
@@ -28,9 +28,6 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #define AL_UnpackVector(v)  -v[1],v[2],-v[0]
 #define AL_CopyVector(a,b)  ((b)[0]=-(a)[1],(b)[1]=(a)[2],(b)[2]=-(a)[0])
 
-// OpenAL implementation should support at least this number of sources
-#define MIN_CHANNELS 16
-
 int active_buffers = 0;
 qboolean streamPlaying = qfalse;
 static ALuint s_srcnums[MAX_CHANNELS];
@@ -152,7 +149,9 @@ qboolean AL_Init(void)
 	}
 	else
 	{
-		for (i = 0; i < MAX_CHANNELS; i++) {
+		int maxchannels = Cvar_ClampInteger(s_maxchannels, MIN_CHANNELS, MAX_CHANNELS);
+
+		for (i = 0; i < maxchannels; i++) {
 			qalGenSources(1, &s_srcnums[i]);
 			if (qalGetError() != AL_NO_ERROR) {
 				break;
@@ -228,6 +227,7 @@ sfxcache_t *AL_UploadSfx(sfx_t *s)
 
     // allocate placeholder sfxcache
     sc = s->cache = S_Malloc(sizeof(*sc));
+    sc->refcount = 1;
     sc->length = s_info.samples * 1000 / s_info.rate; // in msec
     sc->loopstart = s_info.loopstart;
     sc->width = s_info.width;
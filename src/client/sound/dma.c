@@ -69,7 +69,7 @@ qboolean DMA_Init(void)
 
     S_InitScaletable();
 
-    s_numchannels = MAX_CHANNELS;
+    s_numchannels = Cvar_ClampInteger(s_maxchannels, MIN_CHANNELS, MAX_CHANNELS);
 
     Com_Printf("sound sampling rate: %i\n", dma.speed);
 
@@ -90,6 +90,17 @@ void DMA_Activate(void)
     }
 }
 
+// keeps the device from reading dma while it is temporarily replaced
+void DMA_LockDevice(void)
+{
+    snddma.BeginPainting();
+}
+
+void DMA_UnlockDevice(void)
+{
+    snddma.Submit();
+}
+
 int DMA_DriftBeginofs(float timeofs)
 {
     static int  s_beginofs;
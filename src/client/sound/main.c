@@ -56,6 +56,7 @@ playsound_t s_freeplays;
 playsound_t s_pendingplays;
 
 cvar_t      *s_volume;
+cvar_t      *s_maxchannels;
 cvar_t      *s_ambient;
 #ifdef _DEBUG
 cvar_t      *s_show;
@@ -85,6 +86,8 @@ static void S_SoundInfo_f(void)
     if (s_started == SS_DMA)
         DMA_SoundInfo();
 #endif
+
+    OGG_SoundInfo();
 }
 
 static void S_SoundList_f(void)
@@ -111,7 +114,8 @@ static void S_SoundList_f(void)
                 Com_Printf("L");
             else
                 Com_Printf(" ");
-            Com_Printf("(%2db) %6i : %s\n", sc->width * 8,  size, sfx->name) ;
+            Com_Printf("(%2db) %6i %6.2f ms : %s\n", sc->width * 8, size,
+                       sfx->loadtime * 1e-3, sfx->name);
         } else {
             if (sfx->name[0] == '*')
                 Com_Printf("  placeholder : %s\n", sfx->name);
@@ -127,6 +131,9 @@ static const cmdreg_t c_sound[] = {
     { "stopsound", S_StopAllSounds },
     { "soundlist", S_SoundList_f },
     { "soundinfo", S_SoundInfo_f },
+#if USE_SNDDMA
+    { "s_mixbench", S_MixBench_f },
+#endif
 
     { NULL }
 };
@@ -156,6 +163,7 @@ void S_Init(void)
     Com_Printf("------- S_Init -------\n");
 
     s_volume = Cvar_Get("s_volume", "0.7", CVAR_ARCHIVE);
+    s_maxchannels = Cvar_Get("s_maxchannels", "128", CVAR_ARCHIVE | CVAR_SOUND);
     s_ambient = Cvar_Get("s_ambient", "1", 0);
 #ifdef _DEBUG
     s_show = Cvar_Get("s_show", "0", 0);
@@ -216,7 +224,7 @@ static void S_FreeSound(sfx_t *sfx)
     if (s_started == SS_OAL)
         AL_DeleteSfx(sfx);
 #endif
-    if (sfx->cache)
+    if (sfx->cache && --sfx->cache->refcount <= 0)
         Z_Free(sfx->cache);
     if (sfx->truename)
         Z_Free(sfx->truename);
@@ -567,6 +575,30 @@ void S_EndRegistration(void)
 }
 
 
+/*
+=================
+S_FindCache
+
+Returns already converted data for the given file, if any other sfx
+has it loaded. All data is converted to the current output rate, so
+the file name is the only key needed.
+=================
+*/
+sfxcache_t *S_FindCache(sfx_t *s, const char *name)
+{
+    int     i;
+    sfx_t   *sfx;
+
+    for (i = 0, sfx = known_sfx; i < num_sfx; i++, sfx++) {
+        if (sfx == s || !sfx->cache)
+            continue;
+        if (!strcmp(sfx->truename ? sfx->truename : sfx->name, name))
+            return sfx->cache;
+    }
+
+    return NULL;
+}
+
 //=============================================================================
 
 /*
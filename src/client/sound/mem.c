@@ -25,15 +25,59 @@ wavinfo_t s_info;
 /*
 ================
 ResampleSfx
+
+Converts to the output rate with a windowed sinc filter evaluated at a
+fixed number of sub-sample phases. Resampled sounds are always stored
+16 bit. This runs once per sound, at registration time.
 ================
 */
+#define RESAMPLE_TAPS       8
+#define RESAMPLE_PHASES     32
+
+static float    resample_filter[RESAMPLE_PHASES + 1][RESAMPLE_TAPS];
+
+static void BuildResampleFilter(float stepscale)
+{
+    float   cutoff, x, w, sum;
+    int     i, j;
+
+    // lowpass below the output nyquist frequency when decimating
+    cutoff = stepscale > 1 ? 1 / stepscale : 1;
+
+    for (i = 0; i <= RESAMPLE_PHASES; i++) {
+        sum = 0;
+        for (j = 0; j < RESAMPLE_TAPS; j++) {
+            x = j - (RESAMPLE_TAPS / 2 - 1) - (float)i / RESAMPLE_PHASES;
+            w = 0.5f + 0.5f * cos(M_PI * x / (RESAMPLE_TAPS / 2));
+            if (x == 0)
+                resample_filter[i][j] = w;
+            else
+                resample_filter[i][j] = w * sin(M_PI * cutoff * x) / (M_PI * cutoff * x);
+            sum += resample_filter[i][j];
+        }
+        for (j = 0; j < RESAMPLE_TAPS; j++) {
+            resample_filter[i][j] /= sum;
+        }
+    }
+}
+
+static inline int GetResampleInput(int i)
+{
+    if (i < 0 || i >= s_info.samples)
+        return 0;
+    if (s_info.width == 1)
+        return (s_info.data[i] - 128) << 8;
+    return (int16_t)LittleShort(((uint16_t *)s_info.data)[i]);
+}
+
 static sfxcache_t *ResampleSfx(sfx_t *sfx)
 {
     int         outcount;
-    int         srcsample;
     float       stepscale;
-    int         i;
-    int         samplefrac, fracstep;
+    int         i, j, val;
+    int64_t     samplefrac, fracstep;
+    const float *filter;
+    float       sum;
     sfxcache_t  *sc;
 
     stepscale = (float)s_info.rate / dma.speed;      // this is usually 0.5, 1, or 2
@@ -45,16 +89,14 @@ static sfxcache_t *ResampleSfx(sfx_t *sfx)
         return NULL;
     }
 
-    sc = sfx->cache = S_Malloc(outcount * s_info.width + sizeof(sfxcache_t) - 1);
-
-    sc->length = outcount;
-    sc->loopstart = s_info.loopstart == -1 ? -1 : s_info.loopstart / stepscale;
-    sc->width = s_info.width;
-
-// resample / decimate to the current source rate
-//Com_Printf("%s: %f, %d\n",sfx->name,stepscale,sc->width);
     if (stepscale == 1) {
 // fast special case
+        sc = sfx->cache = S_Malloc(outcount * s_info.width + sizeof(sfxcache_t) - 1);
+        sc->length = outcount;
+        sc->loopstart = s_info.loopstart;
+        sc->width = s_info.width;
+        sc->refcount = 1;
+
         if (sc->width == 1) {
             memcpy(sc->data, s_info.data, outcount);
         } else {
@@ -66,23 +108,32 @@ static sfxcache_t *ResampleSfx(sfx_t *sfx)
             }
 #endif
         }
-    } else {
+        return sc;
+    }
+
 // general case
-        samplefrac = 0;
-        fracstep = stepscale * 256;
-        if (sc->width == 1) {
-            for (i = 0; i < outcount; i++) {
-                srcsample = samplefrac >> 8;
-                samplefrac += fracstep;
-                sc->data[i] = s_info.data[srcsample];
-            }
-        } else {
-            for (i = 0; i < outcount; i++) {
-                srcsample = samplefrac >> 8;
-                samplefrac += fracstep;
-                ((uint16_t *)sc->data)[i] = LittleShort(((uint16_t *)s_info.data)[srcsample]);
-            }
+    sc = sfx->cache = S_Malloc(outcount * 2 + sizeof(sfxcache_t) - 1);
+    sc->length = outcount;
+    sc->loopstart = s_info.loopstart == -1 ? -1 : s_info.loopstart / stepscale;
+    sc->width = 2;
+    sc->refcount = 1;
+
+    BuildResampleFilter(stepscale);
+
+    // 32.32 fixed point source position
+    samplefrac = 0;
+    fracstep = (int64_t)s_info.rate * (1LL << 32) / dma.speed;
+    for (i = 0; i < outcount; i++, samplefrac += fracstep) {
+        int base = (int)(samplefrac >> 32) - (RESAMPLE_TAPS / 2 - 1);
+        int phase = (int)(((samplefrac & 0xffffffff) * RESAMPLE_PHASES + (1LL << 31)) >> 32);
+
+        filter = resample_filter[phase];
+        sum = 0;
+        for (j = 0; j < RESAMPLE_TAPS; j++) {
+            sum += GetResampleInput(base + j) * filter[j];
         }
+        val = Q_rint(sum);
+        ((int16_t *)sc->data)[i] = clamp(val, INT16_MIN, INT16_MAX);
     }
 
     return sc;
@@ -291,6 +342,7 @@ sfxcache_t *S_LoadSound(sfx_t *s)
     sfxcache_t  *sc;
     ssize_t     len;
     char        *name;
+    uint64_t    start;
 
     if (s->name[0] == '*')
         return NULL;
@@ -310,6 +362,18 @@ sfxcache_t *S_LoadSound(sfx_t *s)
     else
         name = s->name;
 
+#if USE_SNDDMA
+// share converted data with any other sfx loaded from the same file
+    if (s_started == SS_DMA && (sc = S_FindCache(s, name)) != NULL) {
+        sc->refcount++;
+        s->cache = sc;
+        s->loadtime = 0;
+        return sc;
+    }
+#endif
+
+    start = Sys_Microseconds();
+
     len = FS_LoadFile(name, (void **)&data);
     if (!data) {
         s->error = len;
@@ -338,6 +402,7 @@ sfxcache_t *S_LoadSound(sfx_t *s)
 
 fail:
     FS_FreeFile(data);
+    s->loadtime = Sys_Microseconds() - start;
     return sc;
 }
 
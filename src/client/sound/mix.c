@@ -18,11 +18,17 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 // snd_mix.c -- portable code to mix sounds for snd_dma.c
 
 #include "sound.h"
+#include "client/sound/vorbis.h"
+
+#if USE_SSE2
+#include <emmintrin.h>
+#endif
 
 #define    PAINTBUFFER_SIZE    2048
 
 static int snd_scaletable[32][256];
 static int snd_vol;
+static qboolean s_mixbench;
 
 samplepair_t s_rawsamples[S_MAX_RAW_SAMPLES];
 int          s_rawend = 0;
@@ -31,6 +37,17 @@ static void WriteLinearBlast(int16_t *out, samplepair_t *samp, int count)
 {
     int i, val;
 
+#if USE_SSE2
+    // shift down and saturate 4 sample pairs at a time
+    for (; count >= 4; count -= 4, samp += 4, out += 8) {
+        __m128i lo = _mm_loadu_si128((const __m128i *)samp);
+        __m128i hi = _mm_loadu_si128((const __m128i *)(samp + 2));
+        lo = _mm_srai_epi32(lo, 8);
+        hi = _mm_srai_epi32(hi, 8);
+        _mm_storeu_si128((__m128i *)out, _mm_packs_epi32(lo, hi));
+    }
+#endif
+
     for (i = 0; i < count; i++, samp++, out += 2) {
         val = samp->left >> 8;
         out[0] = clamp(val, INT16_MIN, INT16_MAX);
@@ -101,7 +118,7 @@ static void TransferStereo(samplepair_t *samp, int endtime)
 
 static void TransferPaintBuffer(samplepair_t *samp, int endtime)
 {
-    if (s_testsound->integer) {
+    if (s_testsound && s_testsound->integer) {
         int i;
 
         // write a fixed sine wave
@@ -164,8 +181,53 @@ static void Paint16(channel_t *ch, sfxcache_t *sc, int count, samplepair_t *samp
     leftvol = ch->leftvol * snd_vol;
     rightvol = ch->rightvol * snd_vol;
     sfx = (int16_t *)sc->data + ch->pos;
+    i = 0;
+
+#if USE_SSE2
+    if (leftvol < 65536 && rightvol < 65536) {
+        // (data * vol) >> 8 == data * (vol >> 8) + ((data * (vol & 255)) >> 8),
+        // which keeps every multiply within 16 bits
+        __m128i lh = _mm_set1_epi16(leftvol >> 8);
+        __m128i ll = _mm_set1_epi16(leftvol & 255);
+        __m128i rh = _mm_set1_epi16(rightvol >> 8);
+        __m128i rl = _mm_set1_epi16(rightvol & 255);
+
+        for (; i + 8 <= count; i += 8, samp += 8) {
+            __m128i d = _mm_loadu_si128((const __m128i *)(sfx + i));
+            __m128i lo, hi, l0, l1, r0, r1;
+
+            lo = _mm_mullo_epi16(d, lh);
+            hi = _mm_mulhi_epi16(d, lh);
+            l0 = _mm_unpacklo_epi16(lo, hi);
+            l1 = _mm_unpackhi_epi16(lo, hi);
+            lo = _mm_mullo_epi16(d, ll);
+            hi = _mm_mulhi_epi16(d, ll);
+            l0 = _mm_add_epi32(l0, _mm_srai_epi32(_mm_unpacklo_epi16(lo, hi), 8));
+            l1 = _mm_add_epi32(l1, _mm_srai_epi32(_mm_unpackhi_epi16(lo, hi), 8));
+
+            lo = _mm_mullo_epi16(d, rh);
+            hi = _mm_mulhi_epi16(d, rh);
+            r0 = _mm_unpacklo_epi16(lo, hi);
+            r1 = _mm_unpackhi_epi16(lo, hi);
+            lo = _mm_mullo_epi16(d, rl);
+            hi = _mm_mulhi_epi16(d, rl);
+            r0 = _mm_add_epi32(r0, _mm_srai_epi32(_mm_unpacklo_epi16(lo, hi), 8));
+            r1 = _mm_add_epi32(r1, _mm_srai_epi32(_mm_unpackhi_epi16(lo, hi), 8));
+
+#define PAINT_PAIRS(n, v) \
+            _mm_storeu_si128((__m128i *)(samp + n), _mm_add_epi32( \
+                _mm_loadu_si128((const __m128i *)(samp + n)), v))
+            PAINT_PAIRS(0, _mm_unpacklo_epi32(l0, r0));
+            PAINT_PAIRS(2, _mm_unpackhi_epi32(l0, r0));
+            PAINT_PAIRS(4, _mm_unpacklo_epi32(l1, r1));
+            PAINT_PAIRS(6, _mm_unpackhi_epi32(l1, r1));
+#undef PAINT_PAIRS
+        }
+        sfx += i;
+    }
+#endif
 
-    for (i = 0; i < count; i++, samp++) {
+    for (; i < count; i++, samp++) {
         data = *sfx++;
         left = (data * leftvol) >> 8;
         right = (data * rightvol) >> 8;
@@ -258,6 +320,11 @@ void S_PaintChannels(int endtime)
 
         }
 
+        // refill the streaming source with already decoded music,
+        // track changes are left to S_Update
+        if (!s_mixbench)
+            OGG_MixStream();
+
         if (s_rawend >= paintedtime)
         {
           /* add from the streaming sound source */
@@ -278,6 +345,110 @@ void S_PaintChannels(int endtime)
 }
 
 
+/*
+=================
+S_MixBench_f
+
+Mixes a number of seconds of looping 16 bit channels as fast as possible
+into a private 44 kHz stereo buffer. The output device never sees it.
+=================
+*/
+void S_MixBench_f(void)
+{
+    dma_t       olddma;
+    channel_t   *oldchannels;
+    sfx_t       sfx;
+    sfxcache_t  *sc;
+    int         i, seconds, numchannels, oldnumchannels;
+    int         oldpaintedtime, oldrawend, samples;
+    uint64_t    start, time;
+
+    if (Cmd_Argc() < 2) {
+        Com_Printf("Usage: %s <seconds> [channels]\n", Cmd_Argv(0));
+        return;
+    }
+
+    seconds = atoi(Cmd_Argv(1));
+    clamp(seconds, 1, 3600);
+    numchannels = Cmd_Argc() > 2 ? atoi(Cmd_Argv(2)) : s_numchannels;
+    clamp(numchannels, 1, MAX_CHANNELS);
+
+#if USE_SNDDMA
+    if (s_started == SS_DMA) {
+        DMA_LockDevice();
+    }
+#endif
+
+    olddma = dma;
+    oldchannels = Z_Malloc(sizeof(channels));
+    memcpy(oldchannels, channels, sizeof(channels));
+    oldnumchannels = s_numchannels;
+    oldpaintedtime = paintedtime;
+    oldrawend = s_rawend;
+
+    dma.channels = 2;
+    dma.samples = 32768;
+    dma.samplebits = 16;
+    dma.speed = 44100;
+    dma.buffer = Z_Malloc(dma.samples * 2);
+    snd_vol = S_GetLinearVolume(s_volume->value) * 256;
+
+    // one second of white noise, looping from the start
+    sc = Z_Malloc(sizeof(*sc) + dma.speed * 2);
+    sc->length = dma.speed;
+    sc->loopstart = 0;
+    sc->width = 2;
+    for (i = 0; i < sc->length; i++) {
+        ((int16_t *)sc->data)[i] = (rand() & 0x7fff) - 0x4000;
+    }
+
+    memset(&sfx, 0, sizeof(sfx));
+    strcpy(sfx.name, "mixbench");
+    sfx.cache = sc;
+
+    paintedtime = 0;
+    s_rawend = 0;
+    s_numchannels = numchannels;
+    memset(channels, 0, sizeof(channels));
+    for (i = 0; i < numchannels; i++) {
+        channels[i].sfx = &sfx;
+        channels[i].leftvol = 64 + (rand() & 191);
+        channels[i].rightvol = 64 + (rand() & 191);
+        channels[i].pos = rand() % sc->length;
+        channels[i].end = sc->length - channels[i].pos;
+        channels[i].entnum = -1;
+    }
+
+    samples = seconds * dma.speed;
+    s_mixbench = qtrue;
+    start = Sys_Microseconds();
+    while (paintedtime < samples) {
+        S_PaintChannels(min(paintedtime + 1024, samples));
+    }
+    time = Sys_Microseconds() - start;
+    s_mixbench = qfalse;
+
+    Com_Printf("mixed %d s of %d channels at %d Hz in %.1f ms (%.1fx realtime)\n",
+               seconds, numchannels, dma.speed, time * 1e-3,
+               time ? seconds * 1e6 / time : 0.0);
+
+    Z_Free(sc);
+    Z_Free(dma.buffer);
+    dma = olddma;
+    memcpy(channels, oldchannels, sizeof(channels));
+    Z_Free(oldchannels);
+    s_numchannels = oldnumchannels;
+    paintedtime = oldpaintedtime;
+    s_rawend = oldrawend;
+    S_InitScaletable();
+
+#if USE_SNDDMA
+    if (s_started == SS_DMA) {
+        DMA_UnlockDevice();
+    }
+#endif
+}
+
 void S_InitScaletable(void)
 {
     int        i, j;
@@ -35,6 +35,9 @@
 #endif
 
 #include <errno.h>
+#include <SDL_atomic.h>
+#include <SDL_mutex.h>
+#include <SDL_thread.h>
 
 #include "shared/shared.h"
 #include "sound.h"
@@ -58,6 +61,32 @@ enum { MAX_NUM_OGGTRACKS = 32 };
 static char* ogg_tracks[MAX_NUM_OGGTRACKS];
 static int ogg_maxfileindex;
 
+/*
+ * Decoded PCM is produced by a decoder thread into a single producer,
+ * single consumer ring of fixed size blocks. The sound system drains
+ * it from the mixer, so decoding never runs on the client frame.
+ * A block with zero samples marks the end of the file.
+ */
+enum { OGG_BLOCK_SAMPLES = 2048, OGG_RING_BLOCKS = 32 };
+
+typedef struct
+{
+	int samples;
+	int rate;
+	int channels;
+	short data[OGG_BLOCK_SAMPLES * 2];
+} ogg_block_t;
+
+static ogg_block_t ogg_ring[OGG_RING_BLOCKS];
+static SDL_atomic_t ogg_ring_head;  /* Next block written by the decoder. */
+static SDL_atomic_t ogg_ring_tail;  /* Next block read by the mixer. */
+static SDL_atomic_t ogg_decoder_quit;
+static SDL_Thread *ogg_decoder;     /* NULL decodes on demand instead. */
+static SDL_mutex *ogg_decoder_lock; /* Guards waiting on ogg_decoder_wake. */
+static SDL_cond *ogg_decoder_wake;  /* Signaled when a block is consumed. */
+static int ogg_stalls;              /* Ring found empty while playing. */
+static int ogg_underruns;           /* Output ran dry mid track. */
+
 
 enum GameType {
 	other, // incl. baseq2
@@ -229,37 +258,206 @@ OGG_InitTrackList(void)
 // --------
 
 /*
- * Play a portion of the currently opened file.
+ * Decode the next block of the currently opened file into the ring.
+ * Returns 1 if a block was decoded, 0 if the ring is full and -1 once
+ * the end of the file has been queued.
  */
-void
-static OGG_Read(void)
+static int
+OGG_DecodeBlock(void)
 {
-	short samples[4096] = {0};
+	int head = SDL_AtomicGet(&ogg_ring_head);
+
+	if (head - SDL_AtomicGet(&ogg_ring_tail) >= OGG_RING_BLOCKS)
+	{
+		return 0;
+	}
+
+	ogg_block_t *block = &ogg_ring[head & (OGG_RING_BLOCKS - 1)];
+
+	block->rate = ogg_file->sample_rate;
+	block->channels = ogg_file->channels > 1 ? 2 : 1;
+	block->samples = stb_vorbis_get_samples_short_interleaved(ogg_file, block->channels,
+		block->data, OGG_BLOCK_SAMPLES * block->channels);
 
-	int read_samples = stb_vorbis_get_samples_short_interleaved(ogg_file, ogg_file->channels, samples,
-		sizeof(samples) / ogg_file->channels);
+	if (block->samples < 0)
+	{
+		block->samples = 0;
+	}
 
-	if (read_samples > 0)
+	// publish the block only after it has been written
+	SDL_AtomicSet(&ogg_ring_head, head + 1);
+
+	return block->samples ? 1 : -1;
+}
+
+static int SDLCALL
+OGG_DecoderThread(void *arg)
+{
+	while (!SDL_AtomicGet(&ogg_decoder_quit))
 	{
-		ogg_numsamples += read_samples;
+		int ret = OGG_DecodeBlock();
 
-		S_RawSamples(read_samples, ogg_file->sample_rate, ogg_file->channels, ogg_file->channels,
-			(byte *)samples, S_GetLinearVolume(ogg_volume->value));
+		if (ret < 0)
+		{
+			break;
+		}
+
+		if (ret == 0)
+		{
+			// Ring is full (or playback is paused), sleep until the
+			// mixer consumes a block or the decoder is stopped.
+			SDL_LockMutex(ogg_decoder_lock);
+
+			while (!SDL_AtomicGet(&ogg_decoder_quit) &&
+			       SDL_AtomicGet(&ogg_ring_head) - SDL_AtomicGet(&ogg_ring_tail) >= OGG_RING_BLOCKS)
+			{
+				SDL_CondWait(ogg_decoder_wake, ogg_decoder_lock);
+			}
+
+			SDL_UnlockMutex(ogg_decoder_lock);
+		}
 	}
-	else
+
+	return 0;
+}
+
+static void
+OGG_WakeDecoder(void)
+{
+	SDL_LockMutex(ogg_decoder_lock);
+	SDL_CondSignal(ogg_decoder_wake);
+	SDL_UnlockMutex(ogg_decoder_lock);
+}
+
+static void OGG_StopDecoder(void);
+
+static void
+OGG_StartDecoder(void)
+{
+	// never leave a previous decoder running on the same file and ring
+	OGG_StopDecoder();
+
+	SDL_AtomicSet(&ogg_decoder_quit, 0);
+
+	ogg_decoder_lock = SDL_CreateMutex();
+	ogg_decoder_wake = SDL_CreateCond();
+
+	if (ogg_decoder_lock && ogg_decoder_wake)
 	{
-		// We cannot call OGG_Stop() here. It flushes the OpenAL sample
-		// queue, thus about 12 seconds of music are lost. Instead we
-		// just set the OGG state to stop and open a new file. The new
-		// files content is added to the sample queue after the remaining
-		// samples from the old file.
-		stb_vorbis_close(ogg_file);
-		ogg_status = STOP;
-		ogg_numbufs = 0;
-		ogg_numsamples = 0;
+		ogg_decoder = SDL_CreateThread(OGG_DecoderThread, "ogg decoder", NULL);
+	}
+
+	if (ogg_decoder == NULL)
+	{
+		Com_WPrintf("OGG_StartDecoder: couldn't create thread: %s\n", SDL_GetError());
+		OGG_StopDecoder();
+	}
+}
+
+static void
+OGG_StopDecoder(void)
+{
+	if (ogg_decoder)
+	{
+		SDL_AtomicSet(&ogg_decoder_quit, 1);
+		OGG_WakeDecoder();
+		SDL_WaitThread(ogg_decoder, NULL);
+		ogg_decoder = NULL;
+	}
+
+	if (ogg_decoder_wake)
+	{
+		SDL_DestroyCond(ogg_decoder_wake);
+		ogg_decoder_wake = NULL;
+	}
+
+	if (ogg_decoder_lock)
+	{
+		SDL_DestroyMutex(ogg_decoder_lock);
+		ogg_decoder_lock = NULL;
+	}
+
+	SDL_AtomicSet(&ogg_ring_head, 0);
+	SDL_AtomicSet(&ogg_ring_tail, 0);
+}
+
+/*
+ * Queue the oldest decoded block for playback. Never decodes, blocks
+ * or touches the file, so the DMA mixer can call it under the device
+ * lock. Returns qfalse if the ring is empty or at the end of file mark.
+ */
+static qboolean
+OGG_ReadBlock(void)
+{
+	int tail = SDL_AtomicGet(&ogg_ring_tail);
+
+	if (SDL_AtomicGet(&ogg_ring_head) == tail)
+	{
+		return qfalse;
+	}
+
+	ogg_block_t *block = &ogg_ring[tail & (OGG_RING_BLOCKS - 1)];
+
+	if (block->samples <= 0)
+	{
+		return qfalse;
+	}
+
+	ogg_numsamples += block->samples;
+
+	S_RawSamples(block->samples, block->rate, block->channels, block->channels,
+		(byte *)block->data, S_GetLinearVolume(ogg_volume->value));
+
+	SDL_AtomicSet(&ogg_ring_tail, tail + 1);
+
+	if (ogg_decoder)
+	{
+		OGG_WakeDecoder();
+	}
+
+	return qtrue;
+}
+
+/*
+ * Play a portion of the currently opened file, switching to the next
+ * track at the end of file. Returns qfalse if no decoded samples are
+ * ready yet.
+ */
+static qboolean
+OGG_Read(void)
+{
+	if (ogg_decoder == NULL)
+	{
+		OGG_DecodeBlock();
+	}
+
+	if (OGG_ReadBlock())
+	{
+		return qtrue;
+	}
 
-		OGG_PlayTrack(ogg_curfile);
+	int tail = SDL_AtomicGet(&ogg_ring_tail);
+
+	if (SDL_AtomicGet(&ogg_ring_head) == tail)
+	{
+		ogg_stalls++;
+		return qfalse;
 	}
+
+	// We cannot call OGG_Stop() here. It flushes the OpenAL sample
+	// queue, thus about 12 seconds of music are lost. Instead we
+	// just set the OGG state to stop and open a new file. The new
+	// files content is added to the sample queue after the remaining
+	// samples from the old file.
+	OGG_StopDecoder();
+	stb_vorbis_close(ogg_file);
+	ogg_status = STOP;
+	ogg_numbufs = 0;
+	ogg_numsamples = 0;
+
+	OGG_PlayTrack(ogg_curfile);
+
+	return qtrue;
 }
 
 /*
@@ -293,7 +491,10 @@ OGG_Stream(void)
 			   buffering normal sfx _and_ ogg/vorbis samples. */
 			while (active_buffers <= ogg_numbufs)
 			{
-				OGG_Read();
+				if (!OGG_Read())
+				{
+					break;
+				}
 			}
 		}
 		else /* using SDL */
@@ -307,13 +508,41 @@ OGG_Stream(void)
 				   fill level. */
 				while (paintedtime + S_MAX_RAW_SAMPLES - 2048 > s_rawend)
 				{
-					OGG_Read();
+					if (!OGG_Read())
+					{
+						if (s_rawend <= paintedtime && ogg_numsamples > 0)
+						{
+							ogg_underruns++;
+						}
+						break;
+					}
 				}
 			}
 		}
 	}
 }
 
+/*
+ * Top up the DMA raw stream from blocks that are already decoded.
+ * Called by the mixer, so it leaves track changes to OGG_Stream.
+ */
+void
+OGG_MixStream(void)
+{
+	if (!ogg_started || ogg_status != PLAY || s_started != SS_DMA)
+	{
+		return;
+	}
+
+	while (paintedtime + S_MAX_RAW_SAMPLES - 2048 > s_rawend)
+	{
+		if (!OGG_ReadBlock())
+		{
+			break;
+		}
+	}
+}
+
 // --------
 
 /*
@@ -376,16 +605,15 @@ OGG_PlayTrack(int trackNo)
 	}
 
 	/* Check running music. */
-	if (ogg_status == PLAY)
+	if (ogg_status == PLAY && ogg_curfile == trackNo)
 	{
-		if (ogg_curfile == trackNo)
-		{
-			return;
-		}
-		else
-		{
-			OGG_Stop();
-		}
+		return;
+	}
+
+	// a paused track still owns the file and the decoder
+	if (ogg_status != STOP)
+	{
+		OGG_Stop();
 	}
 
 	if (ogg_tracks[trackNo] == NULL)
@@ -420,6 +648,7 @@ OGG_PlayTrack(int trackNo)
 	/* Play file. */
 	ogg_curfile = trackNo;
 	ogg_numsamples = 0;
+	OGG_StartDecoder();
 	if (ogg_enable->integer)
 		ogg_status = PLAY;
 	else
@@ -456,12 +685,12 @@ OGG_Info(void)
 	{
 		case PLAY:
 			Com_Printf("State: Playing file %d (%s) at %i samples.\n",
-			           ogg_curfile, ogg_tracks[ogg_curfile], stb_vorbis_get_sample_offset(ogg_file));
+			           ogg_curfile, ogg_tracks[ogg_curfile], ogg_numsamples);
 			break;
 
 		case PAUSE:
 			Com_Printf("State: Paused file %d (%s) at %i samples.\n",
-			           ogg_curfile, ogg_tracks[ogg_curfile], stb_vorbis_get_sample_offset(ogg_file));
+			           ogg_curfile, ogg_tracks[ogg_curfile], ogg_numsamples);
 			break;
 
 		case STOP:
@@ -496,6 +725,7 @@ OGG_Stop(void)
 	}
 #endif
 
+	OGG_StopDecoder();
 	stb_vorbis_close(ogg_file);
 	ogg_status = STOP;
 	ogg_numbufs = 0;
@@ -625,12 +855,37 @@ OGG_RecoverState(void)
 	Cvar_SetValue(ogg_shuffle, 0, FROM_CODE);
 
 	OGG_PlayTrack(ogg_saved_state.curfile);
-	stb_vorbis_seek_frame(ogg_file, ogg_saved_state.numsamples);
-	ogg_numsamples = ogg_saved_state.numsamples;
+
+	if (ogg_status != STOP)
+	{
+		// the decoder owns the file while running
+		OGG_StopDecoder();
+		stb_vorbis_seek_frame(ogg_file, ogg_saved_state.numsamples);
+		ogg_numsamples = ogg_saved_state.numsamples;
+		OGG_StartDecoder();
+	}
 
 	Cvar_SetValue(ogg_shuffle, shuffle_state, FROM_CODE);
 }
 
+/*
+ * Print decoder state for 'soundinfo'.
+ */
+void
+OGG_SoundInfo(void)
+{
+	if (!ogg_started)
+	{
+		return;
+	}
+
+	Com_Printf("%5d/%d music blocks queued (%s decoder)\n",
+	           SDL_AtomicGet(&ogg_ring_head) - SDL_AtomicGet(&ogg_ring_tail),
+	           OGG_RING_BLOCKS, ogg_decoder ? "threaded" : "inline");
+	Com_Printf("%5d music decoder stalls\n", ogg_stalls);
+	Com_Printf("%5d music underruns\n", ogg_underruns);
+}
+
 // --------
 
 static void ogg_enable_changed(cvar_t *self)
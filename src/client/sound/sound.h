@@ -34,6 +34,7 @@ typedef struct sfxcache_s {
     int         length;
     int         loopstart;
     int         width;
+    int         refcount;       // sfx sharing this data (DMA only)
 #if USE_OPENAL
     int         size;
     int         bufnum;
@@ -47,6 +48,7 @@ typedef struct sfx_s {
     sfxcache_t  *cache;
     char        *truename;
     qerror_t    error;
+    unsigned    loadtime;       // microseconds spent loading and converting
 } sfx_t;
 
 // a playsound_t will be generated by each call to S_StartSound,
@@ -107,6 +109,8 @@ void DMA_SoundInfo(void);
 qboolean DMA_Init(void);
 void DMA_Shutdown(void);
 void DMA_Activate(void);
+void DMA_LockDevice(void);
+void DMA_UnlockDevice(void);
 int DMA_DriftBeginofs(float timeofs);
 void DMA_ClearBuffer(void);
 void DMA_Update(void);
@@ -138,7 +142,9 @@ extern int active_buffers;
 
 extern qboolean s_active;
 
-#define MAX_CHANNELS            32
+// sound backends should support at least this number of channels
+#define MIN_CHANNELS            16
+#define MAX_CHANNELS            256
 extern  channel_t   channels[MAX_CHANNELS];
 extern  int         s_numchannels;
 
@@ -158,6 +164,7 @@ extern int          s_rawend;
 extern  wavinfo_t   s_info;
 
 extern cvar_t   *s_volume;
+extern cvar_t   *s_maxchannels;
 #if USE_SNDDMA
 extern cvar_t   *s_khz;
 extern cvar_t   *s_testsound;
@@ -170,11 +177,13 @@ extern cvar_t   *s_show;
 
 sfx_t *S_SfxForHandle(qhandle_t hSfx);
 sfxcache_t *S_LoadSound(sfx_t *s);
+sfxcache_t *S_FindCache(sfx_t *s, const char *name);
 channel_t *S_PickChannel(int entnum, int entchannel);
 void S_IssuePlaysound(playsound_t *ps);
 void S_BuildSoundList(int *sounds);
 #if USE_SNDDMA
 void S_InitScaletable(void);
 void S_PaintChannels(int endtime);
+void S_MixBench_f(void);
 #endif
 
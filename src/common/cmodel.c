@@ -27,6 +27,10 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include "common/zone.h"
 #include "system/hunk.h"
 
+#include <SDL_atomic.h>
+#include <SDL_cpuinfo.h>
+#include <SDL_thread.h>
+
 mtexinfo_t nulltexinfo;
 
 static mleaf_t      nullleaf;
@@ -221,53 +225,57 @@ CM_BoxLeafnums
 Fills in a list of all the leafs touched
 =============
 */
-static int      leaf_count, leaf_maxcount;
-static mleaf_t  **leaf_list;
-static float    *leaf_mins, *leaf_maxs;
-static mnode_t  *leaf_topnode;
-
-static void CM_BoxLeafs_r(mnode_t *node)
+typedef struct {
+    int         count, maxcount;
+    mleaf_t     **list;
+    float       *mins, *maxs;
+    mnode_t     *topnode;
+} leafwork_t;
+
+static void CM_BoxLeafs_r(leafwork_t *lw, mnode_t *node)
 {
     int     s;
 
     while (node->plane) {
-        s = BoxOnPlaneSideFast(leaf_mins, leaf_maxs, node->plane);
+        s = BoxOnPlaneSideFast(lw->mins, lw->maxs, node->plane);
         if (s == 1) {
             node = node->children[0];
         } else if (s == 2) {
             node = node->children[1];
         } else {
             // go down both
-            if (!leaf_topnode) {
-                leaf_topnode = node;
+            if (!lw->topnode) {
+                lw->topnode = node;
             }
-            CM_BoxLeafs_r(node->children[0]);
+            CM_BoxLeafs_r(lw, node->children[0]);
             node = node->children[1];
         }
     }
 
-    if (leaf_count < leaf_maxcount) {
-        leaf_list[leaf_count++] = (mleaf_t *)node;
+    if (lw->count < lw->maxcount) {
+        lw->list[lw->count++] = (mleaf_t *)node;
     }
 }
 
 static int CM_BoxLeafs_headnode(vec3_t mins, vec3_t maxs, mleaf_t **list, int listsize,
                                 mnode_t *headnode, mnode_t **topnode)
 {
-    leaf_list = list;
-    leaf_count = 0;
-    leaf_maxcount = listsize;
-    leaf_mins = mins;
-    leaf_maxs = maxs;
+    leafwork_t  lw;
+
+    lw.list = list;
+    lw.count = 0;
+    lw.maxcount = listsize;
+    lw.mins = mins;
+    lw.maxs = maxs;
 
-    leaf_topnode = NULL;
+    lw.topnode = NULL;
 
-    CM_BoxLeafs_r(headnode);
+    CM_BoxLeafs_r(&lw, headnode);
 
     if (topnode)
-        *topnode = leaf_topnode;
+        *topnode = lw.topnode;
 
-    return leaf_count;
+    return lw.count;
 }
 
 int CM_BoxLeafs(cm_t *cm, vec3_t mins, vec3_t maxs, mleaf_t **list, int listsize, mnode_t **topnode)
@@ -349,13 +357,33 @@ BOX TRACING
 // 1/32 epsilon to keep floating point happy
 #define DIST_EPSILON    (0.03125)
 
-static vec3_t   trace_start, trace_end;
-static vec3_t   trace_mins, trace_maxs;
-static vec3_t   trace_extents;
+// per-trace state lives on the caller's stack rather than in globals.
+// brushes already tested are marked with checkcount in the brushes
+// themselves, unless the trace has its own check array. only traces with
+// their own check arrays (see CM_BoxTraceBatch) may run concurrently.
+typedef struct {
+    vec3_t      start, end;
+    vec3_t      mins, maxs;
+    vec3_t      extents;
+
+    trace_t     *trace;
+    int         contents;
+    int         checkcount;
+    int         *checks;        // indexed by brush number, or NULL
+    mbrush_t    *brushes;       // base of brush numbers for checks
+    qboolean    ispoint;        // optimized case
+} tracework_t;
+
+// marks the brush as tested by this trace, returns qtrue if it was already
+static inline qboolean CM_BrushChecked(tracework_t *tw, mbrush_t *b)
+{
+    int *check = tw->checks ? &tw->checks[b - tw->brushes] : &b->checkcount;
 
-static trace_t  *trace_trace;
-static int      trace_contents;
-static qboolean trace_ispoint;      // optimized case
+    if (*check == tw->checkcount)
+        return qtrue;
+    *check = tw->checkcount;
+    return qfalse;
+}
 
 /*
 ================
@@ -363,7 +391,7 @@ CM_ClipBoxToBrush
 ================
 */
 static void CM_ClipBoxToBrush(vec3_t mins, vec3_t maxs, vec3_t p1, vec3_t p2,
-                              trace_t *trace, mbrush_t *brush)
+                              trace_t *trace, mbrush_t *brush, qboolean ispoint)
 {
     int         i, j;
     cplane_t    *plane, *clipplane;
@@ -392,7 +420,7 @@ static void CM_ClipBoxToBrush(vec3_t mins, vec3_t maxs, vec3_t p1, vec3_t p2,
 
         // FIXME: special case for axial
 
-        if (!trace_ispoint) {
+        if (!ispoint) {
             // general box case
 
             // push the plane out apropriately for mins/maxs
@@ -526,25 +554,24 @@ static void CM_TestBoxInBrush(vec3_t mins, vec3_t maxs, vec3_t p1,
 CM_TraceToLeaf
 ================
 */
-static void CM_TraceToLeaf(mleaf_t *leaf)
+static void CM_TraceToLeaf(tracework_t *tw, mleaf_t *leaf)
 {
     int         k;
     mbrush_t    *b, **leafbrush;
 
-    if (!(leaf->contents & trace_contents))
+    if (!(leaf->contents & tw->contents))
         return;
     // trace line against all brushes in the leaf
     leafbrush = leaf->firstleafbrush;
     for (k = 0; k < leaf->numleafbrushes; k++, leafbrush++) {
         b = *leafbrush;
-        if (b->checkcount == checkcount)
+        if (CM_BrushChecked(tw, b))
             continue;   // already checked this brush in another leaf
-        b->checkcount = checkcount;
 
-        if (!(b->contents & trace_contents))
+        if (!(b->contents & tw->contents))
             continue;
-        CM_ClipBoxToBrush(trace_mins, trace_maxs, trace_start, trace_end, trace_trace, b);
-        if (!trace_trace->fraction)
+        CM_ClipBoxToBrush(tw->mins, tw->maxs, tw->start, tw->end, tw->trace, b, tw->ispoint);
+        if (!tw->trace->fraction)
             return;
     }
 
@@ -556,25 +583,24 @@ static void CM_TraceToLeaf(mleaf_t *leaf)
 CM_TestInLeaf
 ================
 */
-static void CM_TestInLeaf(mleaf_t *leaf)
+static void CM_TestInLeaf(tracework_t *tw, mleaf_t *leaf)
 {
     int         k;
     mbrush_t    *b, **leafbrush;
 
-    if (!(leaf->contents & trace_contents))
+    if (!(leaf->contents & tw->contents))
         return;
     // trace line against all brushes in the leaf
     leafbrush = leaf->firstleafbrush;
     for (k = 0; k < leaf->numleafbrushes; k++, leafbrush++) {
         b = *leafbrush;
-        if (b->checkcount == checkcount)
+        if (CM_BrushChecked(tw, b))
             continue;   // already checked this brush in another leaf
-        b->checkcount = checkcount;
 
-        if (!(b->contents & trace_contents))
+        if (!(b->contents & tw->contents))
             continue;
-        CM_TestBoxInBrush(trace_mins, trace_maxs, trace_start, trace_trace, b);
-        if (!trace_trace->fraction)
+        CM_TestBoxInBrush(tw->mins, tw->maxs, tw->start, tw->trace, b);
+        if (!tw->trace->fraction)
             return;
     }
 
@@ -587,7 +613,7 @@ CM_RecursiveHullCheck
 
 ==================
 */
-static void CM_RecursiveHullCheck(mnode_t *node, float p1f, float p2f, vec3_t p1, vec3_t p2)
+static void CM_RecursiveHullCheck(tracework_t *tw, mnode_t *node, float p1f, float p2f, vec3_t p1, vec3_t p2)
 {
     cplane_t    *plane;
     float       t1, t2, offset;
@@ -597,14 +623,14 @@ static void CM_RecursiveHullCheck(mnode_t *node, float p1f, float p2f, vec3_t p1
     int         side;
     float       midf;
 
-    if (trace_trace->fraction <= p1f)
+    if (tw->trace->fraction <= p1f)
         return;     // already hit something nearer
 
 recheck:
     // if plane is NULL, we are in a leaf node
     plane = node->plane;
     if (!plane) {
-        CM_TraceToLeaf((mleaf_t *)node);
+        CM_TraceToLeaf(tw, (mleaf_t *)node);
         return;
     }
 
@@ -615,16 +641,16 @@ recheck:
     if (plane->type < 3) {
         t1 = p1[plane->type] - plane->dist;
         t2 = p2[plane->type] - plane->dist;
-        offset = trace_extents[plane->type];
+        offset = tw->extents[plane->type];
     } else {
         t1 = PlaneDiff(p1, plane);
         t2 = PlaneDiff(p2, plane);
-        if (trace_ispoint)
+        if (tw->ispoint)
             offset = 0;
         else
-            offset = fabs(trace_extents[0] * plane->normal[0]) +
-                     fabs(trace_extents[1] * plane->normal[1]) +
-                     fabs(trace_extents[2] * plane->normal[2]);
+            offset = fabs(tw->extents[0] * plane->normal[0]) +
+                     fabs(tw->extents[1] * plane->normal[1]) +
+                     fabs(tw->extents[2] * plane->normal[2]);
     }
 
     // see which sides we need to consider
@@ -660,7 +686,7 @@ recheck:
     midf = p1f + (p2f - p1f) * frac;
     LerpVector(p1, p2, frac, mid);
 
-    CM_RecursiveHullCheck(node->children[side], p1f, midf, p1, mid);
+    CM_RecursiveHullCheck(tw, node->children[side], p1f, midf, p1, mid);
 
     // go past the node
     clamp(frac2, 0, 1);
@@ -668,13 +694,17 @@ recheck:
     midf = p1f + (p2f - p1f) * frac2;
     LerpVector(p1, p2, frac2, mid);
 
-    CM_RecursiveHullCheck(node->children[side ^ 1], midf, p2f, mid, p2);
+    CM_RecursiveHullCheck(tw, node->children[side ^ 1], midf, p2f, mid, p2);
 }
 
 
 
 //======================================================================
 
+static void CM_TraceWork(tracework_t *tw, trace_t *trace, vec3_t start, vec3_t end,
+                         vec3_t mins, vec3_t maxs,
+                         mnode_t *headnode, int brushmask);
+
 /*
 ==================
 CM_BoxTrace
@@ -684,23 +714,120 @@ void CM_BoxTrace(trace_t *trace, vec3_t start, vec3_t end,
                  vec3_t mins, vec3_t maxs,
                  mnode_t *headnode, int brushmask)
 {
-    checkcount++;       // for multi-check avoidance
+    tracework_t tw;
+
+    tw.checkcount = ++checkcount;   // for multi-check avoidance
+    tw.checks = NULL;
+    tw.brushes = NULL;
+
+    CM_TraceWork(&tw, trace, start, end, mins, maxs, headnode, brushmask);
+}
+
+/*
+==================
+CM_BoxTraceBatch
+
+Runs a number of independent traces against the same model on worker
+threads. Each thread keeps its own brush check array, so nothing shared
+is written. The model must belong to the given map, the box hull from
+CM_HeadnodeForBox can't be used. Results are identical to CM_BoxTrace.
+==================
+*/
+#define MAX_TRACE_THREADS   16
+
+typedef struct {
+    cm_t            *cm;
+    cmtrace_t       *traces;
+    int             numtraces;
+    mnode_t         *headnode;
+    SDL_atomic_t    next;
+} tracebatch_t;
+
+static int SDLCALL CM_TraceThread(void *arg)
+{
+    tracebatch_t    *batch = arg;
+    bsp_t           *bsp = batch->cm->cache;
+    cmtrace_t       *t;
+    tracework_t     tw;
+    int             i;
+
+    tw.checks = Z_Mallocz(bsp->numbrushes * sizeof(tw.checks[0]));
+    tw.brushes = bsp->brushes;
+    tw.checkcount = 0;
+
+    while ((i = SDL_AtomicAdd(&batch->next, 1)) < batch->numtraces) {
+        t = &batch->traces[i];
+        tw.checkcount++;
+        CM_TraceWork(&tw, &t->trace, t->start, t->end, t->mins, t->maxs,
+                     batch->headnode, t->brushmask);
+    }
+
+    Z_Free(tw.checks);
+    return 0;
+}
 
+void CM_BoxTraceBatch(cm_t *cm, cmtrace_t *traces, int count,
+                      mnode_t *headnode, int numthreads)
+{
+    SDL_Thread      *threads[MAX_TRACE_THREADS];
+    tracebatch_t    batch;
+    int             i;
+
+    if (count < 1) {
+        return;
+    }
+
+    if (!cm->cache || headnode == box_headnode) {
+        for (i = 0; i < count; i++) {
+            CM_BoxTrace(&traces[i].trace, traces[i].start, traces[i].end,
+                        traces[i].mins, traces[i].maxs, headnode, traces[i].brushmask);
+        }
+        return;
+    }
+
+    batch.cm = cm;
+    batch.traces = traces;
+    batch.numtraces = count;
+    batch.headnode = headnode;
+    SDL_AtomicSet(&batch.next, 0);
+
+    if (numthreads < 1) {
+        numthreads = SDL_GetCPUCount();
+    }
+    clamp(numthreads, 1, MAX_TRACE_THREADS);
+    numthreads = min(numthreads, count);
+
+    // this thread traces too, thread creation failure only costs speed
+    for (i = 1; i < numthreads; i++) {
+        threads[i] = SDL_CreateThread(CM_TraceThread, "trace worker", &batch);
+    }
+    CM_TraceThread(&batch);
+    for (i = 1; i < numthreads; i++) {
+        if (threads[i]) {
+            SDL_WaitThread(threads[i], NULL);
+        }
+    }
+}
+
+static void CM_TraceWork(tracework_t *tw, trace_t *trace, vec3_t start, vec3_t end,
+                         vec3_t mins, vec3_t maxs,
+                         mnode_t *headnode, int brushmask)
+{
     // fill in a default trace
-    trace_trace = trace;
-    memset(trace_trace, 0, sizeof(*trace_trace));
-    trace_trace->fraction = 1;
-    trace_trace->surface = &(nulltexinfo.c);
+    tw->trace = trace;
+    memset(trace, 0, sizeof(*trace));
+    tw->trace->fraction = 1;
+    tw->trace->surface = &(nulltexinfo.c);
 
     if (!headnode) {
         return;
     }
 
-    trace_contents = brushmask;
-    VectorCopy(start, trace_start);
-    VectorCopy(end, trace_end);
-    VectorCopy(mins, trace_mins);
-    VectorCopy(maxs, trace_maxs);
+    tw->contents = brushmask;
+    VectorCopy(start, tw->start);
+    VectorCopy(end, tw->end);
+    VectorCopy(mins, tw->mins);
+    VectorCopy(maxs, tw->maxs);
 
     //
     // check for position test special case
@@ -719,11 +846,11 @@ void CM_BoxTrace(trace_t *trace, vec3_t start, vec3_t end,
 
         numleafs = CM_BoxLeafs_headnode(c1, c2, leafs, 1024, headnode, NULL);
         for (i = 0; i < numleafs; i++) {
-            CM_TestInLeaf(leafs[i]);
-            if (trace_trace->allsolid)
+            CM_TestInLeaf(tw, leafs[i]);
+            if (tw->trace->allsolid)
                 break;
         }
-        VectorCopy(start, trace_trace->endpos);
+        VectorCopy(start, tw->trace->endpos);
         return;
     }
 
@@ -732,24 +859,24 @@ void CM_BoxTrace(trace_t *trace, vec3_t start, vec3_t end,
     //
     if (mins[0] == 0 && mins[1] == 0 && mins[2] == 0
         && maxs[0] == 0 && maxs[1] == 0 && maxs[2] == 0) {
-        trace_ispoint = qtrue;
-        VectorClear(trace_extents);
+        tw->ispoint = qtrue;
+        VectorClear(tw->extents);
     } else {
-        trace_ispoint = qfalse;
-        trace_extents[0] = -mins[0] > maxs[0] ? -mins[0] : maxs[0];
-        trace_extents[1] = -mins[1] > maxs[1] ? -mins[1] : maxs[1];
-        trace_extents[2] = -mins[2] > maxs[2] ? -mins[2] : maxs[2];
+        tw->ispoint = qfalse;
+        tw->extents[0] = -mins[0] > maxs[0] ? -mins[0] : maxs[0];
+        tw->extents[1] = -mins[1] > maxs[1] ? -mins[1] : maxs[1];
+        tw->extents[2] = -mins[2] > maxs[2] ? -mins[2] : maxs[2];
     }
 
     //
     // general sweeping through world
     //
-    CM_RecursiveHullCheck(headnode, 0, 1, start, end);
+    CM_RecursiveHullCheck(tw, headnode, 0, 1, start, end);
 
-    if (trace_trace->fraction == 1)
-        VectorCopy(end, trace_trace->endpos);
+    if (tw->trace->fraction == 1)
+        VectorCopy(end, tw->trace->endpos);
     else
-        LerpVector(start, end, trace_trace->fraction, trace_trace->endpos);
+        LerpVector(start, end, tw->trace->fraction, tw->trace->endpos);
 }
 
 
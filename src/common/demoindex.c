@@ -0,0 +1,152 @@
+/*
+Copyright (C) 2003-2008 Andrey Nazarov
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#include "shared/shared.h"
+#include "shared/list.h"
+#include "common/demoindex.h"
+#include "common/error.h"
+#include "common/files.h"
+#include "common/protocol.h"
+
+/*
+The index holds a header with ident, version, demo size, first frame
+offset and snapshot count, followed by each snapshot's frame number, file
+position, length and fake packet, all little endian. It is used only if
+demo size and first frame offset still match.
+*/
+
+#define DEMO_INDEX_IDENT    MakeRawLong('D','I','D','X')
+#define DEMO_INDEX_VERSION  1
+
+// Frees all snapshots and returns the total message bytes they held.
+size_t DEMO_FreeSnapshots(list_t *snapshots)
+{
+    demosnap_t *snap, *next;
+    size_t total = 0;
+
+    LIST_FOR_EACH_SAFE(demosnap_t, snap, next, snapshots, entry) {
+        total += snap->msglen;
+        Z_Free(snap);
+    }
+
+    List_Init(snapshots);
+    return total;
+}
+
+/*
+Appends snapshots from the index to the list. Returns the number loaded,
+or an error code with the list emptied.
+*/
+int DEMO_LoadIndex(const char *name, list_t *snapshots, memtag_t tag,
+                   size_t filesize, size_t fileoffset)
+{
+    uint32_t header[5], rec[3];
+    demosnap_t *snap;
+    qhandle_t f;
+    ssize_t ret;
+    int i, count;
+
+    ret = FS_FOpenFile(name, &f, FS_MODE_READ);
+    if (!f)
+        return ret;
+
+    ret = Q_ERR_UNEXPECTED_EOF;
+    if (FS_Read(header, sizeof(header), f) != sizeof(header))
+        goto fail;
+
+    ret = Q_ERR_INVALID_FORMAT;
+    if (header[0] != DEMO_INDEX_IDENT || LittleLong(header[1]) != DEMO_INDEX_VERSION)
+        goto fail;
+    if (LittleLong(header[2]) != filesize || LittleLong(header[3]) != fileoffset)
+        goto fail;
+
+    count = LittleLong(header[4]);
+    for (i = 0; i < count; i++) {
+        ret = Q_ERR_UNEXPECTED_EOF;
+        if (FS_Read(rec, sizeof(rec), f) != sizeof(rec))
+            goto fail;
+
+        ret = Q_ERR_INVALID_FORMAT;
+        rec[2] = LittleLong(rec[2]);
+        if (rec[2] < 1 || rec[2] > MAX_MSGLEN)
+            goto fail;
+
+        snap = Z_TagMalloc(sizeof(*snap) + rec[2] - 1, tag);
+        snap->framenum = LittleLong(rec[0]);
+        snap->filepos = LittleLong(rec[1]);
+        snap->msglen = rec[2];
+        List_Append(snapshots, &snap->entry);
+
+        ret = Q_ERR_UNEXPECTED_EOF;
+        if (FS_Read(snap->data, snap->msglen, f) != snap->msglen)
+            goto fail;
+    }
+
+    FS_FCloseFile(f);
+    return count;
+
+fail:
+    FS_FCloseFile(f);
+    DEMO_FreeSnapshots(snapshots);
+    return ret;
+}
+
+/*
+Writes all snapshots in the list to the index, replacing any previous
+one. Returns the number written or an error code.
+*/
+int DEMO_WriteIndex(const char *name, list_t *snapshots,
+                    size_t filesize, size_t fileoffset)
+{
+    uint32_t header[5], rec[3];
+    demosnap_t *snap;
+    qhandle_t f;
+    ssize_t ret;
+    int count;
+    qboolean ok;
+
+    ret = FS_FOpenFile(name, &f, FS_MODE_WRITE);
+    if (!f)
+        return ret;
+
+    count = 0;
+    LIST_FOR_EACH(demosnap_t, snap, snapshots, entry) {
+        count++;
+    }
+
+    header[0] = DEMO_INDEX_IDENT;
+    header[1] = LittleLong(DEMO_INDEX_VERSION);
+    header[2] = LittleLong(filesize);
+    header[3] = LittleLong(fileoffset);
+    header[4] = LittleLong(count);
+    ok = FS_Write(header, sizeof(header), f) == sizeof(header);
+
+    LIST_FOR_EACH(demosnap_t, snap, snapshots, entry) {
+        if (!ok)
+            break;
+        rec[0] = LittleLong(snap->framenum);
+        rec[1] = LittleLong(snap->filepos);
+        rec[2] = LittleLong(snap->msglen);
+        ok = FS_Write(rec, sizeof(rec), f) == sizeof(rec) &&
+             FS_Write(snap->data, snap->msglen, f) == snap->msglen;
+    }
+
+    FS_FCloseFile(f);
+
+    return ok ? count : Q_ERR_FAILURE;
+}
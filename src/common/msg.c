@@ -317,8 +317,10 @@ MSG_WriteBits
 */
 void MSG_WriteBits(int value, int bits)
 {
-    int i;
+    int i, shift, count;
     size_t bitpos;
+    uint64_t acc;
+    byte *buf;
 
     if (bits == 0 || bits < -31 || bits > 32) {
         Com_Error(ERR_FATAL, "MSG_WriteBits: bad bits: %d", bits);
@@ -349,13 +351,22 @@ void MSG_WriteBits(int value, int bits)
             break;
         }
     }
-    for (i = 0; i < bits; i++, bitpos++) {
-        if ((bitpos & 7) == 0) {
-            msg_write.data[bitpos >> 3] = 0;
-        }
-        msg_write.data[bitpos >> 3] |= (value & 1) << (bitpos & 7);
-        value >>= 1;
+
+    // merge the value with the pending bits of the last byte in a 64-bit
+    // accumulator, then store all touched bytes at once
+    buf = msg_write.data + (bitpos >> 3);
+    shift = bitpos & 7;
+    acc = (uint64_t)((uint32_t)value & (0xffffffffU >> (32 - bits))) << shift;
+    if (shift) {
+        acc |= buf[0] & ((1U << shift) - 1);
+    }
+
+    bitpos += bits;
+    count = (shift + bits + 7) >> 3;
+    for (i = 0; i < count; i++, acc >>= 8) {
+        buf[i] = acc & 255;
     }
+
     msg_write.bitpos = bitpos;
     msg_write.cursize = (bitpos + 7) >> 3;
 }
@@ -465,6 +476,93 @@ void MSG_WriteDir(const vec3_t dir)
     MSG_WriteByte(best);
 }
 
+/*
+=============
+MSG_PutShort
+MSG_PutLong
+
+Delta writers reserve the whole update with a single SZ_GetSpace call
+and then fill it in with these.
+=============
+*/
+static inline byte *MSG_PutShort(byte *buf, int c)
+{
+    buf[0] = c & 0xff;
+    buf[1] = (c >> 8) & 0xff;
+    return buf + 2;
+}
+
+static inline byte *MSG_PutLong(byte *buf, int c)
+{
+    buf[0] = c & 0xff;
+    buf[1] = (c >> 8) & 0xff;
+    buf[2] = (c >> 16) & 0xff;
+    buf[3] = c >> 24;
+    return buf + 4;
+}
+
+// returns exact number of bytes MSG_WriteDeltaEntity emits for these bits
+static size_t MSG_DeltaEntitySize(uint32_t bits, msgEsFlags_t flags)
+{
+    size_t len = 1;
+
+    if (bits & 0xff000000)
+        len += 3;
+    else if (bits & 0x00ff0000)
+        len += 2;
+    else if (bits & 0x0000ff00)
+        len += 1;
+
+    len += (bits & U_NUMBER16) ? 2 : 1;
+
+    len += !!(bits & U_MODEL) + !!(bits & U_MODEL2) +
+           !!(bits & U_MODEL3) + !!(bits & U_MODEL4);
+
+    if (bits & U_FRAME8)
+        len += 1;
+    else if (bits & U_FRAME16)
+        len += 2;
+
+    if ((bits & (U_SKIN8 | U_SKIN16)) == (U_SKIN8 | U_SKIN16))
+        len += 4;
+    else if (bits & U_SKIN8)
+        len += 1;
+    else if (bits & U_SKIN16)
+        len += 2;
+
+    if ((bits & (U_EFFECTS8 | U_EFFECTS16)) == (U_EFFECTS8 | U_EFFECTS16))
+        len += 4;
+    else if (bits & U_EFFECTS8)
+        len += 1;
+    else if (bits & U_EFFECTS16)
+        len += 2;
+
+    if ((bits & (U_RENDERFX8 | U_RENDERFX16)) == (U_RENDERFX8 | U_RENDERFX16))
+        len += 4;
+    else if (bits & U_RENDERFX8)
+        len += 1;
+    else if (bits & U_RENDERFX16)
+        len += 2;
+
+    len += 2 * (!!(bits & U_ORIGIN1) + !!(bits & U_ORIGIN2) + !!(bits & U_ORIGIN3));
+
+    if ((flags & MSG_ES_SHORTANGLES) && (bits & U_ANGLE16))
+        len += 2 * (!!(bits & U_ANGLE1) + !!(bits & U_ANGLE2) + !!(bits & U_ANGLE3));
+    else
+        len += !!(bits & U_ANGLE1) + !!(bits & U_ANGLE2) + !!(bits & U_ANGLE3);
+
+    if (bits & U_OLDORIGIN)
+        len += 6;
+    if (bits & U_SOUND)
+        len += 1;
+    if (bits & U_EVENT)
+        len += 1;
+    if (bits & U_SOLID)
+        len += (flags & MSG_ES_LONGSOLID) ? 4 : 2;
+
+    return len;
+}
+
 void MSG_PackEntity(entity_packed_t *out, const entity_state_t *in, qboolean short_angles)
 {
     // allow 0 to accomodate empty baselines
@@ -507,6 +605,7 @@ void MSG_WriteDeltaEntity(const entity_packed_t *from,
                           msgEsFlags_t          flags)
 {
     uint32_t    bits, mask;
+    byte        *buf;
 
     if (!to) {
         if (!from)
@@ -664,99 +763,101 @@ void MSG_WriteDeltaEntity(const entity_packed_t *from,
     else if (bits & 0x0000ff00)
         bits |= U_MOREBITS1;
 
-    MSG_WriteByte(bits & 255);
+    buf = SZ_GetSpace(&msg_write, MSG_DeltaEntitySize(bits, flags));
+
+    *buf++ = bits & 255;
 
     if (bits & 0xff000000) {
-        MSG_WriteByte((bits >> 8) & 255);
-        MSG_WriteByte((bits >> 16) & 255);
-        MSG_WriteByte((bits >> 24) & 255);
+        *buf++ = (bits >> 8) & 255;
+        *buf++ = (bits >> 16) & 255;
+        *buf++ = (bits >> 24) & 255;
     } else if (bits & 0x00ff0000) {
-        MSG_WriteByte((bits >> 8) & 255);
-        MSG_WriteByte((bits >> 16) & 255);
+        *buf++ = (bits >> 8) & 255;
+        *buf++ = (bits >> 16) & 255;
     } else if (bits & 0x0000ff00) {
-        MSG_WriteByte((bits >> 8) & 255);
+        *buf++ = (bits >> 8) & 255;
     }
 
     //----------
 
     if (bits & U_NUMBER16)
-        MSG_WriteShort(to->number);
+        buf = MSG_PutShort(buf, to->number);
     else
-        MSG_WriteByte(to->number);
+        *buf++ = to->number;
 
     if (bits & U_MODEL)
-        MSG_WriteByte(to->modelindex);
+        *buf++ = to->modelindex;
     if (bits & U_MODEL2)
-        MSG_WriteByte(to->modelindex2);
+        *buf++ = to->modelindex2;
     if (bits & U_MODEL3)
-        MSG_WriteByte(to->modelindex3);
+        *buf++ = to->modelindex3;
     if (bits & U_MODEL4)
-        MSG_WriteByte(to->modelindex4);
+        *buf++ = to->modelindex4;
 
     if (bits & U_FRAME8)
-        MSG_WriteByte(to->frame);
+        *buf++ = to->frame;
     else if (bits & U_FRAME16)
-        MSG_WriteShort(to->frame);
+        buf = MSG_PutShort(buf, to->frame);
 
     if ((bits & (U_SKIN8 | U_SKIN16)) == (U_SKIN8 | U_SKIN16))  //used for laser colors
-        MSG_WriteLong(to->skinnum);
+        buf = MSG_PutLong(buf, to->skinnum);
     else if (bits & U_SKIN8)
-        MSG_WriteByte(to->skinnum);
+        *buf++ = to->skinnum;
     else if (bits & U_SKIN16)
-        MSG_WriteShort(to->skinnum);
+        buf = MSG_PutShort(buf, to->skinnum);
 
     if ((bits & (U_EFFECTS8 | U_EFFECTS16)) == (U_EFFECTS8 | U_EFFECTS16))
-        MSG_WriteLong(to->effects);
+        buf = MSG_PutLong(buf, to->effects);
     else if (bits & U_EFFECTS8)
-        MSG_WriteByte(to->effects);
+        *buf++ = to->effects;
     else if (bits & U_EFFECTS16)
-        MSG_WriteShort(to->effects);
+        buf = MSG_PutShort(buf, to->effects);
 
     if ((bits & (U_RENDERFX8 | U_RENDERFX16)) == (U_RENDERFX8 | U_RENDERFX16))
-        MSG_WriteLong(to->renderfx);
+        buf = MSG_PutLong(buf, to->renderfx);
     else if (bits & U_RENDERFX8)
-        MSG_WriteByte(to->renderfx);
+        *buf++ = to->renderfx;
     else if (bits & U_RENDERFX16)
-        MSG_WriteShort(to->renderfx);
+        buf = MSG_PutShort(buf, to->renderfx);
 
     if (bits & U_ORIGIN1)
-        MSG_WriteShort(to->origin[0]);
+        buf = MSG_PutShort(buf, to->origin[0]);
     if (bits & U_ORIGIN2)
-        MSG_WriteShort(to->origin[1]);
+        buf = MSG_PutShort(buf, to->origin[1]);
     if (bits & U_ORIGIN3)
-        MSG_WriteShort(to->origin[2]);
+        buf = MSG_PutShort(buf, to->origin[2]);
 
     if ((flags & MSG_ES_SHORTANGLES) && (bits & U_ANGLE16)) {
         if (bits & U_ANGLE1)
-            MSG_WriteShort(to->angles[0]);
+            buf = MSG_PutShort(buf, to->angles[0]);
         if (bits & U_ANGLE2)
-            MSG_WriteShort(to->angles[1]);
+            buf = MSG_PutShort(buf, to->angles[1]);
         if (bits & U_ANGLE3)
-            MSG_WriteShort(to->angles[2]);
+            buf = MSG_PutShort(buf, to->angles[2]);
     } else {
         if (bits & U_ANGLE1)
-            MSG_WriteByte(to->angles[0] >> 8);
+            *buf++ = to->angles[0] >> 8;
         if (bits & U_ANGLE2)
-            MSG_WriteByte(to->angles[1] >> 8);
+            *buf++ = to->angles[1] >> 8;
         if (bits & U_ANGLE3)
-            MSG_WriteByte(to->angles[2] >> 8);
+            *buf++ = to->angles[2] >> 8;
     }
 
     if (bits & U_OLDORIGIN) {
-        MSG_WriteShort(to->old_origin[0]);
-        MSG_WriteShort(to->old_origin[1]);
-        MSG_WriteShort(to->old_origin[2]);
+        buf = MSG_PutShort(buf, to->old_origin[0]);
+        buf = MSG_PutShort(buf, to->old_origin[1]);
+        buf = MSG_PutShort(buf, to->old_origin[2]);
     }
 
     if (bits & U_SOUND)
-        MSG_WriteByte(to->sound);
+        *buf++ = to->sound;
     if (bits & U_EVENT)
-        MSG_WriteByte(to->event);
+        *buf++ = to->event;
     if (bits & U_SOLID) {
         if (flags & MSG_ES_LONGSOLID)
-            MSG_WriteLong(to->solid);
+            buf = MSG_PutLong(buf, to->solid);
         else
-            MSG_WriteShort(to->solid);
+            buf = MSG_PutShort(buf, to->solid);
     }
 }
 
@@ -797,6 +898,8 @@ void MSG_WriteDeltaPlayerstate_Default(const player_packed_t *from, const player
     int     i;
     int     pflags;
     int     statbits;
+    size_t  len;
+    byte    *buf;
 
     if (!to)
         Com_Error(ERR_DROP, "%s: NULL", __func__);
@@ -875,101 +978,137 @@ void MSG_WriteDeltaPlayerstate_Default(const player_packed_t *from, const player
     if (to->gunindex != from->gunindex)
         pflags |= PS_WEAPONINDEX;
 
+    statbits = 0;
+    for (i = 0; i < MAX_STATS; i++)
+        if (to->stats[i] != from->stats[i])
+            statbits |= 1 << i;
+
     //
     // write it
     //
-    MSG_WriteShort(pflags);
+    len = 2 + 4;
+    if (pflags & PS_M_TYPE)
+        len += 1;
+    if (pflags & PS_M_ORIGIN)
+        len += 6;
+    if (pflags & PS_M_VELOCITY)
+        len += 6;
+    if (pflags & PS_M_TIME)
+        len += 1;
+    if (pflags & PS_M_FLAGS)
+        len += 1;
+    if (pflags & PS_M_GRAVITY)
+        len += 2;
+    if (pflags & PS_M_DELTA_ANGLES)
+        len += 6;
+    if (pflags & PS_VIEWOFFSET)
+        len += 3;
+    if (pflags & PS_VIEWANGLES)
+        len += 6;
+    if (pflags & PS_KICKANGLES)
+        len += 3;
+    if (pflags & PS_WEAPONINDEX)
+        len += 1;
+    if (pflags & PS_WEAPONFRAME)
+        len += 7;
+    if (pflags & PS_BLEND)
+        len += 4;
+    if (pflags & PS_FOV)
+        len += 1;
+    if (pflags & PS_RDFLAGS)
+        len += 1;
+    for (i = 0; i < MAX_STATS; i++)
+        if (statbits & (1 << i))
+            len += 2;
+
+    buf = SZ_GetSpace(&msg_write, len);
+    buf = MSG_PutShort(buf, pflags);
 
     //
     // write the pmove_state_t
     //
     if (pflags & PS_M_TYPE)
-        MSG_WriteByte(to->pmove.pm_type);
+        *buf++ = to->pmove.pm_type;
 
     if (pflags & PS_M_ORIGIN) {
-        MSG_WriteShort(to->pmove.origin[0]);
-        MSG_WriteShort(to->pmove.origin[1]);
-        MSG_WriteShort(to->pmove.origin[2]);
+        buf = MSG_PutShort(buf, to->pmove.origin[0]);
+        buf = MSG_PutShort(buf, to->pmove.origin[1]);
+        buf = MSG_PutShort(buf, to->pmove.origin[2]);
     }
 
     if (pflags & PS_M_VELOCITY) {
-        MSG_WriteShort(to->pmove.velocity[0]);
-        MSG_WriteShort(to->pmove.velocity[1]);
-        MSG_WriteShort(to->pmove.velocity[2]);
+        buf = MSG_PutShort(buf, to->pmove.velocity[0]);
+        buf = MSG_PutShort(buf, to->pmove.velocity[1]);
+        buf = MSG_PutShort(buf, to->pmove.velocity[2]);
     }
 
     if (pflags & PS_M_TIME)
-        MSG_WriteByte(to->pmove.pm_time);
+        *buf++ = to->pmove.pm_time;
 
     if (pflags & PS_M_FLAGS)
-        MSG_WriteByte(to->pmove.pm_flags);
+        *buf++ = to->pmove.pm_flags;
 
     if (pflags & PS_M_GRAVITY)
-        MSG_WriteShort(to->pmove.gravity);
+        buf = MSG_PutShort(buf, to->pmove.gravity);
 
     if (pflags & PS_M_DELTA_ANGLES) {
-        MSG_WriteShort(to->pmove.delta_angles[0]);
-        MSG_WriteShort(to->pmove.delta_angles[1]);
-        MSG_WriteShort(to->pmove.delta_angles[2]);
+        buf = MSG_PutShort(buf, to->pmove.delta_angles[0]);
+        buf = MSG_PutShort(buf, to->pmove.delta_angles[1]);
+        buf = MSG_PutShort(buf, to->pmove.delta_angles[2]);
     }
 
     //
     // write the rest of the player_state_t
     //
     if (pflags & PS_VIEWOFFSET) {
-        MSG_WriteChar(to->viewoffset[0]);
-        MSG_WriteChar(to->viewoffset[1]);
-        MSG_WriteChar(to->viewoffset[2]);
+        *buf++ = to->viewoffset[0];
+        *buf++ = to->viewoffset[1];
+        *buf++ = to->viewoffset[2];
     }
 
     if (pflags & PS_VIEWANGLES) {
-        MSG_WriteShort(to->viewangles[0]);
-        MSG_WriteShort(to->viewangles[1]);
-        MSG_WriteShort(to->viewangles[2]);
+        buf = MSG_PutShort(buf, to->viewangles[0]);
+        buf = MSG_PutShort(buf, to->viewangles[1]);
+        buf = MSG_PutShort(buf, to->viewangles[2]);
     }
 
     if (pflags & PS_KICKANGLES) {
-        MSG_WriteChar(to->kick_angles[0]);
-        MSG_WriteChar(to->kick_angles[1]);
-        MSG_WriteChar(to->kick_angles[2]);
+        *buf++ = to->kick_angles[0];
+        *buf++ = to->kick_angles[1];
+        *buf++ = to->kick_angles[2];
     }
 
     if (pflags & PS_WEAPONINDEX)
-        MSG_WriteByte(to->gunindex);
+        *buf++ = to->gunindex;
 
     if (pflags & PS_WEAPONFRAME) {
-        MSG_WriteByte(to->gunframe);
-        MSG_WriteChar(to->gunoffset[0]);
-        MSG_WriteChar(to->gunoffset[1]);
-        MSG_WriteChar(to->gunoffset[2]);
-        MSG_WriteChar(to->gunangles[0]);
-        MSG_WriteChar(to->gunangles[1]);
-        MSG_WriteChar(to->gunangles[2]);
+        *buf++ = to->gunframe;
+        *buf++ = to->gunoffset[0];
+        *buf++ = to->gunoffset[1];
+        *buf++ = to->gunoffset[2];
+        *buf++ = to->gunangles[0];
+        *buf++ = to->gunangles[1];
+        *buf++ = to->gunangles[2];
     }
 
     if (pflags & PS_BLEND) {
-        MSG_WriteByte(to->blend[0]);
-        MSG_WriteByte(to->blend[1]);
-        MSG_WriteByte(to->blend[2]);
-        MSG_WriteByte(to->blend[3]);
+        *buf++ = to->blend[0];
+        *buf++ = to->blend[1];
+        *buf++ = to->blend[2];
+        *buf++ = to->blend[3];
     }
 
     if (pflags & PS_FOV)
-        MSG_WriteByte(to->fov);
+        *buf++ = to->fov;
 
     if (pflags & PS_RDFLAGS)
-        MSG_WriteByte(to->rdflags);
+        *buf++ = to->rdflags;
 
     // send stats
-    statbits = 0;
-    for (i = 0; i < MAX_STATS; i++)
-        if (to->stats[i] != from->stats[i])
-            statbits |= 1 << i;
-
-    MSG_WriteLong(statbits);
+    buf = MSG_PutLong(buf, statbits);
     for (i = 0; i < MAX_STATS; i++)
         if (statbits & (1 << i))
-            MSG_WriteShort(to->stats[i]);
+            buf = MSG_PutShort(buf, to->stats[i]);
 }
 
 int MSG_WriteDeltaPlayerstate_Enhanced(const player_packed_t    *from,
@@ -1717,8 +1856,9 @@ void MSG_ReadDeltaUsercmd_Hacked(const usercmd_t *from, usercmd_t *to)
 
 int MSG_ReadBits(int bits)
 {
-    int i, get;
-    size_t bitpos;
+    int i, shift, count;
+    size_t bitpos, pos;
+    uint64_t acc;
     qboolean sgn;
     int value;
 
@@ -1753,11 +1893,18 @@ int MSG_ReadBits(int bits)
         sgn = qtrue;
     }
 
-    value = 0;
-    for (i = 0; i < bits; i++, bitpos++) {
-        get = (msg_read.data[bitpos >> 3] >> (bitpos & 7)) & 1;
-        value |= get << i;
+    // gather every byte the field spans into a 64-bit accumulator,
+    // bytes past the end of message read as zero
+    pos = bitpos >> 3;
+    shift = bitpos & 7;
+    count = (shift + bits + 7) >> 3;
+    acc = 0;
+    for (i = 0; i < count && pos + i < msg_read.cursize; i++) {
+        acc |= (uint64_t)msg_read.data[pos + i] << (i * 8);
     }
+    value = (uint32_t)(acc >> shift) & (0xffffffffU >> (32 - bits));
+
+    bitpos += bits;
     msg_read.bitpos = bitpos;
     msg_read.readcount = (bitpos + 7) >> 3;
 
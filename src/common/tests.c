@@ -21,6 +21,7 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include "common/cmd.h"
 #include "common/common.h"
 #include "common/files.h"
+#include "common/msg.h"
 #include "common/tests.h"
 #include "refresh/refresh.h"
 #include "system/system.h"
@@ -492,6 +493,718 @@ static void Com_TestSnprintf_f(void)
     Com_Printf("%d failures, %d strings tested\n", errors, num_snprintf_tests * 2);
 }
 
+#if USE_CLIENT
+
+/*
+==============================================================================
+
+MESSAGE DELTA CODING
+
+Round trips synthetic entity and player state streams through the delta
+writers and parsers, checks that every field survives quantization intact,
+and reports encode/decode throughput. Entity updates are also written with
+the original field at a time writer, which must produce the same bytes, so
+both writers can be timed in one build. Mutated copies of the generated
+streams are then fed back to the parsers to look for crashes.
+
+==============================================================================
+*/
+
+#define MSGTEST_ENTITIES    128
+
+#define MSGTEST_ES_FLAGS    (MSG_ES_LONGSOLID | MSG_ES_UMASK | MSG_ES_SHORTANGLES | MSG_ES_BEAMORIGIN)
+
+static uint32_t msgtest_seed;
+
+static uint32_t msgtest_rand(void)
+{
+    // xorshift32, reproducible across platforms unlike rand()
+    msgtest_seed ^= msgtest_seed << 13;
+    msgtest_seed ^= msgtest_seed >> 17;
+    msgtest_seed ^= msgtest_seed << 5;
+    return msgtest_seed;
+}
+
+static int msgtest_range(int lo, int hi)
+{
+    return lo + (int)(msgtest_rand() % (uint32_t)(hi - lo + 1));
+}
+
+// all values are picked on the wire quantization grid so that
+// pack(parse(write(pack(x)))) must be bit exact
+static void msgtest_mutate_entity(entity_state_t *s)
+{
+    uint32_t r = msgtest_rand();
+    int i;
+
+    for (i = 0; i < 3; i++) {
+        if (r & (1 << i))
+            s->origin[i] = msgtest_range(-32768, 32767) * 0.125f;
+        if (r & (8 << i))
+            s->angles[i] = SHORT2ANGLE(msgtest_range(0, 65535));
+    }
+    if (r & 64)
+        VectorCopy(s->origin, s->old_origin);
+    if (r & 128)
+        s->modelindex = msgtest_range(0, 255);
+    if (r & 256)
+        s->modelindex2 = msgtest_range(0, 255);
+    if ((r & 0x600) == 0x600) {
+        s->modelindex3 = msgtest_range(0, 255);
+        s->modelindex4 = msgtest_range(0, 255);
+    }
+    if (r & 0x800)
+        s->frame = msgtest_range(0, 1023);
+    if (r & 0x1000)
+        s->skinnum = (r & 0x2000) ? msgtest_rand() : msgtest_range(0, 65535);
+    if (r & 0x4000)
+        s->effects = (r & 0x8000) ? msgtest_rand() : msgtest_range(0, 255);
+    if (r & 0x10000)
+        s->renderfx = (r & 0x20000) ? msgtest_rand() : msgtest_range(0, 255);
+    if (r & 0x40000)
+        s->solid = msgtest_rand();
+    if (r & 0x80000)
+        s->sound = msgtest_range(0, 255);
+    s->event = (r & 0x100000) ? msgtest_range(1, 255) : 0;
+}
+
+static void msgtest_mutate_player(player_state_t *ps)
+{
+    uint32_t r = msgtest_rand();
+    int i;
+
+    if (r & 1)
+        ps->pmove.pm_type = msgtest_range(0, PM_FREEZE);
+    for (i = 0; i < 3; i++) {
+        if (r & 2)
+            ps->pmove.origin[i] = msgtest_range(-32768, 32767);
+        if (r & 4)
+            ps->pmove.velocity[i] = msgtest_range(-32768, 32767);
+        if (r & 8)
+            ps->pmove.delta_angles[i] = msgtest_range(-32768, 32767);
+        if (r & 16)
+            ps->viewangles[i] = SHORT2ANGLE(msgtest_range(0, 65535));
+        if (r & 32)
+            ps->viewoffset[i] = msgtest_range(-128, 127) * 0.25f;
+        if (r & 64)
+            ps->kick_angles[i] = msgtest_range(-128, 127) * 0.25f;
+        if (r & 128) {
+            ps->gunoffset[i] = msgtest_range(-128, 127) * 0.25f;
+            ps->gunangles[i] = msgtest_range(-128, 127) * 0.25f;
+        }
+    }
+    if (r & 256)
+        ps->pmove.pm_flags = msgtest_range(0, 255);
+    if (r & 512)
+        ps->pmove.pm_time = msgtest_range(0, 255);
+    if (r & 1024)
+        ps->pmove.gravity = msgtest_range(-32768, 32767);
+    if (r & 2048)
+        ps->gunindex = msgtest_range(0, 255);
+    if (r & 4096)
+        ps->gunframe = msgtest_range(0, 255);
+    if (r & 8192)
+        for (i = 0; i < 4; i++)
+            ps->blend[i] = msgtest_range(0, 255) / 255.0f;
+    if (r & 16384)
+        ps->fov = msgtest_range(0, 255);
+    if (r & 32768)
+        ps->rdflags = msgtest_range(0, 255);
+    for (i = 0; i < MAX_STATS; i++)
+        if (msgtest_rand() & 1)
+            ps->stats[i] = msgtest_range(-32768, 32767);
+}
+
+static void msgtest_load_read(void)
+{
+    memcpy(msg_read_buffer, msg_write.data, msg_write.cursize);
+    SZ_Init(&msg_read, msg_read_buffer, sizeof(msg_read_buffer));
+    msg_read.cursize = msg_write.cursize;
+    msg_read.allowunderflow = qtrue;
+    MSG_BeginReading();
+}
+
+// original field at a time entity writer, kept as the reference for the
+// batched one. handles updates only, msgtest never removes entities
+static void msgtest_ref_write_delta_entity(const entity_packed_t *from,
+                                           const entity_packed_t *to,
+                                           msgEsFlags_t          flags)
+{
+    uint32_t    bits, mask;
+
+    bits = 0;
+
+    if (!(flags & MSG_ES_FIRSTPERSON)) {
+        if (to->origin[0] != from->origin[0])
+            bits |= U_ORIGIN1;
+        if (to->origin[1] != from->origin[1])
+            bits |= U_ORIGIN2;
+        if (to->origin[2] != from->origin[2])
+            bits |= U_ORIGIN3;
+
+        if (flags & MSG_ES_SHORTANGLES) {
+            if (to->angles[0] != from->angles[0])
+                bits |= U_ANGLE1 | U_ANGLE16;
+            if (to->angles[1] != from->angles[1])
+                bits |= U_ANGLE2 | U_ANGLE16;
+            if (to->angles[2] != from->angles[2])
+                bits |= U_ANGLE3 | U_ANGLE16;
+        } else {
+            if (to->angles[0] != from->angles[0])
+                bits |= U_ANGLE1;
+            if (to->angles[1] != from->angles[1])
+                bits |= U_ANGLE2;
+            if (to->angles[2] != from->angles[2])
+                bits |= U_ANGLE3;
+        }
+
+        if (flags & MSG_ES_NEWENTITY) {
+            if (to->old_origin[0] != from->origin[0] ||
+                to->old_origin[1] != from->origin[1] ||
+                to->old_origin[2] != from->origin[2])
+                bits |= U_OLDORIGIN;
+        }
+    }
+
+    if (flags & MSG_ES_UMASK)
+        mask = 0xffff0000;
+    else
+        mask = 0xffff8000;  // don't confuse old clients
+
+    if (to->skinnum != from->skinnum) {
+        if (to->skinnum & mask)
+            bits |= U_SKIN8 | U_SKIN16;
+        else if (to->skinnum & 0x0000ff00)
+            bits |= U_SKIN16;
+        else
+            bits |= U_SKIN8;
+    }
+
+    if (to->frame != from->frame) {
+        if (to->frame & 0xff00)
+            bits |= U_FRAME16;
+        else
+            bits |= U_FRAME8;
+    }
+
+    if (to->effects != from->effects) {
+        if (to->effects & mask)
+            bits |= U_EFFECTS8 | U_EFFECTS16;
+        else if (to->effects & 0x0000ff00)
+            bits |= U_EFFECTS16;
+        else
+            bits |= U_EFFECTS8;
+    }
+
+    if (to->renderfx != from->renderfx) {
+        if (to->renderfx & mask)
+            bits |= U_RENDERFX8 | U_RENDERFX16;
+        else if (to->renderfx & 0x0000ff00)
+            bits |= U_RENDERFX16;
+        else
+            bits |= U_RENDERFX8;
+    }
+
+    if (to->solid != from->solid)
+        bits |= U_SOLID;
+
+    // event is not delta compressed, just 0 compressed
+    if (to->event)
+        bits |= U_EVENT;
+
+    if (to->modelindex != from->modelindex)
+        bits |= U_MODEL;
+    if (to->modelindex2 != from->modelindex2)
+        bits |= U_MODEL2;
+    if (to->modelindex3 != from->modelindex3)
+        bits |= U_MODEL3;
+    if (to->modelindex4 != from->modelindex4)
+        bits |= U_MODEL4;
+
+    if (to->sound != from->sound)
+        bits |= U_SOUND;
+
+    if (to->renderfx & RF_FRAMELERP) {
+        bits |= U_OLDORIGIN;
+    } else if (to->renderfx & RF_BEAM) {
+        if (flags & MSG_ES_BEAMORIGIN) {
+            if (to->old_origin[0] != from->old_origin[0] ||
+                to->old_origin[1] != from->old_origin[1] ||
+                to->old_origin[2] != from->old_origin[2])
+                bits |= U_OLDORIGIN;
+        } else {
+            bits |= U_OLDORIGIN;
+        }
+    }
+
+    //
+    // write the message
+    //
+    if (!bits && !(flags & MSG_ES_FORCE))
+        return;     // nothing to send!
+
+    if (flags & MSG_ES_REMOVE)
+        bits |= U_REMOVE; // used for MVD stream only
+
+    //----------
+
+    if (to->number & 0xff00)
+        bits |= U_NUMBER16;     // number8 is implicit otherwise
+
+    if (bits & 0xff000000)
+        bits |= U_MOREBITS3 | U_MOREBITS2 | U_MOREBITS1;
+    else if (bits & 0x00ff0000)
+        bits |= U_MOREBITS2 | U_MOREBITS1;
+    else if (bits & 0x0000ff00)
+        bits |= U_MOREBITS1;
+
+    MSG_WriteByte(bits & 255);
+
+    if (bits & 0xff000000) {
+        MSG_WriteByte((bits >> 8) & 255);
+        MSG_WriteByte((bits >> 16) & 255);
+        MSG_WriteByte((bits >> 24) & 255);
+    } else if (bits & 0x00ff0000) {
+        MSG_WriteByte((bits >> 8) & 255);
+        MSG_WriteByte((bits >> 16) & 255);
+    } else if (bits & 0x0000ff00) {
+        MSG_WriteByte((bits >> 8) & 255);
+    }
+
+    //----------
+
+    if (bits & U_NUMBER16)
+        MSG_WriteShort(to->number);
+    else
+        MSG_WriteByte(to->number);
+
+    if (bits & U_MODEL)
+        MSG_WriteByte(to->modelindex);
+    if (bits & U_MODEL2)
+        MSG_WriteByte(to->modelindex2);
+    if (bits & U_MODEL3)
+        MSG_WriteByte(to->modelindex3);
+    if (bits & U_MODEL4)
+        MSG_WriteByte(to->modelindex4);
+
+    if (bits & U_FRAME8)
+        MSG_WriteByte(to->frame);
+    else if (bits & U_FRAME16)
+        MSG_WriteShort(to->frame);
+
+    if ((bits & (U_SKIN8 | U_SKIN16)) == (U_SKIN8 | U_SKIN16))  //used for laser colors
+        MSG_WriteLong(to->skinnum);
+    else if (bits & U_SKIN8)
+        MSG_WriteByte(to->skinnum);
+    else if (bits & U_SKIN16)
+        MSG_WriteShort(to->skinnum);
+
+    if ((bits & (U_EFFECTS8 | U_EFFECTS16)) == (U_EFFECTS8 | U_EFFECTS16))
+        MSG_WriteLong(to->effects);
+    else if (bits & U_EFFECTS8)
+        MSG_WriteByte(to->effects);
+    else if (bits & U_EFFECTS16)
+        MSG_WriteShort(to->effects);
+
+    if ((bits & (U_RENDERFX8 | U_RENDERFX16)) == (U_RENDERFX8 | U_RENDERFX16))
+        MSG_WriteLong(to->renderfx);
+    else if (bits & U_RENDERFX8)
+        MSG_WriteByte(to->renderfx);
+    else if (bits & U_RENDERFX16)
+        MSG_WriteShort(to->renderfx);
+
+    if (bits & U_ORIGIN1)
+        MSG_WriteShort(to->origin[0]);
+    if (bits & U_ORIGIN2)
+        MSG_WriteShort(to->origin[1]);
+    if (bits & U_ORIGIN3)
+        MSG_WriteShort(to->origin[2]);
+
+    if ((flags & MSG_ES_SHORTANGLES) && (bits & U_ANGLE16)) {
+        if (bits & U_ANGLE1)
+            MSG_WriteShort(to->angles[0]);
+        if (bits & U_ANGLE2)
+            MSG_WriteShort(to->angles[1]);
+        if (bits & U_ANGLE3)
+            MSG_WriteShort(to->angles[2]);
+    } else {
+        if (bits & U_ANGLE1)
+            MSG_WriteByte(to->angles[0] >> 8);
+        if (bits & U_ANGLE2)
+            MSG_WriteByte(to->angles[1] >> 8);
+        if (bits & U_ANGLE3)
+            MSG_WriteByte(to->angles[2] >> 8);
+    }
+
+    if (bits & U_OLDORIGIN) {
+        MSG_WriteShort(to->old_origin[0]);
+        MSG_WriteShort(to->old_origin[1]);
+        MSG_WriteShort(to->old_origin[2]);
+    }
+
+    if (bits & U_SOUND)
+        MSG_WriteByte(to->sound);
+    if (bits & U_EVENT)
+        MSG_WriteByte(to->event);
+    if (bits & U_SOLID) {
+        if (flags & MSG_ES_LONGSOLID)
+            MSG_WriteLong(to->solid);
+        else
+            MSG_WriteShort(to->solid);
+    }
+}
+
+static void Com_TestMsg_f(void)
+{
+    static entity_state_t   ents[2][MSGTEST_ENTITIES];
+    static entity_packed_t  packed[2][MSGTEST_ENTITIES];
+    player_state_t  ps[2], parsed_ps;
+    player_packed_t pps[2], check_ps;
+    entity_state_t  parsed;
+    entity_packed_t check;
+    static byte     ref[MAX_MSGLEN];
+    uint64_t        enc_time, dec_time, ref_time, ent_time, t, t2;
+    size_t          bytes, entlen, msglen;
+    int             i, frame, frames, cur, old, bits, number, errors;
+
+    frames = Cmd_Argc() > 1 ? atoi(Cmd_Argv(1)) : 1000;
+    msgtest_seed = Cmd_Argc() > 2 ? strtoul(Cmd_Argv(2), NULL, 10) : 0;
+    if (frames < 1) {
+        Com_Printf("Usage: %s [frames] [seed]\n", Cmd_Argv(0));
+        return;
+    }
+    if (!msgtest_seed)
+        msgtest_seed = 0x2545f491;
+
+    memset(ents, 0, sizeof(ents));
+    memset(packed, 0, sizeof(packed));
+    memset(ps, 0, sizeof(ps));
+    memset(pps, 0, sizeof(pps));
+    for (i = 0; i < MSGTEST_ENTITIES; i++) {
+        ents[0][i].number = ents[1][i].number = msgtest_range(1, MAX_EDICTS - 1);
+    }
+
+    enc_time = dec_time = ref_time = ent_time = 0;
+    bytes = 0;
+    errors = 0;
+
+    for (frame = 0; frame < frames; frame++) {
+        cur = frame & 1;
+        old = cur ^ 1;
+
+        for (i = 0; i < MSGTEST_ENTITIES; i++) {
+            ents[cur][i] = ents[old][i];
+            if (msgtest_rand() & 3)
+                msgtest_mutate_entity(&ents[cur][i]);
+        }
+        ps[cur] = ps[old];
+        msgtest_mutate_player(&ps[cur]);
+
+        // encode
+        SZ_Clear(&msg_write);
+        t = Sys_Microseconds();
+        for (i = 0; i < MSGTEST_ENTITIES; i++)
+            MSG_PackEntity(&packed[cur][i], &ents[cur][i], qtrue);
+        t2 = Sys_Microseconds();
+        for (i = 0; i < MSGTEST_ENTITIES; i++)
+            MSG_WriteDeltaEntity(&packed[old][i], &packed[cur][i], MSGTEST_ES_FLAGS | MSG_ES_FORCE);
+        ent_time += Sys_Microseconds() - t2;
+        entlen = msg_write.cursize;
+        MSG_PackPlayer(&pps[cur], &ps[cur]);
+        MSG_WriteDeltaPlayerstate_Default(&pps[old], &pps[cur]);
+        enc_time += Sys_Microseconds() - t;
+        bytes += msg_write.cursize;
+
+        // same entities through the reference writer, which must produce
+        // identical bytes
+        msglen = msg_write.cursize;
+        memcpy(ref, msg_write.data, msglen);
+        SZ_Clear(&msg_write);
+        t2 = Sys_Microseconds();
+        for (i = 0; i < MSGTEST_ENTITIES; i++)
+            msgtest_ref_write_delta_entity(&packed[old][i], &packed[cur][i], MSGTEST_ES_FLAGS | MSG_ES_FORCE);
+        ref_time += Sys_Microseconds() - t2;
+        if (msg_write.cursize != entlen || memcmp(msg_write.data, ref, entlen)) {
+            Com_EPrintf("frame %d: entity encoding differs from reference\n", frame);
+            errors++;
+        }
+        memcpy(msg_write.data, ref, msglen);
+        msg_write.cursize = msglen;
+
+        // decode and verify
+        msgtest_load_read();
+        t = Sys_Microseconds();
+        for (i = 0; i < MSGTEST_ENTITIES; i++) {
+            number = MSG_ParseEntityBits(&bits);
+            if (number != ents[cur][i].number) {
+                Com_EPrintf("frame %d: entity %d: got number %d\n", frame, ents[cur][i].number, number);
+                errors++;
+                break;
+            }
+            MSG_ParseDeltaEntity(&ents[old][i], &parsed, number, bits, MSGTEST_ES_FLAGS);
+
+            memset(&check, 0, sizeof(check));
+            MSG_PackEntity(&check, &parsed, qtrue);
+            if (!(bits & U_OLDORIGIN))
+                VectorCopy(packed[cur][i].old_origin, check.old_origin);
+            if (memcmp(&check, &packed[cur][i], sizeof(check))) {
+                Com_EPrintf("frame %d: entity %d: mismatch (bits %#x)\n", frame, number, bits);
+                errors++;
+            }
+        }
+        if (i == MSGTEST_ENTITIES) {
+            MSG_ParseDeltaPlayerstate_Default(&ps[old], &parsed_ps, MSG_ReadWord());
+            memset(&check_ps, 0, sizeof(check_ps));
+            MSG_PackPlayer(&check_ps, &parsed_ps);
+            if (memcmp(&check_ps, &pps[cur], sizeof(check_ps))) {
+                Com_EPrintf("frame %d: player state mismatch\n", frame);
+                errors++;
+            }
+        }
+        dec_time += Sys_Microseconds() - t;
+
+        if (msg_read.readcount != msg_read.cursize) {
+            Com_EPrintf("frame %d: read %"PRIz" of %"PRIz" bytes\n", frame, msg_read.readcount, msg_read.cursize);
+            errors++;
+        }
+
+        // don't let a broken stream flood the console
+        if (errors > 10)
+            break;
+    }
+
+    SZ_Clear(&msg_write);
+    SZ_Init(&msg_read, msg_read_buffer, sizeof(msg_read_buffer));
+
+    Com_Printf("%d failures, %d frames, %d entities/frame, %.1f bytes/frame\n",
+               errors, frame, MSGTEST_ENTITIES, (double)bytes / frame);
+    Com_Printf("encode: %.3f ms, %.1f MB/s, %.0f entities/s\n", enc_time * 1e-3,
+               enc_time ? bytes / (double)enc_time : 0,
+               enc_time ? frame * MSGTEST_ENTITIES * 1e6 / enc_time : 0);
+    Com_Printf("decode: %.3f ms, %.1f MB/s, %.0f entities/s\n", dec_time * 1e-3,
+               dec_time ? bytes / (double)dec_time : 0,
+               dec_time ? frame * MSGTEST_ENTITIES * 1e6 / dec_time : 0);
+    Com_Printf("entity writer: %.3f ms reference, %.3f ms current\n",
+               ref_time * 1e-3, ent_time * 1e-3);
+}
+
+#define MSGTEST_BITFIELDS   4096
+
+// original bit at a time writer, kept as the wire format reference
+static void msgtest_ref_write_bits(byte *data, size_t *bitpos, int value, int bits)
+{
+    int i;
+
+    if (bits < 0)
+        bits = -bits;
+
+    for (i = 0; i < bits; i++, (*bitpos)++) {
+        if ((*bitpos & 7) == 0)
+            data[*bitpos >> 3] = 0;
+        data[*bitpos >> 3] |= (value & 1) << (*bitpos & 7);
+        value >>= 1;
+    }
+}
+
+static int msgtest_ref_read_bits(const byte *data, size_t *bitpos, int bits)
+{
+    int i, value = 0;
+    qboolean sgn = bits < 0;
+
+    if (sgn)
+        bits = -bits;
+
+    for (i = 0; i < bits; i++, (*bitpos)++)
+        value |= ((data[*bitpos >> 3] >> (*bitpos & 7)) & 1) << i;
+
+    if (sgn && (value & (1 << (bits - 1))))
+        value |= -1 ^ ((1 << bits) - 1);
+
+    return value;
+}
+
+static void Com_TestMsgBits_f(void)
+{
+    static int      values[MSGTEST_BITFIELDS];
+    static int      widths[MSGTEST_BITFIELDS];
+    static byte     ref[MAX_MSGLEN];
+    uint64_t        ref_write, ref_read, new_write, new_read, t;
+    size_t          bitpos, bytes;
+    int             i, pass, passes, errors, value;
+
+    passes = Cmd_Argc() > 1 ? atoi(Cmd_Argv(1)) : 1000;
+    if (passes < 1) {
+        Com_Printf("Usage: %s [passes]\n", Cmd_Argv(0));
+        return;
+    }
+
+    msgtest_seed = 0x6b8b4567;
+    ref_write = ref_read = new_write = new_read = 0;
+    bytes = 0;
+    errors = 0;
+
+    for (pass = 0; pass < passes && errors < 10; pass++) {
+        for (i = 0; i < MSGTEST_BITFIELDS; i++) {
+            // mostly small fields like the usercmd codec emits
+            widths[i] = msgtest_range(1, (msgtest_rand() & 7) ? 16 : 32);
+            if (widths[i] < 32 && (msgtest_rand() & 1))
+                widths[i] = -widths[i];
+            values[i] = msgtest_rand();
+        }
+
+        t = Sys_Microseconds();
+        bitpos = 0;
+        for (i = 0; i < MSGTEST_BITFIELDS; i++)
+            msgtest_ref_write_bits(ref, &bitpos, values[i], widths[i]);
+        ref_write += Sys_Microseconds() - t;
+
+        SZ_Clear(&msg_write);
+        t = Sys_Microseconds();
+        for (i = 0; i < MSGTEST_BITFIELDS; i++)
+            MSG_WriteBits(values[i], widths[i]);
+        new_write += Sys_Microseconds() - t;
+        bytes += msg_write.cursize;
+
+        if (msg_write.cursize != (bitpos + 7) >> 3 || memcmp(ref, msg_write.data, msg_write.cursize)) {
+            Com_EPrintf("pass %d: output differs from reference\n", pass);
+            errors++;
+            continue;
+        }
+
+        t = Sys_Microseconds();
+        bitpos = 0;
+        for (i = 0; i < MSGTEST_BITFIELDS; i++)
+            values[i] = msgtest_ref_read_bits(ref, &bitpos, widths[i]);
+        ref_read += Sys_Microseconds() - t;
+
+        msgtest_load_read();
+        t = Sys_Microseconds();
+        for (i = 0; i < MSGTEST_BITFIELDS; i++) {
+            value = MSG_ReadBits(widths[i]);
+            if (value != values[i]) {
+                Com_EPrintf("pass %d: field %d (%d bits): got %#x, expected %#x\n",
+                            pass, i, widths[i], value, values[i]);
+                errors++;
+                break;
+            }
+        }
+        new_read += Sys_Microseconds() - t;
+    }
+
+    SZ_Clear(&msg_write);
+    SZ_Init(&msg_read, msg_read_buffer, sizeof(msg_read_buffer));
+
+    Com_Printf("%d failures, %d passes, %d fields/pass, %.1f bytes/pass\n",
+               errors, pass, MSGTEST_BITFIELDS, (double)bytes / pass);
+    Com_Printf("write: %.3f ms reference, %.3f ms current\n", ref_write * 1e-3, new_write * 1e-3);
+    Com_Printf("read: %.3f ms reference, %.3f ms current\n", ref_read * 1e-3, new_read * 1e-3);
+}
+
+// feeds the delta parsers with mutated and random data; the parsers
+// must consume it without crashing or reading outside the message
+static void Com_FuzzMsg_f(void)
+{
+    static entity_state_t   base[MSGTEST_ENTITIES];
+    static entity_packed_t  packed[MSGTEST_ENTITIES];
+    static byte             seed_msg[MAX_MSGLEN];
+    entity_state_t  to;
+    player_state_t  ps, from_ps;
+    player_packed_t pps;
+    size_t          seed_len, len;
+    int             i, j, iter, iterations, bits, number, entities;
+    unsigned        start;
+
+    iterations = Cmd_Argc() > 1 ? atoi(Cmd_Argv(1)) : 100000;
+    msgtest_seed = Cmd_Argc() > 2 ? strtoul(Cmd_Argv(2), NULL, 10) : 0;
+    if (iterations < 1) {
+        Com_Printf("Usage: %s [iterations] [seed]\n", Cmd_Argv(0));
+        return;
+    }
+    if (!msgtest_seed)
+        msgtest_seed = 0x9e3779b9;
+
+    // build a valid corpus message to mutate
+    memset(base, 0, sizeof(base));
+    memset(&ps, 0, sizeof(ps));
+    SZ_Clear(&msg_write);
+    for (i = 0; i < MSGTEST_ENTITIES; i++) {
+        base[i].number = msgtest_range(1, MAX_EDICTS - 1);
+        msgtest_mutate_entity(&base[i]);
+        MSG_PackEntity(&packed[i], &base[i], qtrue);
+        MSG_WriteDeltaEntity(NULL, &packed[i], MSGTEST_ES_FLAGS | MSG_ES_FORCE);
+    }
+    MSG_WriteByte(0);
+    msgtest_mutate_player(&ps);
+    MSG_PackPlayer(&pps, &ps);
+    MSG_WriteDeltaPlayerstate_Default(NULL, &pps);
+    seed_len = msg_write.cursize;
+    memcpy(seed_msg, msg_write.data, seed_len);
+
+    memset(&from_ps, 0, sizeof(from_ps));
+    entities = 0;
+    start = Sys_Milliseconds();
+
+    for (iter = 0; iter < iterations; iter++) {
+        SZ_Clear(&msg_write);
+        if (iter & 3) {
+            // flip, overwrite or truncate a few bytes of the corpus
+            len = seed_len;
+            memcpy(msg_write_buffer, seed_msg, len);
+            for (j = msgtest_range(1, 8); j > 0; j--) {
+                i = msgtest_range(0, len - 1);
+                switch (msgtest_rand() & 3) {
+                case 0:
+                    msg_write_buffer[i] ^= 1 << (msgtest_rand() & 7);
+                    break;
+                case 1:
+                    msg_write_buffer[i] = msgtest_rand();
+                    break;
+                case 2:
+                    msg_write_buffer[i] = (msgtest_rand() & 1) ? 0xff : 0;
+                    break;
+                default:
+                    len = i + 1;
+                    break;
+                }
+            }
+        } else {
+            len = msgtest_range(1, 256);
+            for (i = 0; i < len; i++)
+                msg_write_buffer[i] = msgtest_rand();
+        }
+        msg_write.cursize = len;
+        msgtest_load_read();
+
+        // mirror the sanity checks done by CL_ParsePacketEntities
+        for (i = 0; i < MSGTEST_ENTITIES; i++) {
+            number = MSG_ParseEntityBits(&bits);
+            if (number < 1 || number >= MAX_EDICTS)
+                break;
+            if (msg_read.readcount > msg_read.cursize)
+                break;
+            MSG_ParseDeltaEntity(&base[i], &to, number, bits, MSGTEST_ES_FLAGS);
+            entities++;
+        }
+
+        MSG_ParseDeltaPlayerstate_Default(&from_ps, &ps, MSG_ReadWord());
+        MSG_ParseDeltaPlayerstate_Enhanced(&from_ps, &ps, MSG_ReadWord(), msgtest_rand() & 0xff);
+
+        if (msg_read.readcount > msg_read.cursize + MAX_MSGLEN) {
+            Com_EPrintf("iteration %d: parser ran away (%"PRIz" of %"PRIz" bytes)\n",
+                        iter, msg_read.readcount, msg_read.cursize);
+            break;
+        }
+    }
+
+    SZ_Clear(&msg_write);
+    SZ_Init(&msg_read, msg_read_buffer, sizeof(msg_read_buffer));
+
+    Com_Printf("%d iterations, %d entities parsed, %u msec\n",
+               iter, entities, Sys_Milliseconds() - start);
+}
+
+#endif // USE_CLIENT
+
 #if USE_REF
 static void Com_TestModels_f(void)
 {
@@ -536,6 +1249,11 @@ void TST_Init(void)
     Cmd_AddCommand("normtest", Com_TestNorm_f);
     Cmd_AddCommand("infotest", Com_TestInfo_f);
     Cmd_AddCommand("snprintftest", Com_TestSnprintf_f);
+#if USE_CLIENT
+    Cmd_AddCommand("msgtest", Com_TestMsg_f);
+    Cmd_AddCommand("msgfuzz", Com_FuzzMsg_f);
+    Cmd_AddCommand("msgbitstest", Com_TestMsgBits_f);
+#endif
 #if USE_REF
     Cmd_AddCommand("modeltest", Com_TestModels_f);
 #endif
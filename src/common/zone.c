@@ -20,6 +20,8 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include "common/common.h"
 #include "common/zone.h"
 
+#include <SDL_atomic.h>
+
 #define Z_MAGIC     0x1d0d
 #define Z_TAIL      0x5b7b
 
@@ -48,6 +50,9 @@ typedef struct zhead_s {
 
 static zhead_t      z_chain;
 
+// the chain and stats are shared with image decoding threads, see IMG_FindBatch
+static SDL_SpinLock z_lock;
+
 typedef struct {
     zhead_t     z;
     char        data[2];
@@ -157,17 +162,25 @@ void Z_Free(void *ptr)
 
     Z_Validate(z, __func__);
 
+    SDL_AtomicLock(&z_lock);
+
     s = &z_stats[z->tag < TAG_MAX ? z->tag : TAG_FREE];
     s->count--;
     s->bytes -= z->size;
 
-    if (z->tag != TAG_STATIC) {
-        z->prev->next = z->next;
-        z->next->prev = z->prev;
-        z->magic = 0xdead;
-        z->tag = TAG_FREE;
-        free(z);
+    if (z->tag == TAG_STATIC) {
+        SDL_AtomicUnlock(&z_lock);
+        return;
     }
+
+    z->prev->next = z->next;
+    z->next->prev = z->prev;
+    z->magic = 0xdead;
+    z->tag = TAG_FREE;
+
+    SDL_AtomicUnlock(&z_lock);
+
+    free(z);
 }
 
 /*
@@ -197,25 +210,42 @@ void *Z_Realloc(void *ptr, size_t size)
         Com_Error(ERR_FATAL, "%s: couldn't realloc static memory", __func__);
     }
 
-    s = &z_stats[z->tag < TAG_MAX ? z->tag : TAG_FREE];
-    s->bytes -= z->size;
-
     if (size > SIZE_MAX - Z_EXTRA - 3) {
         Com_Error(ERR_FATAL, "%s: bad size", __func__);
     }
 
     size = (size + Z_EXTRA + 3) & ~3;
+
+    // unlink while moving, so other threads never see the old block and
+    // realloc itself runs without holding the lock
+    SDL_AtomicLock(&z_lock);
+
+    z->prev->next = z->next;
+    z->next->prev = z->prev;
+
+    s = &z_stats[z->tag < TAG_MAX ? z->tag : TAG_FREE];
+    s->bytes -= z->size;
+
+    SDL_AtomicUnlock(&z_lock);
+
     z = realloc(z, size);
     if (!z) {
         Com_Error(ERR_FATAL, "%s: couldn't realloc %"PRIz" bytes", __func__, size);
     }
 
     z->size = size;
-    z->prev->next = z;
-    z->next->prev = z;
+
+    SDL_AtomicLock(&z_lock);
+
+    z->next = z_chain.next;
+    z->prev = &z_chain;
+    z_chain.next->prev = z;
+    z_chain.next = z;
 
     s->bytes += size;
 
+    SDL_AtomicUnlock(&z_lock);
+
     Z_TAIL_F(z) = Z_TAIL;
 
     return z + 1;
@@ -309,21 +339,25 @@ void *Z_TagMalloc(size_t size, memtag_t tag)
     z->time = time(NULL);
 #endif
 
-    z->next = z_chain.next;
-    z->prev = &z_chain;
-    z_chain.next->prev = z;
-    z_chain.next = z;
-
     if (z_perturb && z_perturb->integer) {
         memset(z + 1, z_perturb->integer, size - Z_EXTRA);
     }
 
     Z_TAIL_F(z) = Z_TAIL;
 
+    SDL_AtomicLock(&z_lock);
+
+    z->next = z_chain.next;
+    z->prev = &z_chain;
+    z_chain.next->prev = z;
+    z_chain.next = z;
+
     s = &z_stats[tag < TAG_MAX ? tag : TAG_FREE];
     s->count++;
     s->bytes += size;
 
+    SDL_AtomicUnlock(&z_lock);
+
     return z + 1;
 }
 
@@ -0,0 +1,447 @@
+/*
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+//
+// bcn.c -- CPU encoder and decoder for BC1, BC3 and BC5 textures
+//
+// Color blocks take their endpoints from the principal axis of the block,
+// followed by one least squares refinement pass. Single channel blocks
+// (BC3 alpha, BC5 X and Y) use the channel extremes in 8 value mode.
+//
+
+#include "shared/shared.h"
+#include "refresh/bcn.h"
+
+/*
+=================================================================
+
+COLOR BLOCKS
+
+=================================================================
+*/
+
+static inline unsigned pack_565(const float *c)
+{
+    int r = (int)(c[0] * (31.0f / 255.0f) + 0.5f);
+    int g = (int)(c[1] * (63.0f / 255.0f) + 0.5f);
+    int b = (int)(c[2] * (31.0f / 255.0f) + 0.5f);
+
+    clamp(r, 0, 31);
+    clamp(g, 0, 63);
+    clamp(b, 0, 31);
+
+    return (r << 11) | (g << 5) | b;
+}
+
+static inline void unpack_565(int *c, unsigned v)
+{
+    int r = (v >> 11) & 31;
+    int g = (v >> 5) & 63;
+    int b = v & 31;
+
+    c[0] = (r << 3) | (r >> 2);
+    c[1] = (g << 2) | (g >> 4);
+    c[2] = (b << 3) | (b >> 2);
+}
+
+static void color_palette(int pal[4][3], unsigned c0, unsigned c1)
+{
+    int i;
+
+    unpack_565(pal[0], c0);
+    unpack_565(pal[1], c1);
+    for (i = 0; i < 3; i++) {
+        pal[2][i] = (2 * pal[0][i] + pal[1][i]) / 3;
+        pal[3][i] = (pal[0][i] + 2 * pal[1][i]) / 3;
+    }
+}
+
+// picks the nearest palette entry for each texel, returns total error
+static unsigned color_indices(const byte *block, int pal[4][3], byte *idx)
+{
+    unsigned    total = 0, best, d;
+    int         i, j, dr, dg, db;
+
+    for (i = 0; i < 16; i++, block += 4) {
+        best = UINT_MAX;
+        for (j = 0; j < 4; j++) {
+            dr = block[0] - pal[j][0];
+            dg = block[1] - pal[j][1];
+            db = block[2] - pal[j][2];
+            d = dr * dr + dg * dg + db * db;
+            if (d < best) {
+                best = d;
+                idx[i] = j;
+            }
+        }
+        total += best;
+    }
+
+    return total;
+}
+
+// least squares fit of both endpoints to the given indices
+static qboolean refine_endpoints(const byte *block, const byte *idx, float *e0, float *e1)
+{
+    static const float w0[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+    float   aa = 0, bb = 0, ab = 0, ax[3] = { 0 }, bx[3] = { 0 };
+    float   a, b, det;
+    int     i, j;
+
+    for (i = 0; i < 16; i++, block += 4) {
+        a = w0[idx[i]];
+        b = 1.0f - a;
+        aa += a * a;
+        bb += b * b;
+        ab += a * b;
+        for (j = 0; j < 3; j++) {
+            ax[j] += a * block[j];
+            bx[j] += b * block[j];
+        }
+    }
+
+    det = aa * bb - ab * ab;
+    if (fabsf(det) < 1e-6f)
+        return qfalse;
+
+    det = 1.0f / det;
+    for (j = 0; j < 3; j++) {
+        e0[j] = (ax[j] * bb - bx[j] * ab) * det;
+        e1[j] = (bx[j] * aa - ax[j] * ab) * det;
+        clamp(e0[j], 0, 255);
+        clamp(e1[j], 0, 255);
+    }
+
+    return qtrue;
+}
+
+static unsigned encode_endpoints(const byte *block, const float *e0, const float *e1,
+                                 unsigned *c0, unsigned *c1, byte *idx)
+{
+    int pal[4][3];
+
+    *c0 = pack_565(e0);
+    *c1 = pack_565(e1);
+    color_palette(pal, *c0, *c1);
+    return color_indices(block, pal, idx);
+}
+
+static void encode_color_block(byte *out, const byte *block)
+{
+    float       mean[3] = { 0 }, cov[6] = { 0 }, axis[3], v[3], t;
+    float       e0[3], e1[3], lo, hi;
+    byte        idx[16], idx2[16];
+    unsigned    c0, c1, c0b, c1b, err, err2, bits;
+    const byte  *p, *pmin, *pmax;
+    int         i, j;
+
+    for (i = 0, p = block; i < 16; i++, p += 4) {
+        mean[0] += p[0];
+        mean[1] += p[1];
+        mean[2] += p[2];
+    }
+    VectorScale(mean, 1.0f / 16, mean);
+
+    for (i = 0, p = block; i < 16; i++, p += 4) {
+        VectorSubtract(p, mean, v);
+        cov[0] += v[0] * v[0];
+        cov[1] += v[0] * v[1];
+        cov[2] += v[0] * v[2];
+        cov[3] += v[1] * v[1];
+        cov[4] += v[1] * v[2];
+        cov[5] += v[2] * v[2];
+    }
+
+    // principal axis by power iteration
+    VectorSet(axis, 1, 1, 1);
+    for (i = 0; i < 8; i++) {
+        v[0] = cov[0] * axis[0] + cov[1] * axis[1] + cov[2] * axis[2];
+        v[1] = cov[1] * axis[0] + cov[3] * axis[1] + cov[4] * axis[2];
+        v[2] = cov[2] * axis[0] + cov[4] * axis[1] + cov[5] * axis[2];
+        t = max(fabsf(v[0]), max(fabsf(v[1]), fabsf(v[2])));
+        if (t < 1e-6f)
+            break;
+        VectorScale(v, 1.0f / t, axis);
+    }
+
+    pmin = pmax = block;
+    lo = hi = DotProduct(block, axis);
+    for (i = 1, p = block + 4; i < 16; i++, p += 4) {
+        t = DotProduct(p, axis);
+        if (t < lo) {
+            lo = t;
+            pmin = p;
+        }
+        if (t > hi) {
+            hi = t;
+            pmax = p;
+        }
+    }
+
+    // inset the endpoints slightly to reduce error on the extremes
+    for (j = 0; j < 3; j++) {
+        t = (pmax[j] - pmin[j]) / 16.0f;
+        e0[j] = pmax[j] - t;
+        e1[j] = pmin[j] + t;
+    }
+
+    err = encode_endpoints(block, e0, e1, &c0, &c1, idx);
+
+    if (err && refine_endpoints(block, idx, e0, e1)) {
+        err2 = encode_endpoints(block, e0, e1, &c0b, &c1b, idx2);
+        if (err2 < err) {
+            c0 = c0b;
+            c1 = c1b;
+            memcpy(idx, idx2, sizeof(idx));
+        }
+    }
+
+    // keep 4 color mode, which requires c0 > c1
+    if (c0 < c1) {
+        bits = c0; c0 = c1; c1 = bits;
+        for (i = 0; i < 16; i++)
+            idx[i] ^= 1;
+    } else if (c0 == c1) {
+        memset(idx, 0, sizeof(idx));
+    }
+
+    bits = 0;
+    for (i = 0; i < 16; i++)
+        bits |= (unsigned)idx[i] << (i * 2);
+
+    out[0] = c0 & 255;
+    out[1] = c0 >> 8;
+    out[2] = c1 & 255;
+    out[3] = c1 >> 8;
+    out[4] = bits & 255;
+    out[5] = (bits >> 8) & 255;
+    out[6] = (bits >> 16) & 255;
+    out[7] = bits >> 24;
+}
+
+static void decode_color_block(byte *out, int stride, const byte *in, qboolean bc1)
+{
+    int         pal[4][4];
+    unsigned    c0 = LittleShortMem(in + 0);
+    unsigned    c1 = LittleShortMem(in + 2);
+    uint32_t    bits = (uint32_t)LittleShortMem(in + 6) << 16 | LittleShortMem(in + 4);
+    byte        *p;
+    int         i, j, k;
+
+    unpack_565(pal[0], c0);
+    unpack_565(pal[1], c1);
+    pal[0][3] = pal[1][3] = 255;
+    if (c0 > c1 || !bc1) {
+        for (k = 0; k < 3; k++) {
+            pal[2][k] = (2 * pal[0][k] + pal[1][k]) / 3;
+            pal[3][k] = (pal[0][k] + 2 * pal[1][k]) / 3;
+        }
+        pal[2][3] = pal[3][3] = 255;
+    } else {
+        for (k = 0; k < 3; k++) {
+            pal[2][k] = (pal[0][k] + pal[1][k]) / 2;
+            pal[3][k] = 0;
+        }
+        pal[2][3] = 255;
+        pal[3][3] = 0;
+    }
+
+    for (i = 0; i < 4; i++) {
+        p = out + i * stride;
+        for (j = 0; j < 4; j++, p += 4, bits >>= 2) {
+            p[0] = pal[bits & 3][0];
+            p[1] = pal[bits & 3][1];
+            p[2] = pal[bits & 3][2];
+            p[3] = pal[bits & 3][3];
+        }
+    }
+}
+
+/*
+=================================================================
+
+SINGLE CHANNEL BLOCKS
+
+=================================================================
+*/
+
+static void channel_palette(int *pal, int a0, int a1)
+{
+    int i;
+
+    pal[0] = a0;
+    pal[1] = a1;
+    if (a0 > a1) {
+        for (i = 1; i < 7; i++)
+            pal[i + 1] = ((7 - i) * a0 + i * a1) / 7;
+    } else {
+        for (i = 1; i < 5; i++)
+            pal[i + 1] = ((5 - i) * a0 + i * a1) / 5;
+        pal[6] = 0;
+        pal[7] = 255;
+    }
+}
+
+// encodes channel c of an RGBA block
+static void encode_channel_block(byte *out, const byte *block, int c)
+{
+    int         pal[8], lo = 255, hi = 0, i, j, d, best;
+    uint64_t    bits = 0, k;
+
+    for (i = 0; i < 16; i++) {
+        lo = min(lo, block[i * 4 + c]);
+        hi = max(hi, block[i * 4 + c]);
+    }
+
+    out[0] = hi;
+    out[1] = lo;
+
+    if (hi > lo) {
+        channel_palette(pal, hi, lo);
+        for (i = 0; i < 16; i++) {
+            best = INT_MAX;
+            k = 0;
+            for (j = 0; j < 8; j++) {
+                d = abs(block[i * 4 + c] - pal[j]);
+                if (d < best) {
+                    best = d;
+                    k = j;
+                }
+            }
+            bits |= k << (i * 3);
+        }
+    }
+
+    for (i = 0; i < 6; i++)
+        out[2 + i] = bits >> (i * 8);
+}
+
+static void decode_channel_block(byte *out, int stride, const byte *in)
+{
+    int         pal[8], i, j;
+    uint64_t    bits = 0;
+
+    channel_palette(pal, in[0], in[1]);
+    for (i = 0; i < 6; i++)
+        bits |= (uint64_t)in[2 + i] << (i * 8);
+
+    for (i = 0; i < 4; i++)
+        for (j = 0; j < 4; j++, bits >>= 3)
+            out[i * stride + j * 4] = pal[bits & 7];
+}
+
+/*
+=================================================================
+
+IMAGES
+
+=================================================================
+*/
+
+static const int bcn_block_bytes[BCN_MAX] = { 8, 16, 16 };
+
+size_t BCN_ImageSize(bcnformat_t fmt, int width, int height)
+{
+    return (size_t)((width + 3) / 4) * ((height + 3) / 4) * bcn_block_bytes[fmt];
+}
+
+static void fetch_block(byte *block, const byte *rgba, int width, int height, int x, int y)
+{
+    int i, j, sx, sy;
+
+    for (i = 0; i < 4; i++) {
+        sy = min(y + i, height - 1);
+        for (j = 0; j < 4; j++) {
+            sx = min(x + j, width - 1);
+            memcpy(block + (i * 4 + j) * 4, rgba + (sy * width + sx) * 4, 4);
+        }
+    }
+}
+
+void BCN_Compress(bcnformat_t fmt, byte *out, const byte *rgba, int width, int height)
+{
+    byte    block[64];
+    int     x, y;
+
+    for (y = 0; y < height; y += 4) {
+        for (x = 0; x < width; x += 4) {
+            fetch_block(block, rgba, width, height, x, y);
+            switch (fmt) {
+            case BCN_BC1:
+                encode_color_block(out, block);
+                break;
+            case BCN_BC3:
+                encode_channel_block(out, block, 3);
+                encode_color_block(out + 8, block);
+                break;
+            case BCN_BC5:
+                encode_channel_block(out, block, 0);
+                encode_channel_block(out + 8, block, 1);
+                break;
+            default:
+                Com_Error(ERR_FATAL, "%s: bad format", __func__);
+            }
+            out += bcn_block_bytes[fmt];
+        }
+    }
+}
+
+static void reconstruct_z(byte *block)
+{
+    float   x, y, z;
+    int     i;
+
+    for (i = 0; i < 16; i++, block += 4) {
+        x = block[0] * (2.0f / 255.0f) - 1.0f;
+        y = block[1] * (2.0f / 255.0f) - 1.0f;
+        z = 1.0f - x * x - y * y;
+        block[2] = z > 0 ? (int)(sqrtf(z) * 255.0f + 0.5f) : 0;
+        block[3] = 255;
+    }
+}
+
+void BCN_Decompress(bcnformat_t fmt, byte *rgba, const byte *in, int width, int height)
+{
+    byte    block[64];
+    int     x, y, i, w, h;
+
+    for (y = 0; y < height; y += 4) {
+        for (x = 0; x < width; x += 4) {
+            switch (fmt) {
+            case BCN_BC1:
+                decode_color_block(block, 16, in, qtrue);
+                break;
+            case BCN_BC3:
+                decode_color_block(block, 16, in + 8, qfalse);
+                decode_channel_block(block + 3, 16, in);
+                break;
+            case BCN_BC5:
+                decode_channel_block(block + 0, 16, in);
+                decode_channel_block(block + 1, 16, in + 8);
+                reconstruct_z(block);
+                break;
+            default:
+                Com_Error(ERR_FATAL, "%s: bad format", __func__);
+            }
+            in += bcn_block_bytes[fmt];
+
+            w = min(width - x, 4);
+            h = min(height - y, 4);
+            for (i = 0; i < h; i++)
+                memcpy(rgba + ((y + i) * width + x) * 4, block + i * 16, w * 4);
+        }
+    }
+}
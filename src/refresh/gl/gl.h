@@ -180,6 +180,7 @@ extern cvar_t *gl_test;
 #endif
 extern cvar_t *gl_cull_nodes;
 extern cvar_t *gl_hash_faces;
+extern cvar_t *gl_lightmap_threads;
 extern cvar_t *gl_clear;
 extern cvar_t *gl_novis;
 extern cvar_t *gl_lockpvs;
@@ -256,9 +257,7 @@ typedef struct maliasmesh_s {
 #define LM_BLOCK_HEIGHT     256
 
 typedef struct {
-    int         inuse[LM_BLOCK_WIDTH];
-    byte        buffer[LM_BLOCK_WIDTH * LM_BLOCK_HEIGHT * 4];
-    qboolean    dirty;
+    qboolean    dirty;      // rebuild all lightmaps next frame
     int         comp;
     float       add, modulate, scale;
     int         nummaps;
@@ -269,6 +268,9 @@ extern lightmap_builder_t lm;
 
 void GL_AdjustColor(vec3_t color);
 void GL_PushLights(mface_t *surf);
+void GL_BeginLights(void);
+void GL_EndLights(void);
+void GL_LightBench_f(void);
 
 void GL_RebuildLighting(void);
 void GL_FreeWorld(void);
@@ -73,6 +73,7 @@ cvar_t *gl_cull_models;
 cvar_t *gl_clear;
 cvar_t *gl_finish;
 cvar_t *gl_hash_faces;
+cvar_t *gl_lightmap_threads;
 cvar_t *gl_novis;
 cvar_t *gl_lockpvs;
 cvar_t *gl_lightmap;
@@ -780,6 +781,7 @@ static void GL_Register(void)
     gl_cull_nodes = Cvar_Get("gl_cull_nodes", "1", 0);
     gl_cull_models = Cvar_Get("gl_cull_models", "1", 0);
     gl_hash_faces = Cvar_Get("gl_hash_faces", "1", 0);
+    gl_lightmap_threads = Cvar_Get("gl_lightmap_threads", "0", 0);
     gl_clear = Cvar_Get("gl_clear", "0", 0);
     gl_finish = Cvar_Get("gl_finish", "0", 0);
     gl_novis = Cvar_Get("gl_novis", "0", 0);
@@ -797,12 +799,14 @@ static void GL_Register(void)
     gl_modulate_entities_changed(NULL);
 
     Cmd_AddCommand("strings", GL_Strings_f);
+    Cmd_AddCommand("lightbench", GL_LightBench_f);
     Cmd_AddMacro("gl_viewcluster", GL_ViewCluster_m);
 }
 
 static void GL_Unregister(void)
 {
     Cmd_RemoveCommand("strings");
+    Cmd_RemoveCommand("lightbench");
 }
 
 static qboolean GL_SetupConfig(void)
@@ -17,6 +17,7 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 */
 
 #include "gl.h"
+#include "refresh/lerp.h"
 
 typedef void (*tessfunc_t)(const maliasmesh_t *);
 
@@ -178,18 +179,15 @@ static void tess_lerped_shell(const maliasmesh_t *mesh)
     int count = mesh->numverts;
     vec3_t normal;
 
+    R_LerpVerts16(dst_vert, 4, src_oldvert, src_newvert, count,
+                  oldscale, newscale, translate);
+
     while (count--) {
         get_lerped_normal(normal, src_oldvert, src_newvert);
 
-        dst_vert[0] = normal[0] * shellscale +
-                      src_oldvert->pos[0] * oldscale[0] +
-                      src_newvert->pos[0] * newscale[0] + translate[0];
-        dst_vert[1] = normal[1] * shellscale +
-                      src_oldvert->pos[1] * oldscale[1] +
-                      src_newvert->pos[1] * newscale[1] + translate[1];
-        dst_vert[2] = normal[2] * shellscale +
-                      src_oldvert->pos[2] * oldscale[2] +
-                      src_newvert->pos[2] * newscale[2] + translate[2];
+        dst_vert[0] += normal[0] * shellscale;
+        dst_vert[1] += normal[1] * shellscale;
+        dst_vert[2] += normal[2] * shellscale;
         dst_vert += 4;
 
         src_oldvert++;
@@ -206,18 +204,12 @@ static void tess_lerped_shade(const maliasmesh_t *mesh)
     vec3_t normal;
     vec_t d;
 
+    R_LerpVerts16(dst_vert, VERTEX_SIZE, src_oldvert, src_newvert, count,
+                  oldscale, newscale, translate);
+
     while (count--) {
         d = shadedot(get_lerped_normal(normal, src_oldvert, src_newvert));
 
-        dst_vert[0] =
-            src_oldvert->pos[0] * oldscale[0] +
-            src_newvert->pos[0] * newscale[0] + translate[0];
-        dst_vert[1] =
-            src_oldvert->pos[1] * oldscale[1] +
-            src_newvert->pos[1] * newscale[1] + translate[1];
-        dst_vert[2] =
-            src_oldvert->pos[2] * oldscale[2] +
-            src_newvert->pos[2] * newscale[2] + translate[2];
         dst_vert[4] = shadelight[0] * d;
         dst_vert[5] = shadelight[1] * d;
         dst_vert[6] = shadelight[2] * d;
@@ -231,26 +223,10 @@ static void tess_lerped_shade(const maliasmesh_t *mesh)
 
 static void tess_lerped_plain(const maliasmesh_t *mesh)
 {
-    maliasvert_t *src_oldvert = &mesh->verts[oldframenum * mesh->numverts];
-    maliasvert_t *src_newvert = &mesh->verts[newframenum * mesh->numverts];
-    vec_t *dst_vert = tess.vertices;
-    int count = mesh->numverts;
-
-    while (count--) {
-        dst_vert[0] =
-            src_oldvert->pos[0] * oldscale[0] +
-            src_newvert->pos[0] * newscale[0] + translate[0];
-        dst_vert[1] =
-            src_oldvert->pos[1] * oldscale[1] +
-            src_newvert->pos[1] * newscale[1] + translate[1];
-        dst_vert[2] =
-            src_oldvert->pos[2] * oldscale[2] +
-            src_newvert->pos[2] * newscale[2] + translate[2];
-        dst_vert += 4;
-
-        src_oldvert++;
-        src_newvert++;
-    }
+    R_LerpVerts16(tess.vertices, 4,
+                  &mesh->verts[oldframenum * mesh->numverts],
+                  &mesh->verts[newframenum * mesh->numverts],
+                  mesh->numverts, oldscale, newscale, translate);
 }
 
 static glCullResult_t cull_static_model(model_t *model)
@@ -21,6 +21,16 @@ with this program; if not, write to the Free Software Foundation, Inc.,
  *
  */
 #include "gl.h"
+#include "system/system.h"
+
+#include <SDL_atomic.h>
+#include <SDL_cpuinfo.h>
+#include <SDL_mutex.h>
+#include <SDL_thread.h>
+
+#if USE_SSE2
+#include <emmintrin.h>
+#endif
 
 lightmap_builder_t lm;
 
@@ -109,10 +119,61 @@ DYNAMIC BLOCKLIGHTS
 #define MAX_LIGHTMAP_EXTENTS    ((MAX_SURFACE_EXTENTS >> 4) + 1)
 #define MAX_BLOCKLIGHTS         (MAX_LIGHTMAP_EXTENTS * MAX_LIGHTMAP_EXTENTS)
 
-static float blocklights[MAX_BLOCKLIGHTS * 3];
+#define MAX_LIGHTMAP_THREADS    16
+
+// minimum number of texels given to each compositing thread, smaller
+// updates are not worth the wakeup cost
+#define LM_THREAD_TEXELS        16384
+
+// used by the calling thread, workers have their own in lm_workers
+static float lm_blocklights[MAX_BLOCKLIGHTS * 3];
+
+typedef struct {
+    mface_t     *surf;
+    byte        *dst;
+    int         stride;
+} lmjob_t;
+
+typedef struct {
+    lmjob_t         *jobs;
+    int             numjobs;
+    qboolean        dynamic;
+    SDL_atomic_t    next;
+} lmbatch_t;
+
+// surfaces queued by GL_PushLights between GL_BeginLights and GL_EndLights
+static struct {
+    qboolean    active;
+    lmjob_t     *jobs;
+    int         numjobs, maxjobs;
+    int         texels;
+    byte        *buffer;
+    int         buffersize;
+} lm_queue;
+
+// compositing threads are started on first use and kept until the world is
+// freed, each one owns its blocklights so no allocation happens per frame
+typedef struct {
+    SDL_Thread  *thread;
+    float       *blocklights;
+    int         generation;
+} lmworker_t;
+
+static struct {
+    SDL_mutex   *lock;
+    SDL_cond    *wake;
+    SDL_cond    *done;
+    lmworker_t  workers[MAX_LIGHTMAP_THREADS];
+    int         numworkers;
+    lmbatch_t   *batch;
+    int         numactive;
+    int         pending;
+    int         generation;
+    qboolean    quit;
+} lm_pool;
 
 #if USE_DLIGHTS
-static void add_dynamic_lights(mface_t *surf)
+static void add_dynamic_lights(mface_t *surf, float *blocklights)
 {
     dlight_t    *light;
     mtexinfo_t  *tex;
@@ -174,41 +235,99 @@ static void add_dynamic_lights(mface_t *surf)
 }
 #endif
 
-static void add_light_styles(mface_t *surf, int size)
+// bl = src * rgb for the first style, bl += src * rgb for the rest
+#if USE_SSE2
+static void add_light_style(float *bl, const byte *src, int size,
+                            const vec3_t rgb, qboolean first)
 {
-    lightstyle_t *style;
-    byte *src;
-    float *bl;
-    int i, j;
+    __m128i zero = _mm_setzero_si128();
+    __m128 c0 = _mm_setr_ps(rgb[0], rgb[1], rgb[2], rgb[0]);
+    __m128 c1 = _mm_setr_ps(rgb[1], rgb[2], rgb[0], rgb[1]);
+    __m128 c2 = _mm_setr_ps(rgb[2], rgb[0], rgb[1], rgb[2]);
+    __m128i v, w0, w1;
+    __m128 f0, f1, f2;
+    uint32_t last;
+
+    // four texels (12 bytes) per iteration, without reading past the end
+    for (; size >= 4; size -= 4, src += 12, bl += 12) {
+        memcpy(&last, src + 8, sizeof(last));
+        v = _mm_unpacklo_epi64(_mm_loadl_epi64((const __m128i *)src),
+                               _mm_cvtsi32_si128(last));
+        w0 = _mm_unpacklo_epi8(v, zero);
+        w1 = _mm_unpackhi_epi8(v, zero);
+        f0 = _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(w0, zero)), c0);
+        f1 = _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(w0, zero)), c1);
+        f2 = _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(w1, zero)), c2);
+
+        if (!first) {
+            f0 = _mm_add_ps(f0, _mm_loadu_ps(bl + 0));
+            f1 = _mm_add_ps(f1, _mm_loadu_ps(bl + 4));
+            f2 = _mm_add_ps(f2, _mm_loadu_ps(bl + 8));
+        }
 
-    if (!surf->numstyles) {
-        // should this ever happen?
-        memset(blocklights, 0, sizeof(blocklights[0]) * size * 3);
-        return;
+        _mm_storeu_ps(bl + 0, f0);
+        _mm_storeu_ps(bl + 4, f1);
+        _mm_storeu_ps(bl + 8, f2);
     }
 
-    // init primary lightmap
-    style = LIGHT_STYLE(surf, 0);
+    for (; size; size--, src += 3, bl += 3) {
+        if (first) {
+            bl[0] = src[0] * rgb[0];
+            bl[1] = src[1] * rgb[1];
+            bl[2] = src[2] * rgb[2];
+        } else {
+            bl[0] += src[0] * rgb[0];
+            bl[1] += src[1] * rgb[1];
+            bl[2] += src[2] * rgb[2];
+        }
+    }
+}
+#else
+static void add_light_style(float *bl, const byte *src, int size,
+                            const vec3_t rgb, qboolean first)
+{
+    int j;
 
-    src = surf->lightmap;
-    bl = blocklights;
-    if (style->white == 1) {
+    if (first) {
         for (j = 0; j < size; j++) {
-            bl[0] = src[0];
-            bl[1] = src[1];
-            bl[2] = src[2];
+            bl[0] = src[0] * rgb[0];
+            bl[1] = src[1] * rgb[1];
+            bl[2] = src[2] * rgb[2];
 
             bl += 3; src += 3;
         }
     } else {
         for (j = 0; j < size; j++) {
-            bl[0] = src[0] * style->rgb[0];
-            bl[1] = src[1] * style->rgb[1];
-            bl[2] = src[2] * style->rgb[2];
+            bl[0] += src[0] * rgb[0];
+            bl[1] += src[1] * rgb[1];
+            bl[2] += src[2] * rgb[2];
 
             bl += 3; src += 3;
         }
     }
+}
+#endif
+
+static void add_light_styles(mface_t *surf, float *blocklights, int size)
+{
+    static const vec3_t white = { 1, 1, 1 };
+    lightstyle_t *style;
+    byte *src;
+    int i;
+
+    if (!surf->numstyles) {
+        // should this ever happen?
+        memset(blocklights, 0, sizeof(blocklights[0]) * size * 3);
+        return;
+    }
+
+    // init primary lightmap
+    style = LIGHT_STYLE(surf, 0);
+
+    src = surf->lightmap;
+    add_light_style(blocklights, src, size,
+                    style->white == 1 ? white : style->rgb, qtrue);
+    src += size * 3;
 
     surf->stylecache[0] = style->white;
 
@@ -216,36 +335,32 @@ static void add_light_styles(mface_t *surf, int size)
     for (i = 1; i < surf->numstyles; i++) {
         style = LIGHT_STYLE(surf, i);
 
-        bl = blocklights;
-        for (j = 0; j < size; j++) {
-            bl[0] += src[0] * style->rgb[0];
-            bl[1] += src[1] * style->rgb[1];
-            bl[2] += src[2] * style->rgb[2];
-
-            bl += 3; src += 3;
-        }
+        add_light_style(blocklights, src, size, style->rgb, qfalse);
+        src += size * 3;
 
         surf->stylecache[i] = style->white;
     }
 }
 
-static void update_dynamic_lightmap(mface_t *surf)
+// composites all styles (and dynamic lights, if requested) of the surface
+// into texture format. safe to call from worker threads.
+static void composite_lightmap(mface_t *surf, float *blocklights,
+                               byte *dst, int stride, qboolean dynamic)
 {
-    byte temp[MAX_BLOCKLIGHTS * 4], *dst;
-    int smax, tmax, size, i;
+    byte *ptr;
+    int smax, tmax, i, j;
     float *bl;
 
     smax = S_MAX(surf);
     tmax = T_MAX(surf);
-    size = smax * tmax;
 
     // add all the lightmaps
-    add_light_styles(surf, size);
+    add_light_styles(surf, blocklights, smax * tmax);
 
 #if USE_DLIGHTS
     // add all the dynamic lights
-    if (surf->dlightframe == glr.dlightframe) {
-        add_dynamic_lights(surf);
+    if (dynamic && surf->dlightframe == glr.dlightframe) {
+        add_dynamic_lights(surf, blocklights);
     } else {
         surf->dlightframe = 0;
     }
@@ -253,21 +368,198 @@ static void update_dynamic_lightmap(mface_t *surf)
 
     // put into texture format
     bl = blocklights;
-    dst = temp;
-    for (i = 0; i < size; i++) {
-        adjust_color_ub(dst, bl);
-        bl += 3; dst += 4;
+    for (i = 0; i < tmax; i++) {
+        ptr = dst;
+        for (j = 0; j < smax; j++) {
+            adjust_color_ub(ptr, bl);
+            bl += 3; ptr += 4;
+        }
+
+        dst += stride;
     }
+}
+
+static void composite_jobs(lmbatch_t *batch, float *blocklights)
+{
+    lmjob_t *job;
+    int i;
+
+    while ((i = SDL_AtomicAdd(&batch->next, 1)) < batch->numjobs) {
+        job = &batch->jobs[i];
+        composite_lightmap(job->surf, blocklights, job->dst, job->stride, batch->dynamic);
+    }
+}
+
+static int SDLCALL composite_thread(void *arg)
+{
+    lmworker_t *w = arg;
+    int index = w - lm_pool.workers;
+    lmbatch_t *batch;
+
+    SDL_LockMutex(lm_pool.lock);
+    while (1) {
+        while (!lm_pool.quit && w->generation == lm_pool.generation) {
+            SDL_CondWait(lm_pool.wake, lm_pool.lock);
+        }
+        if (lm_pool.quit) {
+            break;
+        }
+        w->generation = lm_pool.generation;
+        if (index >= lm_pool.numactive) {
+            continue;
+        }
+        batch = lm_pool.batch;
+        SDL_UnlockMutex(lm_pool.lock);
+
+        composite_jobs(batch, w->blocklights);
+
+        SDL_LockMutex(lm_pool.lock);
+        if (--lm_pool.pending == 0) {
+            SDL_CondSignal(lm_pool.done);
+        }
+    }
+    SDL_UnlockMutex(lm_pool.lock);
+    return 0;
+}
+
+// starts worker threads until numworkers are running, returns how many are
+static int start_workers(int numworkers)
+{
+    lmworker_t *w;
+
+    if (!lm_pool.lock) {
+        lm_pool.lock = SDL_CreateMutex();
+        lm_pool.wake = SDL_CreateCond();
+        lm_pool.done = SDL_CreateCond();
+        if (!lm_pool.lock || !lm_pool.wake || !lm_pool.done) {
+            return 0;
+        }
+    }
+
+    while (lm_pool.numworkers < numworkers) {
+        w = &lm_pool.workers[lm_pool.numworkers];
+        w->blocklights = Z_Malloc(sizeof(lm_blocklights));
+        w->generation = lm_pool.generation;
+        w->thread = SDL_CreateThread(composite_thread, "lightmap compositor", w);
+        if (!w->thread) {
+            // thread creation failure only costs speed
+            Z_Free(w->blocklights);
+            w->blocklights = NULL;
+            break;
+        }
+        lm_pool.numworkers++;
+    }
+
+    return lm_pool.numworkers;
+}
+
+static void stop_workers(void)
+{
+    int i;
 
+    if (lm_pool.lock) {
+        SDL_LockMutex(lm_pool.lock);
+        lm_pool.quit = qtrue;
+        SDL_CondBroadcast(lm_pool.wake);
+        SDL_UnlockMutex(lm_pool.lock);
+    }
+
+    for (i = 0; i < lm_pool.numworkers; i++) {
+        SDL_WaitThread(lm_pool.workers[i].thread, NULL);
+        Z_Free(lm_pool.workers[i].blocklights);
+    }
+
+    if (lm_pool.done)
+        SDL_DestroyCond(lm_pool.done);
+    if (lm_pool.wake)
+        SDL_DestroyCond(lm_pool.wake);
+    if (lm_pool.lock)
+        SDL_DestroyMutex(lm_pool.lock);
+
+    memset(&lm_pool, 0, sizeof(lm_pool));
+}
+
+static int lightmap_threads(int texels)
+{
+    int numthreads = gl_lightmap_threads->integer;
+
+    if (numthreads < 1) {
+        numthreads = SDL_GetCPUCount();
+    }
+    clamp(numthreads, 1, MAX_LIGHTMAP_THREADS);
+    return min(numthreads, texels / LM_THREAD_TEXELS + 1);
+}
+
+static void composite_batch(lmbatch_t *batch, int numthreads)
+{
+    int numworkers;
+
+    SDL_AtomicSet(&batch->next, 0);
+
+    clamp(numthreads, 1, MAX_LIGHTMAP_THREADS);
+    numthreads = min(numthreads, batch->numjobs);
+
+    numworkers = 0;
+    if (numthreads > 1) {
+        numworkers = start_workers(numthreads - 1);
+        numworkers = min(numworkers, numthreads - 1);
+    }
+
+    if (numworkers) {
+        SDL_LockMutex(lm_pool.lock);
+        lm_pool.batch = batch;
+        lm_pool.numactive = numworkers;
+        lm_pool.pending = numworkers;
+        lm_pool.generation++;
+        SDL_CondBroadcast(lm_pool.wake);
+        SDL_UnlockMutex(lm_pool.lock);
+    }
+
+    // this thread composites too
+    composite_jobs(batch, lm_blocklights);
+
+    if (numworkers) {
+        SDL_LockMutex(lm_pool.lock);
+        while (lm_pool.pending) {
+            SDL_CondWait(lm_pool.done, lm_pool.lock);
+        }
+        lm_pool.batch = NULL;
+        SDL_UnlockMutex(lm_pool.lock);
+    }
+}
+
+static void upload_dynamic_lightmap(mface_t *surf, const byte *data)
+{
     // upload lightmap subimage
     GL_ForceTexture(1, surf->texnum[1]);
     qglTexSubImage2D(GL_TEXTURE_2D, 0,
-                     surf->light_s, surf->light_t, smax, tmax,
-                     GL_RGBA, GL_UNSIGNED_BYTE, temp);
+                     surf->light_s, surf->light_t, S_MAX(surf), T_MAX(surf),
+                     GL_RGBA, GL_UNSIGNED_BYTE, data);
 
     c.texUploads++;
 }
 
+static void update_dynamic_lightmap(mface_t *surf)
+{
+    byte temp[MAX_BLOCKLIGHTS * 4];
+    lmjob_t *job;
+
+    if (lm_queue.active) {
+        if (lm_queue.numjobs == lm_queue.maxjobs) {
+            lm_queue.maxjobs = max(lm_queue.maxjobs * 2, 256);
+            lm_queue.jobs = Z_Realloc(lm_queue.jobs, lm_queue.maxjobs * sizeof(lm_queue.jobs[0]));
+        }
+        job = &lm_queue.jobs[lm_queue.numjobs++];
+        job->surf = surf;
+        job->stride = S_MAX(surf) * 4;
+        lm_queue.texels += S_MAX(surf) * T_MAX(surf);
+        return;
+    }
+
+    composite_lightmap(surf, lm_blocklights, temp, S_MAX(surf) * 4, qtrue);
+    upload_dynamic_lightmap(surf, temp);
+}
+
 void GL_PushLights(mface_t *surf)
 {
     lightstyle_t *style;
@@ -301,6 +593,64 @@ void GL_PushLights(mface_t *surf)
     }
 }
 
+// queues lightmap updates from GL_PushLights instead of doing them
+// immediately. only valid while nothing is drawn with the queued surfaces.
+void GL_BeginLights(void)
+{
+    lm_queue.active = qtrue;
+    lm_queue.numjobs = 0;
+    lm_queue.texels = 0;
+}
+
+// composites all queued lightmaps, on worker threads when there are enough
+// of them, then uploads each surface rectangle
+void GL_EndLights(void)
+{
+    lmbatch_t batch;
+    lmjob_t *job;
+    byte *dst;
+    int i;
+
+    lm_queue.active = qfalse;
+
+    if (!lm_queue.numjobs) {
+        return;
+    }
+
+    if (lm_queue.buffersize < lm_queue.texels * 4) {
+        lm_queue.buffersize = lm_queue.texels * 4;
+        Z_Free(lm_queue.buffer);
+        lm_queue.buffer = Z_Malloc(lm_queue.buffersize);
+    }
+
+    dst = lm_queue.buffer;
+    for (i = 0, job = lm_queue.jobs; i < lm_queue.numjobs; i++, job++) {
+        job->dst = dst;
+        dst += job->stride * T_MAX(job->surf);
+    }
+
+    batch.jobs = lm_queue.jobs;
+    batch.numjobs = lm_queue.numjobs;
+    batch.dynamic = qtrue;
+    composite_batch(&batch, lightmap_threads(lm_queue.texels));
+
+    for (i = 0, job = lm_queue.jobs; i < lm_queue.numjobs; i++, job++) {
+        upload_dynamic_lightmap(job->surf, job->dst);
+    }
+
+    lm_queue.numjobs = 0;
+    lm_queue.texels = 0;
+}
+
+static void LM_FreeQueue(void)
+{
+    stop_workers();
+
+    Z_Free(lm_queue.jobs);
+    Z_Free(lm_queue.buffer);
+    memset(&lm_queue, 0, sizeof(lm_queue));
+}
+
 /*
 =============================================================================
 
@@ -309,31 +659,97 @@ LIGHTMAPS BUILDING
 =============================================================================
 */
 
-#define LM_AllocBlock(w, h, s, t) \
-    GL_AllocBlock(LM_BLOCK_WIDTH, LM_BLOCK_HEIGHT, lm.inuse, w, h, s, t)
+#define LM_PAGE_SIZE    (LM_BLOCK_WIDTH * LM_BLOCK_HEIGHT * 4)
+
+// skyline of a lightmap page: the top edge of the allocated area as a list
+// of horizontal segments, left to right, covering the whole page width
+typedef struct {
+    int     numnodes;
+    struct {
+        short   x, y, w;
+    } nodes[LM_BLOCK_WIDTH];
+} lmskyline_t;
 
-static void LM_InitBlock(void)
+static void LM_InitSkyline(lmskyline_t *sky)
 {
-    int i;
+    sky->numnodes = 1;
+    sky->nodes[0].x = 0;
+    sky->nodes[0].y = 0;
+    sky->nodes[0].w = LM_BLOCK_WIDTH;
+}
 
-    for (i = 0; i < LM_BLOCK_WIDTH; i++) {
-        lm.inuse[i] = 0;
+// bottom-left placement: lowest resulting top edge, ties go to the
+// narrowest segment to leave wider gaps for later blocks
+static qboolean LM_AllocSkyline(lmskyline_t *sky, int w, int h, int *s, int *t)
+{
+    int i, j, k, x, y, top, best, besttop, bestw, besty;
+
+    best = -1;
+    besttop = besty = bestw = 0;
+
+    for (i = 0; i < sky->numnodes; i++) {
+        x = sky->nodes[i].x;
+        if (x + w > LM_BLOCK_WIDTH) {
+            break;
+        }
+
+        y = 0;
+        for (j = i; j < sky->numnodes && sky->nodes[j].x < x + w; j++) {
+            y = max(y, sky->nodes[j].y);
+        }
+
+        top = y + h;
+        if (top > LM_BLOCK_HEIGHT) {
+            continue;
+        }
+
+        if (best == -1 || top < besttop ||
+            (top == besttop && sky->nodes[i].w < bestw)) {
+            best = i;
+            besttop = top;
+            besty = y;
+            bestw = sky->nodes[i].w;
+        }
     }
 
-    lm.dirty = qfalse;
-}
+    if (best == -1) {
+        return qfalse;
+    }
 
-static void LM_UploadBlock(void)
-{
-    if (!lm.dirty) {
-        return;
+    x = sky->nodes[best].x;
+
+    // find the first segment not fully covered by the new one and trim it
+    for (k = best; k < sky->numnodes; k++) {
+        if (sky->nodes[k].x + sky->nodes[k].w > x + w) {
+            break;
+        }
+    }
+    if (k < sky->numnodes && sky->nodes[k].x < x + w) {
+        sky->nodes[k].w -= x + w - sky->nodes[k].x;
+        sky->nodes[k].x = x + w;
+    }
+
+    // replace covered segments with the new one
+    memmove(&sky->nodes[best + 1], &sky->nodes[k],
+            (sky->numnodes - k) * sizeof(sky->nodes[0]));
+    sky->numnodes += 1 - (k - best);
+    sky->nodes[best].x = x;
+    sky->nodes[best].y = besttop;
+    sky->nodes[best].w = w;
+
+    // merge neighbours of equal height
+    for (i = j = 0; i < sky->numnodes; i++) {
+        if (j && sky->nodes[j - 1].y == sky->nodes[i].y) {
+            sky->nodes[j - 1].w += sky->nodes[i].w;
+        } else {
+            sky->nodes[j++] = sky->nodes[i];
+        }
     }
+    sky->numnodes = j;
 
-    GL_ForceTexture(1, lm.texnums[lm.nummaps++]);
-    qglTexImage2D(GL_TEXTURE_2D, 0, lm.comp, LM_BLOCK_WIDTH, LM_BLOCK_HEIGHT, 0,
-                  GL_RGBA, GL_UNSIGNED_BYTE, lm.buffer);
-    qglTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    qglTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    *s = x;
+    *t = besty;
+    return qtrue;
 }
 
 static void build_style_map(int dynamic)
@@ -371,18 +787,12 @@ static void LM_BeginBuilding(void)
     // they are merely reused
     lm.nummaps = 0;
 
-    LM_InitBlock();
-
     // start up with fullbright styles
     build_style_map(0);
 }
 
 static void LM_EndBuilding(void)
 {
-    // upload the last lightmap
-    LM_UploadBlock();
-    LM_InitBlock();
-
     // vertex lighting implies fullbright styles
     if (gl_fullbright->integer || gl_vertexlight->integer)
         return;
@@ -393,74 +803,131 @@ static void LM_EndBuilding(void)
     Com_DPrintf("%s: %d lightmaps built\n", __func__, lm.nummaps);
 }
 
-static void build_primary_lightmap(mface_t *surf)
+// composites surfaces into cleared lightmap pages in parallel and uploads
+// all pages. surfaces must already have their blocks allocated.
+static void LM_BuildPages(mface_t **surfs, int count)
 {
-    byte *ptr, *dst;
-    int smax, tmax, size, i, j;
-    float *bl;
+    lmbatch_t batch;
+    lmjob_t *job;
+    mface_t *surf;
+    byte *pages;
+    int i, page, texels;
 
-    smax = S_MAX(surf);
-    tmax = T_MAX(surf);
-    size = smax * tmax;
+    if (!lm.nummaps) {
+        return;
+    }
 
-    // add all the lightmaps
-    add_light_styles(surf, size);
+    pages = Z_Mallocz(lm.nummaps * LM_PAGE_SIZE);
+    batch.jobs = Z_Malloc(count * sizeof(batch.jobs[0]));
+    batch.numjobs = 0;
+    batch.dynamic = qfalse;
+    texels = 0;
+
+    for (i = 0; i < count; i++) {
+        surf = surfs[i];
+        for (page = 0; page < lm.nummaps; page++) {
+            if (lm.texnums[page] == surf->texnum[1]) {
+                break;
+            }
+        }
+        if (page == lm.nummaps) {
+            continue;
+        }
 
-#if USE_DLIGHTS
-    surf->dlightframe = 0;
-#endif
+        job = &batch.jobs[batch.numjobs++];
+        job->surf = surf;
+        job->dst = pages + page * LM_PAGE_SIZE +
+                   ((surf->light_t * LM_BLOCK_WIDTH + surf->light_s) << 2);
+        job->stride = LM_BLOCK_WIDTH * 4;
+        texels += S_MAX(surf) * T_MAX(surf);
+    }
 
-    // put into texture format
-    bl = blocklights;
-    dst = &lm.buffer[(surf->light_t * LM_BLOCK_WIDTH + surf->light_s) << 2];
-    for (i = 0; i < tmax; i++) {
-        ptr = dst;
-        for (j = 0; j < smax; j++) {
-            adjust_color_ub(ptr, bl);
-            bl += 3; ptr += 4;
-        }
+    composite_batch(&batch, lightmap_threads(texels));
 
-        dst += LM_BLOCK_WIDTH * 4;
+    for (page = 0; page < lm.nummaps; page++) {
+        GL_ForceTexture(1, lm.texnums[page]);
+        qglTexImage2D(GL_TEXTURE_2D, 0, lm.comp, LM_BLOCK_WIDTH, LM_BLOCK_HEIGHT, 0,
+                      GL_RGBA, GL_UNSIGNED_BYTE, pages + page * LM_PAGE_SIZE);
+        qglTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        qglTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        c.texUploads++;
     }
+
+    Com_DPrintf("%s: %d texels in %d pages (%.1f%% used)\n", __func__, texels,
+                lm.nummaps, texels * 100.0f / (lm.nummaps * LM_BLOCK_WIDTH * LM_BLOCK_HEIGHT));
+
+    Z_Free(batch.jobs);
+    Z_Free(pages);
 }
 
-static void LM_BuildSurface(mface_t *surf, vec_t *vbo)
+static int LM_CompareSurfaces(const void *p1, const void *p2)
 {
-    int smax, tmax, s, t;
+    mface_t *s1 = *(mface_t **)p1;
+    mface_t *s2 = *(mface_t **)p2;
 
-    smax = S_MAX(surf);
-    tmax = T_MAX(surf);
+    if (T_MAX(s1) != T_MAX(s2)) {
+        return T_MAX(s2) - T_MAX(s1);
+    }
+    if (S_MAX(s1) != S_MAX(s2)) {
+        return S_MAX(s2) - S_MAX(s1);
+    }
+    return s1 - s2;
+}
 
-    if (!LM_AllocBlock(smax, tmax, &s, &t)) {
-        LM_UploadBlock();
-        if (lm.nummaps == LM_MAX_LIGHTMAPS) {
-            Com_EPrintf("%s: LM_MAX_LIGHTMAPS exceeded\n", __func__);
-            return;
+// packs lightmaps of all given surfaces, tallest first, into as few pages as
+// possible, then builds the pages
+static void LM_BuildSurfaces(mface_t **surfs, int count)
+{
+    lmskyline_t *skylines;
+    mface_t *surf;
+    int i, page, smax, tmax, s, t;
+
+    qsort(surfs, count, sizeof(surfs[0]), LM_CompareSurfaces);
+
+    skylines = Z_Malloc(LM_MAX_LIGHTMAPS * sizeof(skylines[0]));
+
+    for (i = 0; i < count; i++) {
+        surf = surfs[i];
+        smax = S_MAX(surf);
+        tmax = T_MAX(surf);
+
+        for (page = 0; page < lm.nummaps; page++) {
+            if (LM_AllocSkyline(&skylines[page], smax, tmax, &s, &t)) {
+                break;
+            }
         }
-        LM_InitBlock();
-        if (!LM_AllocBlock(smax, tmax, &s, &t)) {
-            Com_EPrintf("%s: LM_AllocBlock(%d, %d) failed\n",
-                        __func__, smax, tmax);
-            return;
+
+        if (page == lm.nummaps) {
+            if (lm.nummaps == LM_MAX_LIGHTMAPS) {
+                Com_EPrintf("%s: LM_MAX_LIGHTMAPS exceeded\n", __func__);
+                break;
+            }
+            LM_InitSkyline(&skylines[page]);
+            if (!LM_AllocSkyline(&skylines[page], smax, tmax, &s, &t)) {
+                Com_EPrintf("%s: LM_AllocSkyline(%d, %d) failed\n",
+                            __func__, smax, tmax);
+                continue;
+            }
+            lm.nummaps++;
         }
-    }
 
-    lm.dirty = qtrue;
+        // store the surface lightmap parameters
+        surf->light_s = s;
+        surf->light_t = t;
+        surf->texnum[1] = lm.texnums[page];
+    }
 
-    // store the surface lightmap parameters
-    surf->light_s = s;
-    surf->light_t = t;
-    surf->texnum[1] = lm.texnums[lm.nummaps];
+    Z_Free(skylines);
 
-    // build the primary lightmap
-    build_primary_lightmap(surf);
+    // build the primary lightmaps
+    LM_BuildPages(surfs, count);
 }
 
 static void LM_RebuildSurfaces(void)
 {
     bsp_t *bsp = gl_static.world.cache;
-    mface_t *surf;
-    int i, texnum;
+    mface_t *surf, **surfs;
+    int i, count;
 
     build_style_map(gl_dynamic->integer);
 
@@ -468,8 +935,8 @@ static void LM_RebuildSurfaces(void)
         return;
     }
 
-    GL_ForceTexture(1, lm.texnums[0]);
-    texnum = lm.texnums[0];
+    surfs = Z_Malloc(bsp->numfaces * sizeof(surfs[0]));
+    count = 0;
 
     for (i = 0, surf = bsp->faces; i < bsp->numfaces; i++, surf++) {
         if (!surf->lightmap) {
@@ -481,27 +948,88 @@ static void LM_RebuildSurfaces(void)
         if (!surf->texnum[1]) {
             continue;
         }
+        surfs[count++] = surf;
+    }
+
+    LM_BuildPages(surfs, count);
+
+    Z_Free(surfs);
+}
 
-        if (surf->texnum[1] != texnum) {
-            // done with previous lightmap
-            qglTexImage2D(GL_TEXTURE_2D, 0, lm.comp,
-                          LM_BLOCK_WIDTH, LM_BLOCK_HEIGHT, 0,
-                          GL_RGBA, GL_UNSIGNED_BYTE, lm.buffer);
-            GL_ForceTexture(1, surf->texnum[1]);
-            texnum = surf->texnum[1];
+/*
+=============================================================================
+
+LIGHTMAP BENCHMARK
 
-            c.texUploads++;
+=============================================================================
+*/
+
+void GL_LightBench_f(void)
+{
+    bsp_t *bsp = gl_static.world.cache;
+    lmbatch_t batch;
+    lmjob_t *job;
+    mface_t *surf;
+    byte *buffer, *dst;
+    uint64_t start, time;
+    int i, j, passes, styles, texels, numthreads[2];
+
+    if (!bsp || !lm.nummaps) {
+        Com_Printf("No lightmapped world loaded\n");
+        return;
+    }
+
+    passes = Cmd_Argc() > 1 ? atoi(Cmd_Argv(1)) : 20;
+    clamp(passes, 1, 1000);
+
+    batch.jobs = Z_Malloc(bsp->numfaces * sizeof(batch.jobs[0]));
+    batch.numjobs = 0;
+    batch.dynamic = qfalse;
+    styles = texels = 0;
+
+    for (i = 0, surf = bsp->faces; i < bsp->numfaces; i++, surf++) {
+        if (!surf->lightmap || !surf->texnum[1] || (surf->drawflags & SURF_NOLM_MASK)) {
+            continue;
         }
+        job = &batch.jobs[batch.numjobs++];
+        job->surf = surf;
+        job->stride = S_MAX(surf) * 4;
+        styles += surf->numstyles;
+        texels += S_MAX(surf) * T_MAX(surf);
+    }
 
-        build_primary_lightmap(surf);
+    buffer = Z_Malloc(texels * 4);
+    dst = buffer;
+    for (i = 0, job = batch.jobs; i < batch.numjobs; i++, job++) {
+        job->dst = dst;
+        dst += job->stride * T_MAX(job->surf);
     }
 
-    // upload the last lightmap
-    qglTexImage2D(GL_TEXTURE_2D, 0, lm.comp,
-                  LM_BLOCK_WIDTH, LM_BLOCK_HEIGHT, 0,
-                  GL_RGBA, GL_UNSIGNED_BYTE, lm.buffer);
+    Com_Printf("%d surfaces, %d styles, %d texels, %d passes\n",
+               batch.numjobs, styles, texels, passes);
 
-    c.texUploads++;
+    // composite only, nothing is uploaded
+    numthreads[0] = 1;
+    numthreads[1] = lightmap_threads(INT_MAX);
+    for (i = 0; i < 2; i++) {
+        if (i && numthreads[i] == 1) {
+            break;
+        }
+        start = Sys_Microseconds();
+        for (j = 0; j < passes; j++) {
+            composite_batch(&batch, numthreads[i]);
+        }
+        time = Sys_Microseconds() - start;
+        Com_Printf("%2d thread(s): %.2f ms per pass, %.0f styles/sec\n",
+                   numthreads[i], time * 1e-3 / passes,
+                   time ? styles * passes * 1e6 / time : 0);
+    }
+
+    Z_Free(buffer);
+    Z_Free(batch.jobs);
+
+    // style caches no longer match the uploaded lightmaps
+    lm.dirty = qtrue;
 }
 
 
@@ -533,12 +1061,11 @@ static void build_surface_poly(mface_t *surf, vec_t *vbo)
     mvertex_t *src_vert;
     medge_t *src_edge;
     mtexinfo_t *texinfo = surf->texinfo;
-    vec2_t scale, tc, mins, maxs;
-    int i, bmins[2], bmaxs[2];
+    vec2_t scale, tc;
+    int i;
     uint32_t color;
 
     surf->texnum[0] = texinfo->image->texnum;
-    surf->texnum[1] = 0;
 
     color = color_for_surface(surf);
 
@@ -566,9 +1093,6 @@ static void build_surface_poly(mface_t *surf, vec_t *vbo)
     scale[0] = 1.0f / texinfo->image->width;
     scale[1] = 1.0f / texinfo->image->height;
 
-    mins[0] = mins[1] = 99999;
-    maxs[0] = maxs[1] = -99999;
-
     src_surfedge = surf->firstsurfedge;
     for (i = 0; i < surf->numsurfedges; i++) {
         src_edge = src_surfedge->edge;
@@ -585,12 +1109,6 @@ static void build_surface_poly(mface_t *surf, vec_t *vbo)
         tc[0] = DotProduct(vbo, texinfo->axis[0]) + texinfo->offset[0];
         tc[1] = DotProduct(vbo, texinfo->axis[1]) + texinfo->offset[1];
 
-        if (mins[0] > tc[0]) mins[0] = tc[0];
-        if (maxs[0] < tc[0]) maxs[0] = tc[0];
-
-        if (mins[1] > tc[1]) mins[1] = tc[1];
-        if (maxs[1] < tc[1]) maxs[1] = tc[1];
-
         vbo[4] = tc[0] * scale[0];
         vbo[5] = tc[1] * scale[1];
 
@@ -600,6 +1118,37 @@ static void build_surface_poly(mface_t *surf, vec_t *vbo)
 
         vbo += VERTEX_SIZE;
     }
+}
+
+// calculates surface extents, must be done for all surfaces before
+// lightmap blocks are allocated
+static void calc_surface_extents(mface_t *surf)
+{
+    msurfedge_t *src_surfedge;
+    mvertex_t *src_vert;
+    medge_t *src_edge;
+    mtexinfo_t *texinfo = surf->texinfo;
+    vec2_t tc, mins, maxs;
+    int i, bmins[2], bmaxs[2];
+
+    mins[0] = mins[1] = 99999;
+    maxs[0] = maxs[1] = -99999;
+
+    src_surfedge = surf->firstsurfedge;
+    for (i = 0; i < surf->numsurfedges; i++) {
+        src_edge = src_surfedge->edge;
+        src_vert = src_edge->v[src_surfedge->vert];
+        src_surfedge++;
+
+        tc[0] = DotProduct(src_vert->point, texinfo->axis[0]) + texinfo->offset[0];
+        tc[1] = DotProduct(src_vert->point, texinfo->axis[1]) + texinfo->offset[1];
+
+        if (mins[0] > tc[0]) mins[0] = tc[0];
+        if (maxs[0] < tc[0]) maxs[0] = tc[0];
+
+        if (mins[1] > tc[1]) mins[1] = tc[1];
+        if (maxs[1] < tc[1]) maxs[1] = tc[1];
+    }
 
     // calculate surface extents
     bmins[0] = floor(mins[0] / 16);
@@ -636,28 +1185,36 @@ static void sample_surface_verts(mface_t *surf, vec_t *vbo)
     surf->statebits |= GLS_SHADE_SMOOTH;
 }
 
-// validates and processes surface lightmap
-static void build_surface_light(mface_t *surf, vec_t *vbo)
+static inline qboolean surface_has_light(mface_t *surf)
 {
-    int smax, tmax, size;
-    byte *src, *ptr;
-    bsp_t *bsp;
-
     if (gl_fullbright->integer)
-        return;
+        return qfalse;
 
     if (!surf->lightmap)
-        return;
+        return qfalse;
 
     if (surf->drawflags & SURF_NOLM_MASK)
-        return;
+        return qfalse;
+
+    return qtrue;
+}
+
+// validates surface lightmap
+static qboolean validate_surface_light(mface_t *surf)
+{
+    int smax, tmax, size;
+    byte *src, *ptr;
+    bsp_t *bsp;
+
+    if (!surface_has_light(surf))
+        return qfalse;
 
     // validate extents
     if (surf->extents[0] < 0 || surf->extents[0] > MAX_SURFACE_EXTENTS ||
         surf->extents[1] < 0 || surf->extents[1] > MAX_SURFACE_EXTENTS) {
         Com_EPrintf("%s: bad surface extents\n", __func__);
         surf->lightmap = NULL;  // don't use this lightmap
-        return;
+        return qfalse;
     }
 
     // validate blocklights size
@@ -667,7 +1224,7 @@ static void build_surface_light(mface_t *surf, vec_t *vbo)
     if (size > MAX_BLOCKLIGHTS) {
         Com_EPrintf("%s: MAX_BLOCKLIGHTS exceeded\n", __func__);
         surf->lightmap = NULL;  // don't use this lightmap
-        return;
+        return qfalse;
     }
 
     // validate lightmap bounds
@@ -677,13 +1234,10 @@ static void build_surface_light(mface_t *surf, vec_t *vbo)
     if (src > ptr) {
         Com_EPrintf("%s: bad surface lightmap\n", __func__);
         surf->lightmap = NULL;  // don't use this lightmap
-        return;
+        return qfalse;
     }
 
-    if (gl_vertexlight->integer)
-        sample_surface_verts(surf, vbo);
-    else
-        LM_BuildSurface(surf, vbo);
+    return qtrue;
 }
 
 // normalizes and stores lightmap texture coordinates in vertices
@@ -761,13 +1315,32 @@ static void upload_world_surfaces(void)
 {
     bsp_t *bsp = gl_static.world.cache;
     vec_t *vbo;
-    mface_t *surf;
-    int i, currvert, lastvert;
+    mface_t *surf, **surfs;
+    int i, count, currvert, lastvert;
 
     // force vertex lighting if multitexture is not supported
     if (!qglActiveTextureARB || !qglClientActiveTextureARB)
         Cvar_Set("gl_vertexlight", "1");
 
+    // lightmap blocks are packed for all surfaces at once, so extents
+    // must be known before any vertices are built
+    surfs = Z_Malloc(bsp->numfaces * sizeof(surfs[0]));
+    count = 0;
+    for (i = 0, surf = bsp->faces; i < bsp->numfaces; i++, surf++) {
+        if (surf->drawflags & SURF_SKY)
+            continue;
+
+        surf->texnum[1] = 0;
+        calc_surface_extents(surf);
+        if (validate_surface_light(surf))
+            surfs[count++] = surf;
+    }
+
+    if (!gl_fullbright->integer && !gl_vertexlight->integer)
+        LM_BuildSurfaces(surfs, count);
+
+    Z_Free(surfs);
+
     if (!gl_static.world.vertices)
         qglBindBufferARB(GL_ARRAY_BUFFER_ARB, gl_static.world.bufnum);
 
@@ -792,7 +1365,9 @@ static void upload_world_surfaces(void)
 
         surf->firstvert = currvert;
         build_surface_poly(surf, vbo);
-        build_surface_light(surf, vbo);
+
+        if (gl_vertexlight->integer && surface_has_light(surf))
+            sample_surface_verts(surf, vbo);
 
         if (surf->texnum[1])
             normalize_surface_lmtc(surf, vbo);
@@ -858,6 +1433,8 @@ void GL_RebuildLighting(void)
 
 void GL_FreeWorld(void)
 {
+    LM_FreeQueue();
+
     if (!gl_static.world.cache) {
         return;
     }
@@ -875,7 +1452,9 @@ void GL_FreeWorld(void)
 
 void GL_LoadWorld(const char *name)
 {
-    char buffer[MAX_QPATH];
+    char (*names)[MAX_QPATH];
+    imagereq_t *reqs;
+    image_t **images;
     size_t size;
     bsp_t *bsp;
     mtexinfo_t *info;
@@ -914,18 +1493,34 @@ void GL_LoadWorld(const char *name)
     // calculate world size for far clip plane and sky box
     set_world_size();
 
-    // register all texinfo
+    // register all texinfo, decoding in parallel
+    names = Z_Malloc(bsp->numtexinfo * sizeof(names[0]));
+    reqs = Z_Malloc(bsp->numtexinfo * sizeof(reqs[0]));
+    images = Z_Malloc(bsp->numtexinfo * sizeof(images[0]));
+
     for (i = 0, info = bsp->texinfo; i < bsp->numtexinfo; i++, info++) {
         if (info->c.flags & SURF_WARP)
             flags = IF_TURBULENT;
         else
             flags = IF_NONE;
 
-        Q_concat(buffer, sizeof(buffer), "textures/", info->name, ".wal", NULL);
-        FS_NormalizePath(buffer, buffer);
-        info->image = IMG_Find(buffer, IT_WALL, flags);
+        Q_concat(names[i], sizeof(names[i]), "textures/", info->name, ".wal", NULL);
+        FS_NormalizePath(names[i], names[i]);
+        reqs[i].name = names[i];
+        reqs[i].type = IT_WALL;
+        reqs[i].flags = flags;
     }
 
+    IMG_FindBatch(reqs, images, bsp->numtexinfo);
+
+    for (i = 0, info = bsp->texinfo; i < bsp->numtexinfo; i++, info++) {
+        info->image = images[i];
+    }
+
+    Z_Free(names);
+    Z_Free(reqs);
+    Z_Free(images);
+
     // calculate vertex buffer size in bytes
     size = 0;
     for (i = 0, surf = bsp->faces; i < bsp->numfaces; i++, surf++) {
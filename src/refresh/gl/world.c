@@ -568,9 +568,16 @@ void GL_DrawWorld(void)
 
     GL_ClearSolidFaces();
 
+    // hashed faces are not drawn until after traversal, so lightmap updates
+    // can be collected and composited together
+    if (gl_hash_faces->integer)
+        GL_BeginLights();
+
     GL_WorldNode_r(gl_static.world.cache->nodes,
                    gl_cull_nodes->integer ? NODE_CLIPPED : NODE_UNCLIPPED);
 
+    GL_EndLights();
+
     GL_DrawSolidFaces();
 
     GL_Flush3D();
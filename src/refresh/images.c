@@ -27,11 +27,22 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include "common/cvar.h"
 #include "common/files.h"
 #include "refresh/images.h"
+#include "system/system.h"
 #include "format/pcx.h"
 #include "format/wal.h"
+#include "refresh/bcn.h"
+#include "vkpt/dds.h"
 #include "stb_image.h"
 #include "stb_image_write.h"
 
+#include <SDL_atomic.h>
+#include <SDL_cpuinfo.h>
+#include <SDL_thread.h>
+
+#if USE_SSE2
+#include <emmintrin.h>
+#endif
+
 #define R_COLORMAP_PCX    "pics/colormap.pcx"
 
 #define IMG_LOAD(x) \
@@ -574,34 +585,31 @@ IMAGE PROCESSING
 =========================================================
 */
 
-void IMG_ResampleTexture(const byte *in, int inwidth, int inheight,
-                         byte *out, int outwidth, int outheight)
+float srgb_to_linear[256];
+
+static void init_srgb_table(void)
 {
-    int i, j;
-    const byte  *inrow1, *inrow2;
-    unsigned    frac, fracstep;
-    unsigned    p1[MAX_TEXTURE_SIZE], p2[MAX_TEXTURE_SIZE];
-    const byte  *pix1, *pix2, *pix3, *pix4;
-    float       heightScale;
+    float   x;
+    int     i;
 
-    if (outwidth > MAX_TEXTURE_SIZE) {
-        Com_Error(ERR_FATAL, "%s: outwidth > %d", __func__, MAX_TEXTURE_SIZE);
+    for (i = 0; i < 256; i++) {
+        x = (float)i / 255.f;
+        if (x < 0.04045f)
+            srgb_to_linear[i] = x / 12.92f;
+        else
+            srgb_to_linear[i] = powf((x + 0.055f) / 1.055f, 2.4f);
     }
+}
 
-    fracstep = inwidth * 0x10000 / outwidth;
-
-    frac = fracstep >> 2;
-    for (i = 0; i < outwidth; i++) {
-        p1[i] = 4 * (frac >> 16);
-        frac += fracstep;
-    }
-    frac = 3 * (fracstep >> 2);
-    for (i = 0; i < outwidth; i++) {
-        p2[i] = 4 * (frac >> 16);
-        frac += fracstep;
-    }
+static void resample_generic(const byte *in, int inwidth,
+                             const unsigned *p1, const unsigned *p2,
+                             float heightScale, int outheight,
+                             byte *out, int outwidth)
+{
+    int i, j;
+    const byte  *inrow1, *inrow2;
+    const byte  *pix1, *pix2, *pix3, *pix4;
 
-    heightScale = (float)inheight / outheight;
     inwidth <<= 2;
     for (i = 0; i < outheight; i++) {
         inrow1 = in + inwidth * (int)((i + 0.25f) * heightScale);
@@ -620,7 +628,7 @@ void IMG_ResampleTexture(const byte *in, int inwidth, int inheight,
     }
 }
 
-void IMG_MipMap(byte *out, byte *in, int width, int height)
+static void mipmap_generic(byte *out, byte *in, int width, int height)
 {
     int     i, j;
 
@@ -636,6 +644,439 @@ void IMG_MipMap(byte *out, byte *in, int width, int height)
     }
 }
 
+#if USE_SSE2
+
+#define LOAD_PIXEL(p)   (*(const uint32_t *)(p))
+
+// two output pixels per iteration, four RGBA samples each, summed in 16 bits
+static void resample_sse2(const byte *in, int inwidth,
+                          const unsigned *p1, const unsigned *p2,
+                          float heightScale, int outheight,
+                          byte *out, int outwidth)
+{
+    const __m128i   zero = _mm_setzero_si128();
+    const byte      *inrow1, *inrow2;
+    __m128i         a, b, lo, hi, sum;
+    int             i, j;
+
+    inwidth <<= 2;
+    for (i = 0; i < outheight; i++) {
+        inrow1 = in + inwidth * (int)((i + 0.25f) * heightScale);
+        inrow2 = in + inwidth * (int)((i + 0.75f) * heightScale);
+        for (j = 0; j < outwidth - 1; j += 2, out += 8) {
+            a = _mm_setr_epi32(LOAD_PIXEL(inrow1 + p1[j + 0]), LOAD_PIXEL(inrow1 + p2[j + 0]),
+                               LOAD_PIXEL(inrow1 + p1[j + 1]), LOAD_PIXEL(inrow1 + p2[j + 1]));
+            b = _mm_setr_epi32(LOAD_PIXEL(inrow2 + p1[j + 0]), LOAD_PIXEL(inrow2 + p2[j + 0]),
+                               LOAD_PIXEL(inrow2 + p1[j + 1]), LOAD_PIXEL(inrow2 + p2[j + 1]));
+            lo = _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero));
+            hi = _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero));
+            sum = _mm_add_epi16(_mm_unpacklo_epi64(lo, hi), _mm_unpackhi_epi64(lo, hi));
+            sum = _mm_srli_epi16(sum, 2);
+            _mm_storel_epi64((__m128i *)out, _mm_packus_epi16(sum, sum));
+        }
+        if (j < outwidth) {
+            a = _mm_setr_epi32(LOAD_PIXEL(inrow1 + p1[j]), LOAD_PIXEL(inrow1 + p2[j]), 0, 0);
+            b = _mm_setr_epi32(LOAD_PIXEL(inrow2 + p1[j]), LOAD_PIXEL(inrow2 + p2[j]), 0, 0);
+            sum = _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero));
+            sum = _mm_add_epi16(sum, _mm_srli_si128(sum, 8));
+            sum = _mm_srli_epi16(sum, 2);
+            *(uint32_t *)out = _mm_cvtsi128_si32(_mm_packus_epi16(sum, sum));
+            out += 4;
+        }
+    }
+}
+
+// box filters four output pixels per iteration, falls back to scalar for
+// the last odd pixels of a row. safe for in-place use since output never
+// overtakes input.
+static void mipmap_sse2(byte *out, byte *in, int width, int height)
+{
+    const __m128i   zero = _mm_setzero_si128();
+    __m128i         r0, r1, s0, s1, s2, s3, sum0, sum1;
+    int             i, j;
+
+    width <<= 2;
+    height >>= 1;
+    for (i = 0; i < height; i++, in += width) {
+        for (j = 0; j + 32 <= width; j += 32, out += 16, in += 32) {
+            r0 = _mm_loadu_si128((const __m128i *)in);
+            r1 = _mm_loadu_si128((const __m128i *)(in + width));
+            s0 = _mm_add_epi16(_mm_unpacklo_epi8(r0, zero), _mm_unpacklo_epi8(r1, zero));
+            s1 = _mm_add_epi16(_mm_unpackhi_epi8(r0, zero), _mm_unpackhi_epi8(r1, zero));
+
+            r0 = _mm_loadu_si128((const __m128i *)(in + 16));
+            r1 = _mm_loadu_si128((const __m128i *)(in + width + 16));
+            s2 = _mm_add_epi16(_mm_unpacklo_epi8(r0, zero), _mm_unpacklo_epi8(r1, zero));
+            s3 = _mm_add_epi16(_mm_unpackhi_epi8(r0, zero), _mm_unpackhi_epi8(r1, zero));
+
+            sum0 = _mm_add_epi16(_mm_unpacklo_epi64(s0, s1), _mm_unpackhi_epi64(s0, s1));
+            sum1 = _mm_add_epi16(_mm_unpacklo_epi64(s2, s3), _mm_unpackhi_epi64(s2, s3));
+            sum0 = _mm_srli_epi16(sum0, 2);
+            sum1 = _mm_srli_epi16(sum1, 2);
+            _mm_storeu_si128((__m128i *)out, _mm_packus_epi16(sum0, sum1));
+        }
+        for (; j < width; j += 8, out += 4, in += 8) {
+            out[0] = (in[0] + in[4] + in[width + 0] + in[width + 4]) >> 2;
+            out[1] = (in[1] + in[5] + in[width + 1] + in[width + 5]) >> 2;
+            out[2] = (in[2] + in[6] + in[width + 2] + in[width + 6]) >> 2;
+            out[3] = (in[3] + in[7] + in[width + 3] + in[width + 7]) >> 2;
+        }
+    }
+}
+
+#undef LOAD_PIXEL
+
+#define resample_fast   resample_sse2
+#define mipmap_fast     mipmap_sse2
+#else
+#define resample_fast   resample_generic
+#define mipmap_fast     mipmap_generic
+#endif
+
+static void setup_resample(int inwidth, int outwidth,
+                           unsigned *p1, unsigned *p2)
+{
+    unsigned    frac, fracstep;
+    int         i;
+
+    if (outwidth > MAX_TEXTURE_SIZE) {
+        Com_Error(ERR_FATAL, "%s: outwidth > %d", __func__, MAX_TEXTURE_SIZE);
+    }
+
+    fracstep = inwidth * 0x10000 / outwidth;
+
+    frac = fracstep >> 2;
+    for (i = 0; i < outwidth; i++) {
+        p1[i] = 4 * (frac >> 16);
+        frac += fracstep;
+    }
+    frac = 3 * (fracstep >> 2);
+    for (i = 0; i < outwidth; i++) {
+        p2[i] = 4 * (frac >> 16);
+        frac += fracstep;
+    }
+}
+
+void IMG_ResampleTexture(const byte *in, int inwidth, int inheight,
+                         byte *out, int outwidth, int outheight)
+{
+    unsigned    p1[MAX_TEXTURE_SIZE], p2[MAX_TEXTURE_SIZE];
+
+    setup_resample(inwidth, outwidth, p1, p2);
+    resample_fast(in, inwidth, p1, p2, (float)inheight / outheight,
+                  outheight, out, outwidth);
+}
+
+void IMG_MipMap(byte *out, byte *in, int width, int height)
+{
+    mipmap_fast(out, in, width, height);
+}
+
+/*
+=========================================================
+
+TEXTURE CACHE
+
+Block compressed copies of 32-bit textures, with all mip levels, are kept
+under texcache/ in the write directory, one DDS file per source file. The
+header records a hash and the size of the source file, so edited sources
+are detected and cooked again.
+
+=========================================================
+*/
+
+#define TEXCACHE_MAGIC      MakeRawLong('Q', '2', 'T', 'C')
+#define TEXCACHE_VERSION    1
+
+static cvar_t   *r_texture_cache;
+
+static const uint32_t texcache_fourcc[BCN_MAX] = {
+    MAKEFOURCC('D', 'X', 'T', '1'),
+    MAKEFOURCC('D', 'X', 'T', '5'),
+    MAKEFOURCC('A', 'T', 'I', '2'),
+};
+
+static uint32_t hash_source(const byte *data, size_t len)
+{
+    uint32_t hash = 2166136261u;
+
+    while (len--) {
+        hash ^= *data++;
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
+static size_t texcache_path(char *buffer, size_t size, const char *name)
+{
+    return Q_concat(buffer, size, "texcache/", name, ".dds", NULL);
+}
+
+static qboolean texcache_wanted(const image_t *image, imageformat_t fmt)
+{
+    if (!r_texture_cache->integer)
+        return qfalse;
+
+    // 8-bit sources are small already, UI graphics should stay sharp
+    if (fmt <= IM_WAL)
+        return qfalse;
+
+    return image->type != IT_PIC && image->type != IT_FONT;
+}
+
+static qboolean is_normal_map(const char *name)
+{
+    return strstr(name, "_n.") != NULL;
+}
+
+static int num_mip_levels(int w, int h)
+{
+    int levels = 1;
+
+    while (w > 1 || h > 1) {
+        w = max(1, w >> 1);
+        h = max(1, h >> 1);
+        levels++;
+    }
+
+    return levels;
+}
+
+static byte linear_to_srgb(float x)
+{
+    if (x <= 0.0031308f)
+        x *= 12.92f;
+    else
+        x = 1.055f * powf(x, 1.f / 2.4f) - 0.055f;
+
+    clamp(x, 0, 1);
+    return (byte)(x * 255.f + 0.5f);
+}
+
+// 2x2 box filter that copes with odd and unit dimensions. color of sRGB
+// textures is averaged in linear space, as the GPU blit would do.
+static void cook_mipmap(byte *out, const byte *in, int w, int h, qboolean srgb)
+{
+    int         ow = max(1, w >> 1);
+    int         oh = max(1, h >> 1);
+    int         x, y, c, x0, x1, y0, y1;
+    const byte  *p[4];
+
+    for (y = 0; y < oh; y++) {
+        y0 = min(y * 2, h - 1);
+        y1 = min(y * 2 + 1, h - 1);
+        for (x = 0; x < ow; x++, out += 4) {
+            x0 = min(x * 2, w - 1);
+            x1 = min(x * 2 + 1, w - 1);
+            p[0] = in + (y0 * w + x0) * 4;
+            p[1] = in + (y0 * w + x1) * 4;
+            p[2] = in + (y1 * w + x0) * 4;
+            p[3] = in + (y1 * w + x1) * 4;
+            for (c = 0; c < 4; c++) {
+                if (srgb && c < 3)
+                    out[c] = linear_to_srgb((srgb_to_linear[p[0][c]] + srgb_to_linear[p[1][c]] +
+                                             srgb_to_linear[p[2][c]] + srgb_to_linear[p[3][c]]) * 0.25f);
+                else
+                    out[c] = (p[0][c] + p[1][c] + p[2][c] + p[3][c] + 2) >> 2;
+            }
+        }
+    }
+}
+
+// same transform as vkpt_normalize_normal_map, so that Z can be
+// reconstructed from the two stored channels
+static void cook_normalize(byte *pic, int w, int h)
+{
+    vec3_t  n;
+    int     i;
+
+    for (i = 0; i < w * h; i++, pic += 4) {
+        n[0] = pic[0] * (2.f / 255.f) - 1.f;
+        n[1] = pic[1] * (2.f / 255.f) - 1.f;
+        n[2] = pic[2] * (1.f / 255.f);
+        if (VectorNormalize(n) == 0.f)
+            VectorSet(n, 0, 0, 1);
+        n[0] = n[0] * 0.5f + 0.5f;
+        n[1] = n[1] * 0.5f + 0.5f;
+        pic[0] = (byte)roundf(max(0.f, min(1.f, n[0])) * 255.f);
+        pic[1] = (byte)roundf(max(0.f, min(1.f, n[1])) * 255.f);
+        pic[2] = (byte)roundf(max(0.f, min(1.f, n[2])) * 255.f);
+    }
+}
+
+// validates a cooked file against the source, returns offset of level 0
+static size_t texcache_validate(const byte *data, size_t len, uint32_t hash,
+                                size_t srclen, bcnformat_t *fmt_p)
+{
+    const DDS_HEADER    *dds = (const DDS_HEADER *)data;
+    bcnformat_t         fmt;
+    size_t              total;
+    int                 i, w, h;
+
+    if (len < sizeof(*dds))
+        return 0;
+    if (dds->magic != DDS_MAGIC || dds->size != sizeof(*dds) - 4)
+        return 0;
+    if (dds->reserved1[0] != TEXCACHE_MAGIC || dds->reserved1[1] != TEXCACHE_VERSION)
+        return 0;
+    if (dds->reserved1[2] != hash || dds->reserved1[3] != srclen)
+        return 0;
+    if (dds->width < 1 || dds->width > MAX_TEXTURE_SIZE * 4)
+        return 0;
+    if (dds->height < 1 || dds->height > MAX_TEXTURE_SIZE * 4)
+        return 0;
+    if (dds->mipMapCount != num_mip_levels(dds->width, dds->height))
+        return 0;
+
+    for (fmt = 0; fmt < BCN_MAX; fmt++)
+        if (dds->ddspf.fourCC == texcache_fourcc[fmt])
+            break;
+    if (fmt == BCN_MAX)
+        return 0;
+
+    w = dds->width;
+    h = dds->height;
+    total = 0;
+    for (i = 0; i < dds->mipMapCount; i++) {
+        total += BCN_ImageSize(fmt, w, h);
+        w = max(1, w >> 1);
+        h = max(1, h >> 1);
+    }
+    if (len - sizeof(*dds) < total)
+        return 0;
+
+    *fmt_p = fmt;
+    return sizeof(*dds);
+}
+
+static qerror_t IMG_LoadCooked(image_t *image, uint32_t hash, size_t srclen, byte **pic)
+{
+    char        path[MAX_OSPATH];
+    byte        *data;
+    ssize_t     len;
+    size_t      offset;
+    bcnformat_t fmt;
+    DDS_HEADER  *dds;
+
+    if (texcache_path(path, sizeof(path), image->name) >= sizeof(path))
+        return Q_ERR_NAMETOOLONG;
+
+    len = FS_LoadFile(path, (void **)&data);
+    if (!data)
+        return len;
+
+    offset = texcache_validate(data, len, hash, srclen, &fmt);
+    if (!offset) {
+        FS_FreeFile(data);
+        return Q_ERR_INVALID_FORMAT;
+    }
+
+    dds = (DDS_HEADER *)data;
+    image->upload_width = image->width = dds->width;
+    image->upload_height = image->height = dds->height;
+    if (fmt == BCN_BC1)
+        image->flags |= IF_OPAQUE;
+
+    *pic = IMG_AllocPixels(dds->width * dds->height * 4);
+    BCN_Decompress(fmt, *pic, data + offset, dds->width, dds->height);
+
+#if REF_VKPT
+    // only vkpt uploads block compressed data, and only IMG_Unload_RTX frees
+    // it. normal maps are read as XYZ by the shaders, upload those decoded
+    if (vid_rtx->integer && fmt != BCN_BC5) {
+        image->pix_bcn_size = len - offset;
+        image->pix_bcn = R_Malloc(image->pix_bcn_size);
+        image->pix_bcn_format = fmt;
+        memcpy(image->pix_bcn, data + offset, image->pix_bcn_size);
+    }
+#endif
+
+    FS_FreeFile(data);
+    return Q_ERR_SUCCESS;
+}
+
+static qerror_t IMG_CookImage(const image_t *image, const byte *pic, uint32_t hash, size_t srclen)
+{
+    char        path[MAX_OSPATH];
+    int         w = image->upload_width;
+    int         h = image->upload_height;
+    int         i, levels = num_mip_levels(w, h);
+    qboolean    normals = is_normal_map(image->name);
+    bcnformat_t fmt;
+    DDS_HEADER  *dds;
+    size_t      total, size;
+    byte        *data, *out, *mip[2];
+    qerror_t    ret;
+
+    if (texcache_path(path, sizeof(path), image->name) >= sizeof(path))
+        return Q_ERR_NAMETOOLONG;
+
+    if (normals) {
+        fmt = BCN_BC5;
+    } else {
+        fmt = BCN_BC1;
+        for (i = 0; i < w * h; i++) {
+            if (pic[i * 4 + 3] != 255) {
+                fmt = BCN_BC3;
+                break;
+            }
+        }
+    }
+
+    total = sizeof(*dds);
+    for (i = 0; i < levels; i++)
+        total += BCN_ImageSize(fmt, max(1, w >> i), max(1, h >> i));
+
+    data = IMG_AllocPixels(total);
+    mip[0] = IMG_AllocPixels(w * h * 4);
+    mip[1] = IMG_AllocPixels(max(1, w >> 1) * max(1, h >> 1) * 4);
+    memcpy(mip[0], pic, w * h * 4);
+    if (normals)
+        cook_normalize(mip[0], w, h);
+
+    dds = (DDS_HEADER *)data;
+    memset(dds, 0, sizeof(*dds));
+    dds->magic = DDS_MAGIC;
+    dds->size = sizeof(*dds) - 4;
+    dds->flags = DDS_HEADER_FLAGS_TEXTURE | DDS_HEADER_FLAGS_MIPMAP | DDS_HEADER_FLAGS_LINEARSIZE;
+    dds->width = w;
+    dds->height = h;
+    dds->pitchOrLinearSize = BCN_ImageSize(fmt, w, h);
+    dds->mipMapCount = levels;
+    dds->reserved1[0] = TEXCACHE_MAGIC;
+    dds->reserved1[1] = TEXCACHE_VERSION;
+    dds->reserved1[2] = hash;
+    dds->reserved1[3] = srclen;
+    dds->ddspf.size = sizeof(dds->ddspf);
+    dds->ddspf.flags = DDS_FOURCC;
+    dds->ddspf.fourCC = texcache_fourcc[fmt];
+    dds->caps = DDS_SURFACE_FLAGS_TEXTURE | DDS_SURFACE_FLAGS_MIPMAP;
+
+    out = data + sizeof(*dds);
+    for (i = 0; i < levels; i++) {
+        size = BCN_ImageSize(fmt, w, h);
+        BCN_Compress(fmt, out, mip[0], w, h);
+        out += size;
+
+        if (i < levels - 1) {
+            cook_mipmap(mip[1], mip[0], w, h, !normals);
+            memcpy(mip[0], mip[1], max(1, w >> 1) * max(1, h >> 1) * 4);
+            w = max(1, w >> 1);
+            h = max(1, h >> 1);
+        }
+    }
+
+    ret = FS_WriteFile(path, data, total);
+    if (ret)
+        Com_WPrintf("Couldn't write %s: %s\n", path, Q_ErrorString(ret));
+
+    IMG_FreePixels(mip[1]);
+    IMG_FreePixels(mip[0]);
+    IMG_FreePixels(data);
+    return ret;
+}
+
 /*
 =========================================================
 
@@ -669,6 +1110,7 @@ static int              img_total;
 
 static cvar_t   *r_override_textures;
 static cvar_t   *r_texture_formats;
+static cvar_t   *r_image_threads;
 
 /*
 ===============
@@ -698,14 +1140,15 @@ static void IMG_List_f(void)
 				continue;
 
 			char fmt[MAX_QPATH];
-			sprintf(fmt, "%%-%ds, %%-%ds, (%% 5d %% 5d), sRGB:%%d\n", MAX_QPATH, MAX_QPATH);
+			sprintf(fmt, "%%-%ds, %%-%ds, (%% 5d %% 5d), sRGB:%%d, decode:%%.2fms\n", MAX_QPATH, MAX_QPATH);
 
 			FS_FPrintf(f, fmt, 
 				image->name, 
 				image->filepath, 
 				image->width, 
 				image->height,
-				image->is_srgb);
+				image->is_srgb,
+				image->decode_time * 1e-3);
 		}
 		FS_FCloseFile(f);
 
@@ -715,6 +1158,7 @@ static void IMG_List_f(void)
 
 		// dump to console
 		static const char types[8] = "PFMSWY??";
+		uint64_t decode = 0;
 
 		Com_Printf("------------------\n");
 		texels = count = 0;
@@ -723,7 +1167,7 @@ static void IMG_List_f(void)
 			if (!image->registration_sequence)
 				continue;
 
-			Com_Printf("%c%c%c%c %4i %4i %s: %s\n",
+			Com_Printf("%c%c%c%c %4i %4i %s %7.2fms: %s\n",
 				types[image->type > IT_MAX ? IT_MAX : image->type],
 				(image->flags & IF_TRANSPARENT) ? 'T' : ' ',
 				(image->flags & IF_SCRAP) ? 'S' : ' ',
@@ -731,13 +1175,16 @@ static void IMG_List_f(void)
 				image->upload_width,
 				image->upload_height,
 				(image->flags & IF_PALETTED) ? "PAL" : "RGB",
+				image->decode_time * 1e-3,
 				image->name);
 
 			texels += image->upload_width * image->upload_height;
+			decode += image->decode_time;
 			count++;
 		}
 		Com_Printf("Total images: %d (out of %d slots)\n", count, r_numImages);
 		Com_Printf("Total texels: %d (not counting mipmaps)\n", texels);
+		Com_Printf("Total decode: %.1f ms (summed over threads)\n", decode * 1e-3);
 	}
 }
 
@@ -784,11 +1231,28 @@ static image_t *lookup_image(const char *name,
     return NULL;
 }
 
+// IMG_FindBatch reads files on the main thread and decodes them afterwards
+typedef struct {
+    image_t         *image;
+    imageformat_t   orig;       // extension that was asked for
+    imageformat_t   fmt;        // format actually found
+    byte            *data;
+    size_t          len;
+    uint32_t        hash;       // texture cache key
+    byte            *pic;
+    qerror_t        ret;
+} imgjob_t;
+
+// when set, _try_image_format stops after reading the file
+static imgjob_t *img_deferred;
+
 static int _try_image_format(imageformat_t fmt, image_t *image, byte **pic)
 {
     byte        *data;
     ssize_t     len;
     qerror_t    ret;
+    uint32_t    hash = 0;
+    uint64_t    start;
 
     // load the file
     len = FS_LoadFile(image->name, (void **)&data);
@@ -796,8 +1260,31 @@ static int _try_image_format(imageformat_t fmt, image_t *image, byte **pic)
         return len;
     }
 
-    // decompress the image
-    ret = img_loaders[fmt].load(data, len, image, pic);
+    start = Sys_Microseconds();
+
+    // prefer an up to date cooked copy, otherwise decompress the image
+    ret = Q_ERR_NOENT;
+    if (texcache_wanted(image, fmt)) {
+        hash = hash_source(data, len);
+        ret = IMG_LoadCooked(image, hash, len, pic);
+    }
+
+    if (ret >= 0) {
+        image->decode_time = Sys_Microseconds() - start;
+    } else if (img_deferred) {
+        // keep the file around for a decoding thread
+        img_deferred->fmt = fmt;
+        img_deferred->data = data;
+        img_deferred->len = len;
+        img_deferred->hash = hash;
+        data = NULL;
+        ret = Q_ERR_SUCCESS;
+    } else {
+        ret = img_loaders[fmt].load(data, len, image, pic);
+        image->decode_time = Sys_Microseconds() - start;
+        if (ret >= 0 && texcache_wanted(image, fmt) && r_texture_cache->integer > 1)
+            IMG_CookImage(image, *pic, hash, len);
+    }
 
     FS_FreeFile(data);
 
@@ -940,9 +1427,9 @@ load_img(const char *name, image_t *image)
         return Q_ERR_INVALID_PATH;
     }
 
+    // type is left to the caller, it decides whether the texture cache applies
     memcpy(image->name, name, len + 1);
     image->baselen = len - 4;
-    image->type = 0;
     image->flags = 0;
     image->registration_sequence = 1;
 
@@ -1095,7 +1582,8 @@ static qerror_t find_or_load_image(const char *name, size_t len,
 
 		// if we are replacing 8-bit texture with a higher resolution 32-bit
 		// texture, we need to recover original image dimensions
-		if (fmt <= IM_WAL && ret > IM_WAL) {
+		// (deferred until after decoding for IMG_FindBatch)
+		if (fmt <= IM_WAL && ret > IM_WAL && !(img_deferred && img_deferred->data)) {
 			get_image_dimensions(fmt, image);
 		}
 
@@ -1112,6 +1600,15 @@ static qerror_t find_or_load_image(const char *name, size_t len,
 
 	image->is_srgb = !!(flags & IF_SRGB);
 
+    // IMG_FindBatch finishes it once decoded. it is already in the hash
+    // table so that repeated names in the same batch share the slot.
+    if (img_deferred && img_deferred->data) {
+        img_deferred->image = image;
+        img_deferred->orig = fmt;
+        *image_p = image;
+        return Q_ERR_SUCCESS;
+    }
+
     // upload the image
     IMG_Load(image, pic);
 
@@ -1153,6 +1650,118 @@ image_t *IMG_Find(const char *name, imagetype_t type, imageflags_t flags)
 IMG_ForHandle
 ===============
 */
+#define MAX_DECODE_THREADS  16
+
+typedef struct {
+    imgjob_t        *jobs;
+    int             numjobs;
+    SDL_atomic_t    next;
+} imgbatch_t;
+
+static int SDLCALL decode_thread(void *arg)
+{
+    imgbatch_t  *batch = arg;
+    imgjob_t    *job;
+    uint64_t    start;
+    int         i;
+
+    while ((i = SDL_AtomicAdd(&batch->next, 1)) < batch->numjobs) {
+        job = &batch->jobs[i];
+        start = Sys_Microseconds();
+        job->ret = img_loaders[job->fmt].load(job->data, job->len, job->image, &job->pic);
+        job->image->decode_time = Sys_Microseconds() - start;
+    }
+
+    return 0;
+}
+
+/*
+===============
+IMG_FindBatch
+
+Same as calling IMG_Find for each request, but files are read up front and
+decoded in parallel. Filesystem access, texture cache writes and uploads
+stay on the calling thread.
+===============
+*/
+void IMG_FindBatch(const imagereq_t *reqs, image_t **images, int count)
+{
+    SDL_Thread  *threads[MAX_DECODE_THREADS];
+    imgbatch_t  batch;
+    imgjob_t    *job;
+    image_t     *image;
+    int         i, numthreads;
+
+    if (count < 1) {
+        return;
+    }
+
+    batch.jobs = Z_Malloc(count * sizeof(batch.jobs[0]));
+    batch.numjobs = 0;
+    SDL_AtomicSet(&batch.next, 0);
+
+    for (i = 0; i < count; i++) {
+        job = &batch.jobs[batch.numjobs];
+        memset(job, 0, sizeof(*job));
+
+        img_deferred = job;
+        images[i] = IMG_Find(reqs[i].name, reqs[i].type, reqs[i].flags);
+        img_deferred = NULL;
+
+        if (job->data) {
+            batch.numjobs++;
+        }
+    }
+
+    numthreads = r_image_threads->integer;
+    if (numthreads < 1) {
+        numthreads = SDL_GetCPUCount();
+    }
+    clamp(numthreads, 1, MAX_DECODE_THREADS);
+    numthreads = min(numthreads, batch.numjobs);
+
+    // this thread decodes too, thread creation failure only costs speed
+    for (i = 1; i < numthreads; i++) {
+        threads[i] = SDL_CreateThread(decode_thread, "image decoder", &batch);
+    }
+    decode_thread(&batch);
+    for (i = 1; i < numthreads; i++) {
+        if (threads[i]) {
+            SDL_WaitThread(threads[i], NULL);
+        }
+    }
+
+    for (i = 0, job = batch.jobs; i < batch.numjobs; i++, job++) {
+        image = job->image;
+        if (job->ret < 0) {
+            Com_EPrintf("Couldn't load %s: %s\n", image->name, Q_ErrorString(job->ret));
+            List_Remove(&image->entry);
+            memset(image, 0, sizeof(*image));
+        } else {
+            if (job->orig <= IM_WAL && job->fmt > IM_WAL) {
+                get_image_dimensions(job->orig, image);
+            }
+            if (texcache_wanted(image, job->fmt) && r_texture_cache->integer > 1) {
+                IMG_CookImage(image, job->pic, job->hash, job->len);
+            }
+            IMG_Load(image, job->pic);
+        }
+        FS_FreeFile(job->data);
+    }
+
+    // requests that hit a slot which failed to decode
+    for (i = 0; i < count; i++) {
+        if (!images[i]->registration_sequence) {
+            images[i] = R_NOTEXTURE;
+        }
+    }
+
+    Com_DPrintf("%s: %d images, %d decoded on %d threads\n", __func__,
+                count, batch.numjobs, max(numthreads, 1));
+
+    Z_Free(batch.jobs);
+}
+
 image_t *IMG_ForHandle(qhandle_t h)
 {
     if (h < 0 || h >= r_numImages) {
@@ -1407,12 +2016,263 @@ fail:
     Com_Error(ERR_FATAL, "Couldn't load %s: %s", R_COLORMAP_PCX, Q_ErrorString(ret));
 }
 
+/*
+===============
+IMG_Benchmark_f
+
+Loads shipped textures and runs the scalar and vectorized image
+processing paths over them, checking that the results match.
+===============
+*/
+static void IMG_Benchmark_f(void)
+{
+    static const char filter[] =
+        "textures/*.wal;textures/*.png;textures/*.tga;textures/*.jpg";
+    unsigned    p1[MAX_TEXTURE_SIZE], p2[MAX_TEXTURE_SIZE];
+    uint64_t    times[3][2], start;
+    int         i, k, count, maxcount, loaded, errors;
+    int         w, h, ow, oh;
+    size_t      j, size, pixels;
+    image_t     image;
+    void        **list;
+    byte        *data, *pic, *dst[2];
+    float       sums[2], scale;
+    imageformat_t fmt;
+    ssize_t     len;
+
+    maxcount = Cmd_Argc() > 1 ? atoi(Cmd_Argv(1)) : 0;
+
+    list = FS_ListFiles(NULL, filter, FS_SEARCH_BYFILTER, &count);
+    if (!list) {
+        Com_Printf("No textures found\n");
+        return;
+    }
+    if (maxcount > 0 && maxcount < count)
+        count = maxcount;
+
+    memset(times, 0, sizeof(times));
+    loaded = errors = 0;
+    pixels = 0;
+
+    for (i = 0; i < count; i++) {
+        for (fmt = 0; fmt < IM_MAX; fmt++)
+            if (!COM_CompareExtension(list[i], va(".%s", img_loaders[fmt].ext)))
+                break;
+        if (fmt == IM_MAX)
+            continue;
+
+        len = FS_LoadFile(list[i], (void **)&data);
+        if (!data)
+            continue;
+
+        memset(&image, 0, sizeof(image));
+        image.type = IT_WALL;
+        pic = NULL;
+        if (img_loaders[fmt].load(data, len, &image, &pic) < 0) {
+            FS_FreeFile(data);
+            continue;
+        }
+        FS_FreeFile(data);
+
+        w = image.upload_width;
+        h = image.upload_height;
+        size = (size_t)w * h * 4;
+        dst[0] = IMG_AllocPixels(size);
+        dst[1] = IMG_AllocPixels(size);
+
+        // sRGB decode, powf vs table
+        for (k = 0; k < 2; k++) {
+            start = Sys_Microseconds();
+            sums[k] = 0;
+            for (j = 0; j < size; j++) {
+                if ((j & 3) == 3)
+                    continue;
+                if (k) {
+                    sums[k] += srgb_to_linear[pic[j]];
+                } else {
+                    float x = pic[j] / 255.f;
+                    sums[k] += x < 0.04045f ? x / 12.92f :
+                               powf((x + 0.055f) / 1.055f, 2.4f);
+                }
+            }
+            times[0][k] += Sys_Microseconds() - start;
+        }
+        if (sums[0] != sums[1]) {
+            Com_Printf("%s: sRGB decode mismatch\n", (char *)list[i]);
+            errors++;
+        }
+
+        // resample to 3/4 size, which exercises uneven steps
+        ow = max(1, w * 3 / 4);
+        oh = max(1, h * 3 / 4);
+        scale = (float)h / oh;
+        setup_resample(w, ow, p1, p2);
+        start = Sys_Microseconds();
+        resample_generic(pic, w, p1, p2, scale, oh, dst[0], ow);
+        times[1][0] += Sys_Microseconds() - start;
+        start = Sys_Microseconds();
+        resample_fast(pic, w, p1, p2, scale, oh, dst[1], ow);
+        times[1][1] += Sys_Microseconds() - start;
+        if (memcmp(dst[0], dst[1], ow * oh * 4)) {
+            Com_Printf("%s: resample mismatch\n", (char *)list[i]);
+            errors++;
+        }
+
+        // full mip chain
+        for (k = 0; k < 2; k++) {
+            memcpy(dst[k], pic, size);
+            ow = w;
+            oh = h;
+            start = Sys_Microseconds();
+            while (ow > 1 && oh > 1 && !((ow | oh) & 1)) {
+                if (k)
+                    mipmap_fast(dst[k], dst[k], ow, oh);
+                else
+                    mipmap_generic(dst[k], dst[k], ow, oh);
+                ow >>= 1;
+                oh >>= 1;
+            }
+            times[2][k] += Sys_Microseconds() - start;
+        }
+        if (memcmp(dst[0], dst[1], size)) {
+            Com_Printf("%s: mipmap mismatch\n", (char *)list[i]);
+            errors++;
+        }
+
+        IMG_FreePixels(dst[1]);
+        IMG_FreePixels(dst[0]);
+        IMG_FreePixels(pic);
+
+        pixels += (size_t)w * h;
+        loaded++;
+    }
+
+    FS_FreeList(list);
+
+    Com_Printf("%d textures, %zu Kpixels, %d mismatches\n",
+               loaded, pixels / 1000, errors);
+    Com_Printf("srgb:     %8.3f ms scalar, %8.3f ms table\n",
+               times[0][0] * 1e-3, times[0][1] * 1e-3);
+    Com_Printf("resample: %8.3f ms scalar, %8.3f ms simd\n",
+               times[1][0] * 1e-3, times[1][1] * 1e-3);
+    Com_Printf("mipmap:   %8.3f ms scalar, %8.3f ms simd\n",
+               times[2][0] * 1e-3, times[2][1] * 1e-3);
+}
+
+/*
+===============
+IMG_Cook_f
+
+Cooks block compressed copies of 32-bit textures into the texture cache,
+skipping those that are up to date. Every cooked file is loaded back and
+compared with its source.
+===============
+*/
+static void IMG_Cook_f(void)
+{
+    static const char filter[] =
+        "textures/*.png;textures/*.tga;textures/*.jpg";
+    int         i, count, cooked, uptodate, failed;
+    image_t     image, cached;
+    void        **list;
+    byte        *data, *pic, *back;
+    imageformat_t fmt;
+    ssize_t     len;
+    uint32_t    hash;
+    uint64_t    start, texels;
+    double      error, e;
+    size_t      j;
+
+    list = FS_ListFiles(NULL, Cmd_Argc() > 1 ? Cmd_Argv(1) : filter,
+                        FS_SEARCH_BYFILTER, &count);
+    if (!list) {
+        Com_Printf("No textures found\n");
+        return;
+    }
+
+    cooked = uptodate = failed = 0;
+    texels = 0;
+    error = 0;
+    start = Sys_Microseconds();
+
+    for (i = 0; i < count; i++) {
+        for (fmt = IM_TGA; fmt < IM_MAX; fmt++)
+            if (!COM_CompareExtension(list[i], va(".%s", img_loaders[fmt].ext)))
+                break;
+        if (fmt == IM_MAX)
+            continue;
+
+        len = FS_LoadFile(list[i], (void **)&data);
+        if (!data)
+            continue;
+
+        hash = hash_source(data, len);
+
+        memset(&cached, 0, sizeof(cached));
+        Q_strlcpy(cached.name, list[i], sizeof(cached.name));
+        back = NULL;
+        if (IMG_LoadCooked(&cached, hash, len, &back) == Q_ERR_SUCCESS) {
+            FS_FreeFile(data);
+            uptodate++;
+            goto done;
+        }
+
+        memset(&image, 0, sizeof(image));
+        Q_strlcpy(image.name, list[i], sizeof(image.name));
+        image.type = IT_WALL;
+        pic = NULL;
+        if (img_loaders[fmt].load(data, len, &image, &pic) < 0) {
+            FS_FreeFile(data);
+            failed++;
+            continue;
+        }
+        FS_FreeFile(data);
+
+        if (IMG_CookImage(&image, pic, hash, len) ||
+            IMG_LoadCooked(&cached, hash, len, &back)) {
+            IMG_FreePixels(pic);
+            failed++;
+            continue;
+        }
+
+        // normal maps are normalized before cooking, don't count that as error
+        if (!is_normal_map(image.name)) {
+            for (j = 0; j < (size_t)image.width * image.height * 4; j++) {
+                e = pic[j] - back[j];
+                error += e * e;
+            }
+            texels += (uint64_t)image.width * image.height;
+        }
+
+        IMG_FreePixels(pic);
+        cooked++;
+
+done:
+        IMG_FreePixels(back);
+#if REF_VKPT
+        Z_Free(cached.pix_bcn);
+#endif
+    }
+
+    FS_FreeList(list);
+
+    Com_Printf("%d cooked, %d up to date, %d failed in %.1f sec\n",
+               cooked, uptodate, failed, (Sys_Microseconds() - start) * 1e-6);
+    if (texels) {
+        error /= texels * 4;
+        Com_Printf("PSNR of cooked textures: %.2f dB\n",
+                   error ? 10 * log10(255.0 * 255.0 / error) : 99.0);
+    }
+}
+
 static const cmdreg_t img_cmd[] = {
     { "imagelist", IMG_List_f },
     { "screenshot", IMG_ScreenShot_f },
     { "screenshottga", IMG_ScreenShotTGA_f },
     { "screenshotjpg", IMG_ScreenShotJPG_f },
     { "screenshotpng", IMG_ScreenShotPNG_f },
+    { "imagebench", IMG_Benchmark_f },
+    { "imagecook", IMG_Cook_f },
     { NULL }
 };
 
@@ -1429,6 +2289,8 @@ void IMG_Init(void)
     r_texture_formats = Cvar_Get("r_texture_formats", "pjt", 0);
     r_texture_formats->changed = r_texture_formats_changed;
     r_texture_formats_changed(r_texture_formats);
+    r_texture_cache = Cvar_Get("r_texture_cache", "0", 0);
+    r_image_threads = Cvar_Get("r_image_threads", "0", 0);
 
     r_screenshot_format = Cvar_Get("gl_screenshot_format", "jpg", 0);
     r_screenshot_format = Cvar_Get("gl_screenshot_format", "png", 0);
@@ -1437,6 +2299,8 @@ void IMG_Init(void)
 
     Cmd_Register(img_cmd);
 
+    init_srgb_table();
+
     for (i = 0; i < RIMAGES_HASH; i++) {
         List_Init(&r_imageHash[i]);
     }
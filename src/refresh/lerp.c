@@ -0,0 +1,138 @@
+/*
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+//
+// lerp.c -- alias model frame interpolation kernels
+//
+// The SSE2 versions convert whole vertices at once and keep the scale and
+// move vectors in registers. Both versions perform the same operations in the same order.
+//
+
+#include "shared/shared.h"
+#include "refresh/lerp.h"
+
+#if USE_SSE2
+#include <emmintrin.h>
+#endif
+
+static inline void lerp_vert(float *out, float o0, float o1, float o2,
+                             float n0, float n1, float n2, const vec3_t backv,
+                             const vec3_t frontv, const vec3_t move)
+{
+    out[0] = move[0] + o0 * backv[0] + n0 * frontv[0];
+    out[1] = move[1] + o1 * backv[1] + n1 * frontv[1];
+    out[2] = move[2] + o2 * backv[2] + n2 * frontv[2];
+    out[3] = 0;
+}
+
+#if USE_SSE2
+
+static inline __m128 load_vec3(const vec3_t v)
+{
+    return _mm_setr_ps(v[0], v[1], v[2], 0);
+}
+
+void R_LerpVerts16(float *out, int outstride, const void *oldv, const void *newv,
+                   int count, const vec3_t backv, const vec3_t frontv, const vec3_t move)
+{
+    const int16_t *o = oldv;
+    const int16_t *n = newv;
+    __m128 b = load_vec3(backv);
+    __m128 f = load_vec3(frontv);
+    __m128 m = load_vec3(move);
+
+    // two vertices per load, sign extended to 32 bits
+    for (; count >= 2; count -= 2, o += 8, n += 8) {
+        __m128i ov = _mm_loadu_si128((const __m128i *)o);
+        __m128i nv = _mm_loadu_si128((const __m128i *)n);
+        __m128 o0 = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(ov, ov), 16));
+        __m128 o1 = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(ov, ov), 16));
+        __m128 n0 = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(nv, nv), 16));
+        __m128 n1 = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(nv, nv), 16));
+
+        _mm_storeu_ps(out, _mm_add_ps(_mm_add_ps(m, _mm_mul_ps(o0, b)), _mm_mul_ps(n0, f)));
+        out += outstride;
+        _mm_storeu_ps(out, _mm_add_ps(_mm_add_ps(m, _mm_mul_ps(o1, b)), _mm_mul_ps(n1, f)));
+        out += outstride;
+    }
+
+    if (count)
+        lerp_vert(out, o[0], o[1], o[2], n[0], n[1], n[2], backv, frontv, move);
+}
+
+void R_LerpVerts8(float *out, int outstride, const void *oldv, const void *newv,
+                  int count, const vec3_t backv, const vec3_t frontv, const vec3_t move)
+{
+    const uint8_t *o = oldv;
+    const uint8_t *n = newv;
+    __m128i zero = _mm_setzero_si128();
+    __m128 b = load_vec3(backv);
+    __m128 f = load_vec3(frontv);
+    __m128 m = load_vec3(move);
+    __m128i ov, nv, ow, nw;
+    __m128 r[4];
+    int i;
+
+    // four vertices per load, zero extended to 32 bits
+    for (; count >= 4; count -= 4, o += 16, n += 16) {
+        ov = _mm_loadu_si128((const __m128i *)o);
+        nv = _mm_loadu_si128((const __m128i *)n);
+
+        ow = _mm_unpacklo_epi8(ov, zero);
+        nw = _mm_unpacklo_epi8(nv, zero);
+        r[0] = _mm_add_ps(_mm_add_ps(m, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(ow, zero)), b)),
+                          _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(nw, zero)), f));
+        r[1] = _mm_add_ps(_mm_add_ps(m, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(ow, zero)), b)),
+                          _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(nw, zero)), f));
+
+        ow = _mm_unpackhi_epi8(ov, zero);
+        nw = _mm_unpackhi_epi8(nv, zero);
+        r[2] = _mm_add_ps(_mm_add_ps(m, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(ow, zero)), b)),
+                          _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(nw, zero)), f));
+        r[3] = _mm_add_ps(_mm_add_ps(m, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(ow, zero)), b)),
+                          _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(nw, zero)), f));
+
+        for (i = 0; i < 4; i++, out += outstride)
+            _mm_storeu_ps(out, r[i]);
+    }
+
+    for (; count; count--, o += 4, n += 4, out += outstride)
+        lerp_vert(out, o[0], o[1], o[2], n[0], n[1], n[2], backv, frontv, move);
+}
+
+#else
+
+void R_LerpVerts16(float *out, int outstride, const void *oldv, const void *newv,
+                   int count, const vec3_t backv, const vec3_t frontv, const vec3_t move)
+{
+    const int16_t *o = oldv;
+    const int16_t *n = newv;
+
+    for (; count; count--, o += 4, n += 4, out += outstride)
+        lerp_vert(out, o[0], o[1], o[2], n[0], n[1], n[2], backv, frontv, move);
+}
+
+void R_LerpVerts8(float *out, int outstride, const void *oldv, const void *newv,
+                  int count, const vec3_t backv, const vec3_t frontv, const vec3_t move)
+{
+    const uint8_t *o = oldv;
+    const uint8_t *n = newv;
+
+    for (; count; count--, o += 4, n += 4, out += outstride)
+        lerp_vert(out, o[0], o[1], o[2], n[0], n[1], n[2], backv, frontv, move);
+}
+
+#endif // !USE_SSE2
@@ -23,12 +23,14 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include "common/common.h"
 #include "common/files.h"
 #include "system/hunk.h"
+#include "system/system.h"
 #include "format/md2.h"
 #if USE_MD3
 #include "format/md3.h"
 #endif
 #include "format/sp2.h"
 #include "refresh/images.h"
+#include "refresh/lerp.h"
 #include "refresh/models.h"
 
 // during registration it is possible to have more models than could actually
@@ -392,6 +394,12 @@ qhandle_t R_RegisterModel(const char *name)
         goto fail2;
     }
 
+    // not every renderer supports every format
+    if (!load) {
+        ret = Q_ERR_UNKNOWN_FORMAT;
+        goto fail2;
+    }
+
     model = MOD_Alloc();
     if (!model) {
         ret = Q_ERR_OUT_OF_SLOTS;
@@ -447,6 +455,234 @@ model_t *MOD_ForHandle(qhandle_t h)
     return model;
 }
 
+/*
+===============
+MOD_Benchmark_f
+
+Runs the alias model loaders of the current renderer over every model
+matching the filter, timing each one. The models themselves are not
+registered, but the loaders look up skins with IMG_Find as usual, so the
+first run also times skin image loading and leaves those images registered
+until the next IMG_FreeUnused.
+===============
+*/
+static void MOD_Benchmark_f(void)
+{
+    const char  *filter = "models/*.md2;models/*.md3;players/*.md2;players/*.md3";
+    char        slowest[MAX_QPATH];
+    void        **list;
+    int         i, count, loaded, failed;
+    model_t     model;
+    byte        *rawdata;
+    ssize_t     len;
+    mod_load_t  load;
+    uint64_t    start, time, total, worst;
+    size_t      bytes;
+    qerror_t    ret;
+
+    if (Cmd_Argc() > 1) {
+        filter = Cmd_Argv(1);
+    }
+
+    list = FS_ListFiles(NULL, filter, FS_SEARCH_BYFILTER, &count);
+    if (!list) {
+        Com_Printf("No models found\n");
+        return;
+    }
+
+    loaded = failed = 0;
+    total = worst = 0;
+    bytes = 0;
+    slowest[0] = 0;
+
+    for (i = 0; i < count; i++) {
+        len = FS_LoadFile(list[i], (void **)&rawdata);
+        if (!rawdata) {
+            failed++;
+            continue;
+        }
+
+        load = NULL;
+        if (len >= 4) {
+            switch (LittleLong(*(uint32_t *)rawdata)) {
+            case MD2_IDENT:
+                load = MOD_LoadMD2;
+                break;
+#if USE_MD3
+            case MD3_IDENT:
+                load = MOD_LoadMD3;
+                break;
+#endif
+            }
+        }
+
+        if (!load) {
+            FS_FreeFile(rawdata);
+            continue;
+        }
+
+        memset(&model, 0, sizeof(model));
+        Q_strlcpy(model.name, list[i], sizeof(model.name));
+
+        start = Sys_Microseconds();
+        ret = load(&model, rawdata, len);
+        time = Sys_Microseconds() - start;
+
+        FS_FreeFile(rawdata);
+
+        if (ret) {
+            Com_EPrintf("Couldn't load %s: %s\n", (char *)list[i], Q_ErrorString(ret));
+            failed++;
+            continue;
+        }
+
+        bytes += model.hunk.cursize;
+        Hunk_Free(&model.hunk);
+
+        if (time > worst) {
+            worst = time;
+            Q_strlcpy(slowest, list[i], sizeof(slowest));
+        }
+        total += time;
+        loaded++;
+    }
+
+    FS_FreeList(list);
+
+    Com_Printf("%d models loaded in %.1f ms (%.2f ms avg), %d failed\n",
+               loaded, total * 1e-3, loaded ? total * 1e-3 / loaded : 0, failed);
+    if (loaded) {
+        Com_Printf("Slowest: %s (%.2f ms)\n", slowest, worst * 1e-3);
+        Com_Printf("Resident: %"PRIz" bytes\n", bytes);
+    }
+}
+
+/*
+================
+MOD_LerpBench_f
+
+Times CPU frame interpolation of a crowd of MD2 models, each one at a
+different frame, with the plain scalar loop and the shared lerp kernels.
+================
+*/
+static void MOD_LerpBench_f(void)
+{
+    const char      *name = "players/male/tris.md2";
+    const int       passes = 100;
+    dmd2header_t    header;
+    const dmd2frame_t *oldframe, *newframe;
+    const dmd2trivertx_t *oldv, *newv;
+    int16_t         *wide;
+    vec4_t          *out;
+    vec3_t          backv, frontv, move;
+    byte            *rawdata;
+    ssize_t         len;
+    static const char *const methods[3] = { "Scalar:", "8-bit:", "16-bit:" };
+    int             i, j, k, m, numverts, numframes, crowd;
+    uint64_t        start, time[3];
+
+    if (Cmd_Argc() > 1) {
+        name = Cmd_Argv(1);
+    }
+    crowd = Cmd_Argc() > 2 ? atoi(Cmd_Argv(2)) : 64;
+    clamp(crowd, 1, 4096);
+
+    len = FS_LoadFile(name, (void **)&rawdata);
+    if (!rawdata) {
+        Com_Printf("Couldn't load %s: %s\n", name, Q_ErrorString(len));
+        return;
+    }
+
+    if (len < sizeof(header)) {
+        goto bad;
+    }
+    memcpy(&header, rawdata, sizeof(header));
+    for (i = 0; i < sizeof(header) / 4; i++) {
+        ((uint32_t *)&header)[i] = LittleLong(((uint32_t *)&header)[i]);
+    }
+    if (header.ident != MD2_IDENT || header.num_frames < 1 ||
+        header.num_frames > MD2_MAX_FRAMES || header.num_xyz < 1 ||
+        header.num_xyz > MD2_MAX_VERTS || header.framesize <
+        sizeof(dmd2frame_t) + (header.num_xyz - 1) * sizeof(dmd2trivertx_t) ||
+        header.ofs_frames > len || (uint64_t)header.num_frames *
+        header.framesize > len - header.ofs_frames) {
+        goto bad;
+    }
+
+    numverts = header.num_xyz;
+    numframes = header.num_frames;
+
+    // 16-bit copy of all frames in the layout used by the GL renderer
+    wide = Z_Malloc(numframes * numverts * 4 * sizeof(*wide));
+    for (i = 0; i < numframes; i++) {
+        newframe = (dmd2frame_t *)(rawdata + header.ofs_frames + i * header.framesize);
+        for (j = 0; j < numverts; j++) {
+            int16_t *w = &wide[(i * numverts + j) * 4];
+            w[0] = newframe->verts[j].v[0];
+            w[1] = newframe->verts[j].v[1];
+            w[2] = newframe->verts[j].v[2];
+            w[3] = 0;
+        }
+    }
+    out = Z_Malloc(numverts * sizeof(*out));
+
+    // each method runs the whole crowd for all passes in one timed block,
+    // per model timings would be below the clock resolution
+    for (m = 0; m < 3; m++) {
+        start = Sys_Microseconds();
+        for (i = 0; i < passes; i++) {
+            for (j = 0; j < crowd; j++) {
+                int oldnum = (i + j) % numframes;
+                int newnum = (i + j + 1) % numframes;
+                float frontlerp = (j + 1) / (float)(crowd + 1);
+                float backlerp = 1 - frontlerp;
+
+                oldframe = (dmd2frame_t *)(rawdata + header.ofs_frames + oldnum * header.framesize);
+                newframe = (dmd2frame_t *)(rawdata + header.ofs_frames + newnum * header.framesize);
+                for (k = 0; k < 3; k++) {
+                    backv[k] = LittleFloat(oldframe->scale[k]) * backlerp;
+                    frontv[k] = LittleFloat(newframe->scale[k]) * frontlerp;
+                    move[k] = LittleFloat(oldframe->translate[k]) * backlerp +
+                              LittleFloat(newframe->translate[k]) * frontlerp;
+                }
+
+                if (m == 0) {
+                    oldv = oldframe->verts;
+                    newv = newframe->verts;
+                    for (k = 0; k < numverts; k++, oldv++, newv++) {
+                        out[k][0] = move[0] + oldv->v[0] * backv[0] + newv->v[0] * frontv[0];
+                        out[k][1] = move[1] + oldv->v[1] * backv[1] + newv->v[1] * frontv[1];
+                        out[k][2] = move[2] + oldv->v[2] * backv[2] + newv->v[2] * frontv[2];
+                    }
+                } else if (m == 1) {
+                    R_LerpVerts8(out[0], 4, oldframe->verts, newframe->verts,
+                                 numverts, backv, frontv, move);
+                } else {
+                    R_LerpVerts16(out[0], 4, &wide[oldnum * numverts * 4],
+                                  &wide[newnum * numverts * 4], numverts, backv, frontv, move);
+                }
+            }
+        }
+        time[m] = Sys_Microseconds() - start;
+    }
+
+    Z_Free(out);
+    Z_Free(wide);
+    FS_FreeFile(rawdata);
+
+    Com_Printf("%d x %s (%d verts, %d frames), %d passes\n",
+               crowd, name, numverts, numframes, passes);
+    for (m = 0; m < 3; m++) {
+        Com_Printf("%-8s %.3f ms per pass (%.2fx)\n", methods[m], time[m] * 1e-3 / passes,
+                   time[m] ? (double)time[0] / time[m] : 0);
+    }
+    return;
+
+bad:
+    Com_Printf("%s is not a valid MD2 model\n", name);
+    FS_FreeFile(rawdata);
+}
+
 void MOD_Init(void)
 {
     if (r_numModels) {
@@ -454,11 +690,15 @@ void MOD_Init(void)
     }
 
     Cmd_AddCommand("modellist", MOD_List_f);
+    Cmd_AddCommand("modelbench", MOD_Benchmark_f);
+    Cmd_AddCommand("lerpbench", MOD_LerpBench_f);
 }
 
 void MOD_Shutdown(void)
 {
     MOD_FreeAll();
     Cmd_RemoveCommand("modellist");
+    Cmd_RemoveCommand("modelbench");
+    Cmd_RemoveCommand("lerpbench");
 }
 
@@ -21,6 +21,7 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 ** use a real variable to control lerping
 */
 #include "sw.h"
+#include "refresh/lerp.h"
 
 int             r_amodels_drawn;
 
@@ -218,16 +219,16 @@ R_AliasTransformFinalVerts
 */
 static void R_AliasTransformFinalVerts(int numpoints, finalvert_t *fv, maliasvert_t *oldv, maliasvert_t *newv)
 {
+    static vec4_t   lerped_verts[MAX_ALIAS_VERTS];
     int i;
 
-    for (i = 0; i < numpoints; i++, fv++, oldv++, newv++) {
+    R_LerpVerts8(lerped_verts[0], 4, oldv, newv, numpoints,
+                 r_lerp_backv, r_lerp_frontv, r_lerp_move);
+
+    for (i = 0; i < numpoints; i++, fv++, newv++) {
         float       lightcos;
         const vec_t *plightnormal;
-        vec3_t      lerped_vert;
-
-        lerped_vert[0] = r_lerp_move[0] + oldv->v[0] * r_lerp_backv[0] + newv->v[0] * r_lerp_frontv[0];
-        lerped_vert[1] = r_lerp_move[1] + oldv->v[1] * r_lerp_backv[1] + newv->v[1] * r_lerp_frontv[1];
-        lerped_vert[2] = r_lerp_move[2] + oldv->v[2] * r_lerp_backv[2] + newv->v[2] * r_lerp_frontv[2];
+        vec_t       *lerped_vert = lerped_verts[i];
 
         plightnormal = bytedirs[newv->lightnormalindex];
 
@@ -499,7 +500,7 @@ static void R_AliasSetupLighting(void)
     if (currententity->flags & RF_FULLBRIGHT) {
         VectorSet(light, 1, 1, 1);
     } else {
-        R_LightPoint(currententity->origin, light);
+        R_LightPoint_SW(currententity->origin, light);
     }
 
     if (currententity->flags & RF_MINLIGHT) {
@@ -6,6 +6,9 @@ static void BLOCK_FUNC(void)
     int     lightleftstep[3], lightrightstep[3];
     int     v, i, b, lightstep[3], light[3];
     byte    *psource, *prowdest;
+#if USE_SSE2
+    int     simd = sw_simd->integer;
+#endif
 
     psource = pbasesource;
     prowdest = prowdestbase;
@@ -35,6 +38,18 @@ static void BLOCK_FUNC(void)
             light[1] = lightright[1];
             light[2] = lightright[2];
 
+#if USE_SSE2
+            if (simd) {
+                __m128i vlight = _mm_setr_epi32(light[0], light[1], light[2], 0);
+                __m128i vstep = _mm_setr_epi32(lightstep[0], lightstep[1], lightstep[2], 0);
+                __m128i vstep2 = _mm_add_epi32(vstep, vstep);
+
+                for (b = BLOCK_SIZE - 2; b >= 0; b -= 2) {
+                    R_LightTexels2(prowdest + b * TEX_BYTES, psource + b * TEX_BYTES, vlight, vstep);
+                    vlight = _mm_add_epi32(vlight, vstep2);
+                }
+            } else
+#endif
             for (b = BLOCK_SIZE - 1; b >= 0; b--) {
                 prowdest[b * TEX_BYTES + 0] = (psource[b * TEX_BYTES + 0] * light[0]) >> 16;
                 prowdest[b * TEX_BYTES + 1] = (psource[b * TEX_BYTES + 1] * light[1]) >> 16;
@@ -102,7 +102,7 @@ float R_ClampScale(cvar_t *var)
     return 1.0f;
 }
 
-void R_SetScale(float scale)
+void R_SetScale_SW(float scale)
 {
 }
 
@@ -117,25 +117,25 @@ void R_InitDraw(void)
     draw.clip.bottom = r_config.height;
 }
 
-void R_ClearColor(void)
+void R_ClearColor_SW(void)
 {
     draw.colors[0].u32 = U32_WHITE;
     draw.colors[1].u32 = U32_WHITE;
 }
 
-void R_SetAlpha(float alpha)
+void R_SetAlpha_SW(float alpha)
 {
     draw.colors[0].u8[3] = alpha * 255;
     draw.colors[1].u8[3] = alpha * 255;
 }
 
-void R_SetColor(uint32_t color)
+void R_SetColor_SW(uint32_t color)
 {
     draw.colors[0].u32 = color;
     draw.colors[1].u8[3] = draw.colors[0].u8[3];
 }
 
-void R_SetClipRect(const clipRect_t *clip)
+void R_SetClipRect_SW(const clipRect_t *clip)
 {
     if (!clip) {
 clear:
@@ -381,7 +381,7 @@ static void R_DrawFixedData(int x, int y, int w, int h,
 R_DrawStretchPic
 =============
 */
-void R_DrawStretchPic(int x, int y, int w, int h, qhandle_t pic)
+void R_DrawStretchPic_SW(int x, int y, int w, int h, qhandle_t pic)
 {
     image_t *image = IMG_ForHandle(pic);
 
@@ -398,7 +398,7 @@ void R_DrawStretchPic(int x, int y, int w, int h, qhandle_t pic)
 R_DrawStretcpic
 =============
 */
-void R_DrawPic(int x, int y, qhandle_t pic)
+void R_DrawPic_SW(int x, int y, qhandle_t pic)
 {
     image_t *image = IMG_ForHandle(pic);
 
@@ -431,7 +431,7 @@ static inline void draw_char(int x, int y, int flags, int ch, image_t *image)
     R_DrawFixedData(x, y, CHAR_WIDTH, CHAR_HEIGHT, image->upload_width * TEX_BYTES, data, draw.colors[ch >> 7]);
 }
 
-void R_DrawChar(int x, int y, int flags, int ch, qhandle_t font)
+void R_DrawChar_SW(int x, int y, int flags, int ch, qhandle_t font)
 {
     image_t *image;
 
@@ -450,7 +450,7 @@ void R_DrawChar(int x, int y, int flags, int ch, qhandle_t font)
 R_DrawString
 ===============
 */
-int R_DrawString(int x, int y, int flags, size_t maxChars,
+int R_DrawString_SW(int x, int y, int flags, size_t maxChars,
                  const char *string, qhandle_t font)
 {
     image_t *image;
@@ -479,7 +479,7 @@ This repeats a 64*64 tile graphic to fill the screen around a sized down
 refresh window.
 =============
 */
-void R_TileClear(int x, int y, int w, int h, qhandle_t pic)
+void R_TileClear_SW(int x, int y, int w, int h, qhandle_t pic)
 {
     int         i, j;
     byte        *psrc;
@@ -529,7 +529,7 @@ R_DrawFill
 Fills a box of pixels with a single color
 =============
 */
-void R_DrawFill8(int x, int y, int w, int h, int c)
+void R_DrawFill8_SW(int x, int y, int w, int h, int c)
 {
     byte        *dest;
     int         u, v;
@@ -562,7 +562,7 @@ void R_DrawFill8(int x, int y, int w, int h, int c)
     }
 }
 
-void R_DrawFill32(int x, int y, int w, int h, uint32_t c)
+void R_DrawFill32_SW(int x, int y, int w, int h, uint32_t c)
 {
     byte        *dest;
     int         u, v;
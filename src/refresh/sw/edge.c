@@ -556,7 +556,7 @@ Each surface has a linked list of its visible spans
 void R_ScanEdges(void)
 {
     int     iv, bottom;
-    byte    basespans[MAXSPANS * sizeof(espan_t) + CACHE_SIZE];
+    static byte basespans[MAXSPANS * sizeof(espan_t) + CACHE_SIZE];
     espan_t *basespan_p;
     surf_t  *s;
 
@@ -25,7 +25,7 @@ static byte gammatable[256];
 IMG_Unload
 ================
 */
-void IMG_Unload(image_t *image)
+void IMG_Unload_SW(image_t *image)
 {
     Z_Free(image->pixels[0]);
     image->pixels[0] = NULL;
@@ -51,7 +51,7 @@ static void R_LightScaleTexture(byte *in, int inwidth, int inheight)
 IMG_Load
 ================
 */
-void IMG_Load(image_t *image, byte *pic)
+void IMG_Load_SW(image_t *image, byte *pic)
 {
     int     i, c, b;
     int     width, height;
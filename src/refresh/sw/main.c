@@ -86,6 +86,7 @@ cvar_t  *sw_waterwarp;
 cvar_t  *sw_dynamic;
 cvar_t  *sw_modulate;
 cvar_t  *sw_lockpvs;
+cvar_t  *sw_simd;
 
 //Start Added by Lewey
 // These flags allow you to turn SIRDS on and
@@ -150,6 +151,78 @@ void R_InitTurb(void)
     }
 }
 
+#define MAX_BENCH_FRAMES    1024
+
+/*
+===============
+R_Benchmark_f
+
+Renders the last view along a fixed yaw sweep once with the scalar span
+kernels and once with the SIMD ones, reporting frame times and comparing
+per-frame image hashes between the two. The surface cache is flushed
+before each pass so neither one reuses surfaces built by the other.
+===============
+*/
+static void R_Benchmark_f(void)
+{
+    static uint32_t hashes[2][MAX_BENCH_FRAMES];
+    uint64_t    times[2], start;
+    refdef_t    base, fd;
+    int         i, y, pass, frames, simd, mismatches;
+    uint32_t    hash;
+    byte        *row;
+    size_t      j;
+
+    if (!r_worldmodel || !r_newrefdef.width) {
+        Com_Printf("No view to render.\n");
+        return;
+    }
+
+    frames = Cmd_Argc() > 1 ? atoi(Cmd_Argv(1)) : 64;
+    clamp(frames, 1, MAX_BENCH_FRAMES);
+
+    base = fd = r_newrefdef;
+    simd = sw_simd->integer;
+
+    for (pass = 0; pass < 2; pass++) {
+        Cvar_SetInteger(sw_simd, pass, FROM_CODE);
+
+        // both passes start with an empty surface cache
+        D_FlushCaches();
+
+        start = Sys_Microseconds();
+        for (i = 0; i < frames; i++) {
+            fd.viewangles[YAW] = base.viewangles[YAW] + i * 360.0f / frames;
+            R_RenderFrame_SW(&fd);
+
+            // FNV-1a over the rendered rectangle
+            hash = 2166136261U;
+            row = vid.buffer + fd.y * vid.rowbytes + fd.x * VID_BYTES;
+            for (y = 0; y < fd.height; y++, row += vid.rowbytes) {
+                for (j = 0; j < fd.width * VID_BYTES; j++)
+                    hash = (hash ^ row[j]) * 16777619U;
+            }
+            hashes[pass][i] = hash;
+        }
+        times[pass] = Sys_Microseconds() - start;
+    }
+
+    Cvar_SetInteger(sw_simd, simd, FROM_CODE);
+
+    // leave the frame buffer as it was
+    R_RenderFrame_SW(&base);
+
+    mismatches = 0;
+    for (i = 0; i < frames; i++)
+        if (hashes[0][i] != hashes[1][i])
+            mismatches++;
+
+    Com_Printf("%d frames at %dx%d, %d hash mismatches\n",
+               frames, fd.width, fd.height, mismatches);
+    Com_Printf("scalar: %.3f ms/frame\n", times[0] * 1e-3 / frames);
+    Com_Printf("simd:   %.3f ms/frame\n", times[1] * 1e-3 / frames);
+}
+
 static void R_Register(void)
 {
     sw_aliasstats = Cvar_Get("sw_polymodelstats", "0", 0);
@@ -166,6 +239,7 @@ static void R_Register(void)
     sw_dynamic = Cvar_Get("sw_dynamic", "1", 0);
     sw_modulate = Cvar_Get("sw_modulate", "1", 0);
     sw_lockpvs = Cvar_Get("sw_lockpvs", "0", 0);
+    sw_simd = Cvar_Get("sw_simd", "1", 0);
 
     //Start Added by Lewey
     sw_drawsird = Cvar_Get("sw_drawsird", "0", 0);
@@ -181,14 +255,16 @@ static void R_Register(void)
     vid_gamma = Cvar_Get("vid_gamma", "1.0", CVAR_ARCHIVE | CVAR_FILES);
 
     Cmd_AddCommand("scdump", D_SCDump_f);
+    Cmd_AddCommand("sw_benchmark", R_Benchmark_f);
 }
 
 static void R_UnRegister(void)
 {
     Cmd_RemoveCommand("scdump");
+    Cmd_RemoveCommand("sw_benchmark");
 }
 
-void R_ModeChanged(int width, int height, int flags, int rowbytes, void *pixels)
+void R_ModeChanged_SW(int width, int height, int flags, int rowbytes, void *pixels)
 {
     vid.width = width > MAXWIDTH ? MAXWIDTH : width;
     vid.height = height > MAXHEIGHT ? MAXHEIGHT : height;
@@ -231,7 +307,7 @@ void R_ModeChanged(int width, int height, int flags, int rowbytes, void *pixels)
 R_Init
 ===============
 */
-qboolean R_Init(qboolean total)
+qboolean R_Init_SW(qboolean total)
 {
     Com_DPrintf("R_Init( %i )\n", total);
 
@@ -245,7 +321,7 @@ qboolean R_Init(qboolean total)
     Com_DPrintf("ref_soft " VERSION ", " __DATE__ "\n");
 
     // create the window
-    if (!VID_Init())
+    if (!VID_Init(GAPI_SOFTWARE))
         return qfalse;
 
     R_Register();
@@ -277,7 +353,7 @@ qboolean R_Init(qboolean total)
 R_Shutdown
 ===============
 */
-void R_Shutdown(qboolean total)
+void R_Shutdown_SW(qboolean total)
 {
     Com_DPrintf("R_Shutdown( %i )\n", total);
 
@@ -765,7 +841,7 @@ static void R_EdgeDrawing(void)
 
 //=======================================================================
 
-byte *IMG_ReadPixels(int *width, int *height, int *rowbytes)
+byte *IMG_ReadPixels_SW(int *width, int *height, int *rowbytes)
 {
     byte *pixels;
     byte *src, *dst;
@@ -800,7 +876,7 @@ R_RenderFrame
 
 @@@@@@@@@@@@@@@@
 */
-void R_RenderFrame(refdef_t *fd)
+void R_RenderFrame_SW(refdef_t *fd)
 {
     r_newrefdef = *fd;
 
@@ -855,12 +931,12 @@ void R_RenderFrame(refdef_t *fd)
 /*
 ** R_BeginFrame
 */
-void R_BeginFrame(void)
+void R_BeginFrame_SW(void)
 {
     VID_BeginFrame();
 }
 
-void R_EndFrame(void)
+void R_EndFrame_SW(void)
 {
     VID_EndFrame();
 }
@@ -920,4 +996,49 @@ void R_DrawBeam(entity_t *e)
     }
 }
 
-void R_AddDecal(decal_t *d) {}
+void R_AddDecal_SW(decal_t *d) {}
+
+void R_SetAlphaScale_SW(float alpha)
+{
+    // nop - only used by the RTX renderer
+}
+
+qboolean R_InterceptKey_SW(unsigned key, qboolean down)
+{
+    return qfalse;
+}
+
+void R_RegisterFunctionsSW(void)
+{
+    R_Init = R_Init_SW;
+    R_Shutdown = R_Shutdown_SW;
+    R_BeginRegistration = R_BeginRegistration_SW;
+    R_EndRegistration = R_EndRegistration_SW;
+    R_SetSky = R_SetSky_SW;
+    R_RenderFrame = R_RenderFrame_SW;
+    R_LightPoint = R_LightPoint_SW;
+    R_ClearColor = R_ClearColor_SW;
+    R_SetAlpha = R_SetAlpha_SW;
+    R_SetAlphaScale = R_SetAlphaScale_SW;
+    R_SetColor = R_SetColor_SW;
+    R_SetClipRect = R_SetClipRect_SW;
+    R_SetScale = R_SetScale_SW;
+    R_DrawChar = R_DrawChar_SW;
+    R_DrawString = R_DrawString_SW;
+    R_DrawPic = R_DrawPic_SW;
+    R_DrawStretchPic = R_DrawStretchPic_SW;
+    R_TileClear = R_TileClear_SW;
+    R_DrawFill8 = R_DrawFill8_SW;
+    R_DrawFill32 = R_DrawFill32_SW;
+    R_BeginFrame = R_BeginFrame_SW;
+    R_EndFrame = R_EndFrame_SW;
+    R_ModeChanged = R_ModeChanged_SW;
+    R_AddDecal = R_AddDecal_SW;
+    R_InterceptKey = R_InterceptKey_SW;
+    IMG_Load = IMG_Load_SW;
+    IMG_Unload = IMG_Unload_SW;
+    IMG_ReadPixels = IMG_ReadPixels_SW;
+    MOD_LoadMD2 = MOD_LoadMD2_SW;
+    MOD_LoadMD3 = NULL;
+    MOD_Reference = MOD_Reference_SW;
+}
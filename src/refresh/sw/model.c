@@ -154,7 +154,7 @@ ALIAS MODELS
 Mod_LoadAliasModel
 =================
 */
-qerror_t MOD_LoadMD2(model_t *model, const void *rawdata, size_t length)
+qerror_t MOD_LoadMD2_SW(model_t *model, const void *rawdata, size_t length)
 {
     dmd2header_t header;
     dmd2frame_t *src_frame;
@@ -287,7 +287,7 @@ fail:
     return ret;
 }
 
-void MOD_Reference(model_t *model)
+void MOD_Reference_SW(model_t *model)
 {
     int     i;
 
@@ -319,7 +319,7 @@ R_BeginRegistration
 Specifies the model that will be used as the world
 @@@@@@@@@@@@@@@@@@@@@
 */
-void R_BeginRegistration(const char *model)
+void R_BeginRegistration_SW(const char *model)
 {
     char        fullname[MAX_QPATH];
     bsp_t       *bsp;
@@ -362,7 +362,7 @@ R_EndRegistration
 
 @@@@@@@@@@@@@@@@@@@@@
 */
-void R_EndRegistration(void)
+void R_EndRegistration_SW(void)
 {
     MOD_FreeUnused();
     IMG_FreeUnused();
@@ -21,6 +21,35 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 
 #include "sw.h"
 
+// the vector paths write whole 32-bit destination pixels
+#define USE_SIMD_SPANS  (USE_SSE2 && VID_BYTES == 4)
+
+#if USE_SIMD_SPANS
+#include <emmintrin.h>
+
+/*
+=============
+D_StoreTexels4
+
+Converts four RGBA texels to the BGR frame buffer layout and stores them,
+leaving the fourth byte of each destination pixel untouched.
+=============
+*/
+static inline void D_StoreTexels4(byte *pdest, __m128i texels)
+{
+    const __m128i   mask_lo = _mm_set1_epi32(0x000000ff);
+    const __m128i   mask_g = _mm_set1_epi32(0x0000ff00);
+    const __m128i   mask_x = _mm_set1_epi32(0xff000000);
+    __m128i         rb, dst;
+
+    rb = _mm_or_si128(_mm_slli_epi32(_mm_and_si128(texels, mask_lo), 16),
+                      _mm_and_si128(_mm_srli_epi32(texels, 16), mask_lo));
+    dst = _mm_and_si128(_mm_loadu_si128((__m128i *)pdest), mask_x);
+    dst = _mm_or_si128(dst, _mm_or_si128(rb, _mm_and_si128(texels, mask_g)));
+    _mm_storeu_si128((__m128i *)pdest, dst);
+}
+#endif
+
 /*
 =============
 D_WarpScreen
@@ -89,6 +118,9 @@ void D_DrawTurbulent16(espan_t *pspan, int *warptable)
     float           sdivz16stepu, tdivz16stepu, zi16stepu;
     int             *turb;
     int             turb_s, turb_t;
+#if USE_SIMD_SPANS
+    int             simd = sw_simd->integer;
+#endif
 
     turb = warptable + ((int)(r_newrefdef.time * SPEED) & (CYCLE - 1));
 
@@ -194,7 +226,26 @@ void D_DrawTurbulent16(espan_t *pspan, int *warptable)
             s = s & ((CYCLE << 16) - 1);
             t = t & ((CYCLE << 16) - 1);
 
-            do {
+#if USE_SIMD_SPANS
+            if (simd) {
+                uint32_t    texels[4];
+                int         i;
+
+                for (; spancount >= 4; spancount -= 4) {
+                    for (i = 0; i < 4; i++) {
+                        turb_s = ((s + turb[(t >> 16) & (CYCLE - 1)]) >> 16) & TURB_MASK;
+                        turb_t = ((t + turb[(s >> 16) & (CYCLE - 1)]) >> 16) & TURB_MASK;
+                        texels[i] = *(uint32_t *)(pbase + (turb_t * TURB_SIZE * TEX_BYTES) + turb_s * TEX_BYTES);
+                        s += sstep;
+                        t += tstep;
+                    }
+                    D_StoreTexels4(pdest, _mm_loadu_si128((__m128i *)texels));
+                    pdest += 4 * VID_BYTES;
+                }
+            }
+#endif
+
+            for (; spancount > 0; spancount--) {
                 turb_s = ((s + turb[(t >> 16) & (CYCLE - 1)]) >> 16) & TURB_MASK;
                 turb_t = ((t + turb[(s >> 16) & (CYCLE - 1)]) >> 16) & TURB_MASK;
                 ptex = pbase + (turb_t * TURB_SIZE * TEX_BYTES) + turb_s * TEX_BYTES;
@@ -204,7 +255,7 @@ void D_DrawTurbulent16(espan_t *pspan, int *warptable)
                 pdest += VID_BYTES;
                 s += sstep;
                 t += tstep;
-            } while (--spancount > 0);
+            }
 
             s = snext;
             t = tnext;
@@ -226,6 +277,9 @@ void D_DrawSpans16(espan_t *pspan)
     fixed16_t       s, t, snext, tnext, sstep, tstep;
     float           sdivz, tdivz, zi, z, du, dv, spancountminus1;
     float           sdivz16stepu, tdivz16stepu, zi16stepu;
+#if USE_SIMD_SPANS
+    int             simd = sw_simd->integer;
+#endif
 
     sstep = 0;  // keep compiler happy
     tstep = 0;  // ditto
@@ -326,7 +380,25 @@ void D_DrawSpans16(espan_t *pspan)
                 }
             }
 
-            do {
+#if USE_SIMD_SPANS
+            if (simd) {
+                __m128i texels;
+
+                for (; spancount >= 4; spancount -= 4) {
+                    texels = _mm_setr_epi32(
+                        *(uint32_t *)(pbase + (s >> 16) * TEX_BYTES + (t >> 16) * cachewidth),
+                        *(uint32_t *)(pbase + ((s + sstep) >> 16) * TEX_BYTES + ((t + tstep) >> 16) * cachewidth),
+                        *(uint32_t *)(pbase + ((s + sstep * 2) >> 16) * TEX_BYTES + ((t + tstep * 2) >> 16) * cachewidth),
+                        *(uint32_t *)(pbase + ((s + sstep * 3) >> 16) * TEX_BYTES + ((t + tstep * 3) >> 16) * cachewidth));
+                    D_StoreTexels4(pdest, texels);
+                    pdest += 4 * VID_BYTES;
+                    s += sstep * 4;
+                    t += tstep * 4;
+                }
+            }
+#endif
+
+            for (; spancount > 0; spancount--) {
                 ptex = pbase + (s >> 16) * TEX_BYTES + (t >> 16) * cachewidth;
                 pdest[0] = ptex[2];
                 pdest[1] = ptex[1];
@@ -334,7 +406,7 @@ void D_DrawSpans16(espan_t *pspan)
                 pdest += VID_BYTES;
                 s += sstep;
                 t += tstep;
-            } while (--spancount > 0);
+            }
 
             s = snext;
             t = tnext;
@@ -357,6 +429,9 @@ void D_DrawZSpans(espan_t *pspan)
     uint32_t        ltemp;
     float           zi;
     float           du, dv;
+#if USE_SIMD_SPANS
+    int             simd = sw_simd->integer;
+#endif
 
 // FIXME: check for clamping/range problems
 // we count on FP exceptions being turned off to avoid range problems
@@ -381,6 +456,25 @@ void D_DrawZSpans(espan_t *pspan)
             count--;
         }
 
+#if USE_SIMD_SPANS
+        if (simd && count >= 8) {
+            __m128i vizi, vstep8, lo, hi;
+
+            // izi of the next 8 pixels, packed to 16 bit
+            vizi = _mm_add_epi32(_mm_set1_epi32(izi), _mm_setr_epi32(0, izistep, izistep * 2, izistep * 3));
+            vstep8 = _mm_set1_epi32(izistep * 8);
+            do {
+                lo = _mm_srai_epi32(vizi, 16);
+                hi = _mm_srai_epi32(_mm_add_epi32(vizi, _mm_set1_epi32(izistep * 4)), 16);
+                _mm_storeu_si128((__m128i *)pdest, _mm_packs_epi32(lo, hi));
+                vizi = _mm_add_epi32(vizi, vstep8);
+                izi += izistep * 8;
+                pdest += 8;
+                count -= 8;
+            } while (count >= 8);
+        }
+#endif
+
         if ((doublecount = count >> 1) > 0) {
             do {
                 ltemp = izi >> 16;
@@ -19,6 +19,10 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 
 #include "sw.h"
 
+#if USE_SSE2
+#include <emmintrin.h>
+#endif
+
 drawsurf_t  r_drawsurf;
 
 static int          sourcetstep;
@@ -43,9 +47,6 @@ static void (*surfmiptable[4])(void) = {
     R_DrawSurfaceBlock8_mip3
 };
 
-static int          sc_size;
-static surfcache_t  *sc_rover, *sc_base;
-
 /*
 ===============
 R_TextureAnimation
@@ -144,6 +145,43 @@ static void R_DrawSurface(void)
 
 //=============================================================================
 
+#if USE_SSE2
+/*
+================
+R_LightTexels2
+
+Modulates two adjacent texels by their per-channel light. The lower texel
+gets light + step, matching the right-to-left order of the scalar loop.
+The result keeps the low byte of (texel * light) >> 16, just like the
+scalar byte stores, and the alpha bytes of dest are preserved.
+================
+*/
+static inline void R_LightTexels2(byte *dest, const byte *src, __m128i light, __m128i step)
+{
+    const __m128i   zero = _mm_setzero_si128();
+    const __m128i   mask_lo = _mm_set1_epi16(0x00ff);
+    const __m128i   mask_a = _mm_set1_epi32(0xff000000);
+    __m128i         l0, l1, lo, hi, texels, res;
+
+    l0 = _mm_add_epi32(light, step);
+    l1 = light;
+
+    // split light into signed high and unsigned low 16-bit halves so that
+    // texel * light >> 16 == texel * hi + (texel * lo >> 16)
+    lo = _mm_packs_epi32(_mm_srai_epi32(_mm_slli_epi32(l0, 16), 16),
+                         _mm_srai_epi32(_mm_slli_epi32(l1, 16), 16));
+    hi = _mm_packs_epi32(_mm_srai_epi32(l0, 16), _mm_srai_epi32(l1, 16));
+
+    texels = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)src), zero);
+    res = _mm_add_epi16(_mm_mullo_epi16(texels, hi), _mm_mulhi_epu16(texels, lo));
+    res = _mm_packus_epi16(_mm_and_si128(res, mask_lo), zero);
+
+    res = _mm_or_si128(_mm_andnot_si128(mask_a, res),
+                       _mm_and_si128(mask_a, _mm_loadl_epi64((const __m128i *)dest)));
+    _mm_storel_epi64((__m128i *)dest, res);
+}
+#endif
+
 #define BLOCK_FUNC R_DrawSurfaceBlock8_mip0
 #define BLOCK_SHIFT 4
 #include "block.h"
@@ -163,6 +201,80 @@ static void R_DrawSurface(void)
 //============================================================================
 
 
+/*
+==============================================================================
+
+SURFACE CACHE
+
+Lit surfaces live in blocks carved out of a single arena. Every block
+belongs to a size class spaced a quarter octave apart, and each class keeps
+its live blocks on an LRU chain. When the arena is exhausted, the least
+recently drawn block of the requested class (or of a few slightly larger
+ones) is evicted and reused in place, so a miss never disturbs surfaces
+of other sizes. Only when no block fits at all is the whole cache flushed.
+
+==============================================================================
+*/
+
+#define SC_MIN_BLOCK    64
+#define SC_MAX_CLASSES  64
+#define SC_CLASS_SPAN   4   // how many larger classes a miss may steal from
+
+typedef struct {
+    list_t      lru;        // least recently used first
+    int         size;       // block size including header
+    int         numlive;
+} sizeclass_t;
+
+static byte         *sc_base;
+static int          sc_size, sc_used;
+static sizeclass_t  sc_classes[SC_MAX_CLASSES];
+static int          sc_numclasses;
+
+static struct {
+    unsigned    hits;
+    unsigned    rebuilds;   // stale block redrawn in place
+    unsigned    misses;
+    unsigned    evictions;
+    unsigned    thrashed;   // evicted blocks already drawn this frame
+    unsigned    flushes;
+} sc_stats;
+
+static void D_SCInitClasses(void)
+{
+    int     maxsize = 0x10000 * TEX_BYTES + sizeof(surfcache_t) - 4;
+    int     base, size;
+
+    sc_numclasses = 0;
+    base = size = SC_MIN_BLOCK;
+    do {
+        if (sc_numclasses == SC_MAX_CLASSES)
+            Com_Error(ERR_FATAL, "D_SCInitClasses: too many size classes");
+        List_Init(&sc_classes[sc_numclasses].lru);
+        sc_classes[sc_numclasses].size = size;
+        sc_classes[sc_numclasses].numlive = 0;
+        sc_numclasses++;
+        if (size == base * 2)
+            base = size;
+        size += base / 4;
+    } while (sc_classes[sc_numclasses - 1].size < maxsize);
+}
+
+static int D_SCSizeClass(int size)
+{
+    int     lo = 0, hi = sc_numclasses - 1;
+
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (sc_classes[mid].size < size)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    return lo;
+}
+
 /*
 ================
 R_InitCaches
@@ -195,12 +307,11 @@ void R_InitCaches(void)
     Com_DPrintf("%ik surface cache\n", size / 1024);
 
     sc_size = size;
-    sc_base = (surfcache_t *)R_Malloc(size);
-    sc_rover = sc_base;
+    sc_used = 0;
+    sc_base = R_Malloc(size);
 
-    sc_base->next = NULL;
-    sc_base->owner = NULL;
-    sc_base->size = sc_size;
+    D_SCInitClasses();
+    memset(&sc_stats, 0, sizeof(sc_stats));
 }
 
 void R_FreeCaches(void)
@@ -211,7 +322,8 @@ void R_FreeCaches(void)
     }
 
     sc_size = 0;
-    sc_rover = NULL;
+    sc_used = 0;
+    sc_numclasses = 0;
 }
 
 /*
@@ -221,21 +333,72 @@ D_FlushCaches
 */
 void D_FlushCaches(void)
 {
+    sizeclass_t     *sc;
     surfcache_t     *c;
+    int             i;
 
     if (!sc_base)
         return;
 
-    for (c = sc_base; c; c = c->next) {
-        if (c->owner) {
-            *c->owner = NULL;
+    for (i = 0, sc = sc_classes; i < sc_numclasses; i++, sc++) {
+        LIST_FOR_EACH(surfcache_t, c, &sc->lru, entry) {
+            if (c->owner) {
+                *c->owner = NULL;
+            }
         }
+        List_Init(&sc->lru);
+        sc->numlive = 0;
+    }
+
+    sc_used = 0;
+}
+
+/*
+=================
+D_SCTakeBlock
+
+Returns a block of at least the given class, either freshly carved from
+the arena or evicted from the LRU chains. NULL if nothing fits.
+=================
+*/
+static surfcache_t *D_SCTakeBlock(int class)
+{
+    sizeclass_t     *sc = &sc_classes[class];
+    surfcache_t     *new, *c;
+    int             i, last;
+
+    if (sc_used <= sc_size - sc->size) {
+        new = (surfcache_t *)(sc_base + sc_used);
+        new->size = sc->size;
+        new->sizeclass = class;
+        sc_used += sc->size;
+        return new;
+    }
+
+    // pick the least recently drawn block among the classes that fit
+    new = NULL;
+    last = min(class + SC_CLASS_SPAN, sc_numclasses);
+    for (i = class; i < last; i++) {
+        sc = &sc_classes[i];
+        if (LIST_EMPTY(&sc->lru))
+            continue;
+        c = LIST_FIRST(surfcache_t, &sc->lru, entry);
+        if (!new || c->lastframe < new->lastframe)
+            new = c;
     }
 
-    sc_rover = sc_base;
-    sc_base->next = NULL;
-    sc_base->owner = NULL;
-    sc_base->size = sc_size;
+    if (!new)
+        return NULL;
+
+    if (new->owner)
+        *new->owner = NULL;
+    if (new->lastframe == r_framecount)
+        sc_stats.thrashed++;
+    sc_stats.evictions++;
+
+    List_Remove(&new->entry);
+    sc_classes[new->sizeclass].numlive--;
+    return new;
 }
 
 /*
@@ -245,7 +408,8 @@ D_SCAlloc
 */
 static surfcache_t *D_SCAlloc(int width, int size)
 {
-    surfcache_t             *new;
+    surfcache_t     *new;
+    int             class;
 
     if ((width < 0) || (width > 256))
         Com_Error(ERR_FATAL, "D_SCAlloc: bad cache width %d\n", width);
@@ -253,50 +417,28 @@ static surfcache_t *D_SCAlloc(int width, int size)
     if ((size <= 0) || (size > 0x10000 * TEX_BYTES))
         Com_Error(ERR_FATAL, "D_SCAlloc: bad cache size %d\n", size);
 
-    size += sizeof(surfcache_t) - 4;
-    size = (size + 3) & ~3;
-    if (size > sc_size)
-        Com_Error(ERR_FATAL, "D_SCAlloc: %i > cache size of %i", size, sc_size);
-
-// if there is not size bytes after the rover, reset to the start
-    if (!sc_rover || (byte *)sc_rover - (byte *)sc_base > sc_size - size) {
-        sc_rover = sc_base;
-    }
-
-// colect and free surfcache_t blocks until the rover block is large enough
-    new = sc_rover;
-    if (sc_rover->owner)
-        *sc_rover->owner = NULL;
-
-    while (new->size < size) {
-        // free another
-        sc_rover = sc_rover->next;
-        if (!sc_rover)
-            Com_Error(ERR_FATAL, "D_SCAlloc: hit the end of memory");
-        if (sc_rover->owner)
-            *sc_rover->owner = NULL;
-
-        new->size += sc_rover->size;
-        new->next = sc_rover->next;
+    class = D_SCSizeClass(size + sizeof(surfcache_t) - 4);
+    if (sc_classes[class].size > sc_size)
+        Com_Error(ERR_FATAL, "D_SCAlloc: %i > cache size of %i",
+                  sc_classes[class].size, sc_size);
+
+    new = D_SCTakeBlock(class);
+    if (!new) {
+        // arena is fragmented into smaller classes, start over
+        sc_stats.flushes++;
+        D_FlushCaches();
+        new = D_SCTakeBlock(class);
     }
 
-// create a fragment out of any leftovers
-    if (new->size - size > 256) {
-        sc_rover = (surfcache_t *)((byte *)new + size);
-        sc_rover->size = new->size - size;
-        sc_rover->next = new->next;
-        sc_rover->width = 0;
-        sc_rover->owner = NULL;
-        new->next = sc_rover;
-        new->size = size;
-    } else
-        sc_rover = new->next;
+    List_Append(&sc_classes[new->sizeclass].lru, &new->entry);
+    sc_classes[new->sizeclass].numlive++;
 
     new->width = width;
 // DEBUG
     if (width > 0)
-        new->height = (size - sizeof(*new) + sizeof(new->data)) / width;
+        new->height = size / width;
 
+    new->lastframe = r_framecount;
     new->owner = NULL;              // should be set properly after return
 
     return new;
@@ -310,14 +452,28 @@ D_SCDump
 */
 void D_SCDump_f(void)
 {
-    surfcache_t             *test;
+    sizeclass_t     *sc;
+    unsigned        total;
+    int             i;
+
+    if (!sc_base)
+        return;
 
-    for (test = sc_base; test; test = test->next) {
-        if (test == sc_rover)
-            Com_Printf("ROVER:\n");
-        Com_Printf("%p : %i bytes     %i width\n", test, test->size,
-                   test->width);
+    for (i = 0, sc = sc_classes; i < sc_numclasses; i++, sc++) {
+        if (sc->numlive)
+            Com_Printf("%7i bytes: %5i blocks\n", sc->size, sc->numlive);
     }
+
+    Com_Printf("%ik of %ik used\n", sc_used / 1024, sc_size / 1024);
+
+    total = sc_stats.hits + sc_stats.rebuilds + sc_stats.misses;
+    Com_Printf("%u hits, %u rebuilds, %u misses (%.1f%% hit rate)\n",
+               sc_stats.hits, sc_stats.rebuilds, sc_stats.misses,
+               total ? sc_stats.hits * 100.0f / total : 0.0f);
+    Com_Printf("%u evictions (%u drawn this frame), %u flushes\n",
+               sc_stats.evictions, sc_stats.thrashed, sc_stats.flushes);
+
+    memset(&sc_stats, 0, sizeof(sc_stats));
 }
 
 //=============================================================================
@@ -351,8 +507,13 @@ surfcache_t *D_CacheSurface(mface_t *surface, int miplevel)
         && cache->lightadj[0] == r_drawsurf.lightadj[0]
         && cache->lightadj[1] == r_drawsurf.lightadj[1]
         && cache->lightadj[2] == r_drawsurf.lightadj[2]
-        && cache->lightadj[3] == r_drawsurf.lightadj[3])
+        && cache->lightadj[3] == r_drawsurf.lightadj[3]) {
+        List_Remove(&cache->entry);
+        List_Append(&sc_classes[cache->sizeclass].lru, &cache->entry);
+        cache->lastframe = r_framecount;
+        sc_stats.hits++;
         return cache;
+    }
 
 //
 // determine shape of surface
@@ -372,6 +533,12 @@ surfcache_t *D_CacheSurface(mface_t *surface, int miplevel)
         surface->cachespots[miplevel] = cache;
         cache->owner = &surface->cachespots[miplevel];
         cache->mipscale = surfscale;
+        sc_stats.misses++;
+    } else {
+        List_Remove(&cache->entry);
+        List_Append(&sc_classes[cache->sizeclass].lru, &cache->entry);
+        cache->lastframe = r_framecount;
+        sc_stats.rebuilds++;
     }
 
     if (surface->dlightframe == r_framecount)
@@ -54,8 +54,8 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #define MAXWORKINGVERTS (MAXVERTS + 4)  // max points in an intermediate
                                         // polygon (while processing)
 
-#define MAXHEIGHT       1200
-#define MAXWIDTH        1600
+#define MAXHEIGHT       2160
+#define MAXWIDTH        3840
 
 #define INFINITE_DISTANCE       0x10000     // distance that's always guaranteed to
                                             // be farther away than anything in
@@ -81,7 +81,7 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #define NUMSTACKSURFACES        1000
 #define MINSURFACES             NUMSTACKSURFACES
 #define MAXSURFACES             10000
-#define MAXSPANS                3000
+#define MAXSPANS                (MAXWIDTH * 2)
 
 // flags in finalvert_t.flags
 #define ALIAS_LEFT_CLIP             0x0001
@@ -205,11 +205,13 @@ typedef struct clipplane_s {
 typedef int blocklight_t;
 
 typedef struct surfcache_s {
-    struct surfcache_s      *next;
+    list_t                  entry;          // LRU chain of sizeclass
     struct surfcache_s      **owner;                // NULL is an empty chunk of memory
     int                     lightadj[MAX_LIGHTMAPS]; // checked for strobe flush
     int                     dlight;
     int                     size;           // including header
+    int                     sizeclass;
+    int                     lastframe;      // last frame this was drawn from
     unsigned                width;
     unsigned                height;         // DEBUG only needed for debug
     float                   mipscale;
@@ -395,6 +397,7 @@ extern cvar_t   *sw_waterwarp;
 extern cvar_t   *sw_drawsird;
 extern cvar_t   *sw_dynamic;
 extern cvar_t   *sw_modulate;
+extern cvar_t   *sw_simd;
 
 extern cvar_t   *r_fullbright;
 extern cvar_t   *r_drawentities;
@@ -514,7 +517,7 @@ extern blocklight_t     blocklights[MAX_BLOCKLIGHTS * LIGHTMAP_BYTES];   // allo
 
 void R_PrintAliasStats(void);
 void R_PrintTimes(void);
-void R_LightPoint(vec3_t p, vec3_t color);
+void R_LightPoint_SW(vec3_t p, vec3_t color);
 void R_SetupFrame(void);
 void R_BuildLightMap(void);
 
@@ -545,3 +548,37 @@ void R_IMFlatShadedQuad(vec3_t a, vec3_t b, vec3_t c, vec3_t d, color_t color, f
 
 void R_InitDraw(void);
 
+
+//
+// refresh entry points, see R_RegisterFunctionsSW
+//
+qboolean R_Init_SW(qboolean total);
+void R_Shutdown_SW(qboolean total);
+void R_BeginRegistration_SW(const char *model);
+void R_EndRegistration_SW(void);
+void R_SetSky_SW(const char *name, float rotate, vec3_t axis);
+void R_RenderFrame_SW(refdef_t *fd);
+void R_BeginFrame_SW(void);
+void R_EndFrame_SW(void);
+void R_ModeChanged_SW(int width, int height, int flags, int rowbytes, void *pixels);
+void R_AddDecal_SW(decal_t *d);
+
+void R_ClearColor_SW(void);
+void R_SetAlpha_SW(float alpha);
+void R_SetColor_SW(uint32_t color);
+void R_SetClipRect_SW(const clipRect_t *clip);
+void R_SetScale_SW(float scale);
+void R_DrawStretchPic_SW(int x, int y, int w, int h, qhandle_t pic);
+void R_DrawPic_SW(int x, int y, qhandle_t pic);
+void R_TileClear_SW(int x, int y, int w, int h, qhandle_t pic);
+void R_DrawFill8_SW(int x, int y, int w, int h, int c);
+void R_DrawFill32_SW(int x, int y, int w, int h, uint32_t c);
+void R_DrawChar_SW(int x, int y, int flags, int ch, qhandle_t font);
+int R_DrawString_SW(int x, int y, int flags, size_t maxChars, const char *string, qhandle_t font);
+
+void IMG_Load_SW(image_t *image, byte *pic);
+void IMG_Unload_SW(image_t *image);
+byte *IMG_ReadPixels_SW(int *width, int *height, int *rowbytes);
+
+qerror_t MOD_LoadMD2_SW(model_t *model, const void *rawdata, size_t length);
+void MOD_Reference_SW(model_t *model);
@@ -1077,27 +1077,35 @@ is_model_transparent(bsp_mesh_t *wm, bsp_model_t *model)
 }
 
 
-uint32_t floatBitsToUint(float f) { return *((uint32_t*)&f); }
+static inline uint32_t floatBitsToUint(float f) { uint32_t u; memcpy(&u, &f, sizeof(u)); return u; }
+static inline float uintBitsToFloat(uint32_t u) { float f; memcpy(&f, &u, sizeof(f)); return f; }
 
+// same encoding as encode_normal() in shader/utils.glsl
 uint32_t
-encode_normal(vec3_t normal)
+encode_normal(const vec3_t normal)
 {
 	uint32_t projected0, projected1;
-	float invL1Norm = 1.0f / (fabs(normal[0]) + fabs(normal[1]) + fabs(normal[2]));
+	float l1norm = fabsf(normal[0]) + fabsf(normal[1]) + fabsf(normal[2]);
+
+	// degenerate vectors decode as +Z
+	if (!(l1norm > 0.0f))
+		return 0;
+
+	float invL1Norm = 1.0f / l1norm;
 
 	// first find floating point values of octahedral map in [-1,1]:
 	float enc0, enc1;
 	if (normal[2] < 0.0f) {
-		enc0 = (1.0f - abs(normal[1] * invL1Norm)) * ((normal[0] < 0.0f) ? -1.0f : 1.0f);
-		enc1 = (1.0f - abs(normal[0] * invL1Norm)) * ((normal[1] < 0.0f) ? -1.0f : 1.0f);
+		enc0 = (1.0f - fabsf(normal[1] * invL1Norm)) * ((normal[0] < 0.0f) ? -1.0f : 1.0f);
+		enc1 = (1.0f - fabsf(normal[0] * invL1Norm)) * ((normal[1] < 0.0f) ? -1.0f : 1.0f);
 	}
 	else {
 		enc0 = normal[0] * invL1Norm;
 		enc1 = normal[1] * invL1Norm;
 	}
 	// then encode:
-	uint32_t enci0 = floatBitsToUint((abs(enc0) + 2.0f) / 2.0f);
-	uint32_t enci1 = floatBitsToUint((abs(enc1) + 2.0f) / 2.0f);
+	uint32_t enci0 = floatBitsToUint((fabsf(enc0) + 2.0f) / 2.0f);
+	uint32_t enci1 = floatBitsToUint((fabsf(enc1) + 2.0f) / 2.0f);
 	// copy over sign bit and truncated mantissa. could use rounding for increased precision here.
 	projected0 = ((floatBitsToUint(enc0) & 0x80000000u) >> 16) | ((enci0 & 0x7fffffu) >> 8);
 	projected1 = ((floatBitsToUint(enc1) & 0x80000000u) >> 16) | ((enci1 & 0x7fffffu) >> 8);
@@ -1107,6 +1115,28 @@ encode_normal(vec3_t normal)
 	return (projected1 << 16) | projected0;
 }
 
+// same decoding as decode_normal() in shader/utils.glsl
+void
+decode_normal(uint32_t enc, vec3_t normal)
+{
+	uint32_t projected0 = enc & 0xffffu;
+	uint32_t projected1 = enc >> 16;
+	// copy sign bit and paste rest to upper mantissa to get float encoded in [1,2).
+	uint32_t vec0 = 0x3f800000u | ((projected0 & 0x7fffu) << 8);
+	uint32_t vec1 = 0x3f800000u | ((projected1 & 0x7fffu) << 8);
+
+	normal[0] = uintBitsToFloat(floatBitsToUint(2.0f * uintBitsToFloat(vec0) - 2.0f) | ((projected0 & 0x8000u) << 16));
+	normal[1] = uintBitsToFloat(floatBitsToUint(2.0f * uintBitsToFloat(vec1) - 2.0f) | ((projected1 & 0x8000u) << 16));
+	normal[2] = 1.0f - (fabsf(normal[0]) + fabsf(normal[1]));
+
+	if (normal[2] < 0.0f) {
+		float oldX = normal[0];
+		normal[0] = (1.0f - fabsf(normal[1])) * ((oldX < 0.0f) ? -1.0f : 1.0f);
+		normal[1] = (1.0f - fabsf(oldX)) * ((normal[1] < 0.0f) ? -1.0f : 1.0f);
+	}
+	VectorNormalize(normal);
+}
+
 void
 compute_aabb(const float* positions, int numvert, float* aabb_min, float* aabb_max)
 {
@@ -1841,32 +1871,61 @@ bsp_mesh_destroy(bsp_mesh_t *wm)
 void
 bsp_mesh_register_textures(bsp_t *bsp)
 {
-	for (int i = 0; i < bsp->numtexinfo; i++) {
+	int count = bsp->numtexinfo;
+	char (*names)[MAX_QPATH] = Z_Malloc(count * 3 * sizeof(names[0]));
+	imagereq_t *reqs = Z_Malloc(count * 2 * sizeof(reqs[0]));
+	image_t **diffuse = Z_Malloc(count * 3 * sizeof(diffuse[0]));
+	image_t **extra = diffuse + count;
+	int num_extra = 0;
+
+	// load the diffuse textures in one batch, then the normal and emissive
+	// maps of those that exist in another
+	for (int i = 0; i < count; i++) {
 		mtexinfo_t *info = bsp->texinfo + i;
-		imageflags_t flags;
-		if (info->c.flags & SURF_WARP)
-			flags = IF_TURBULENT;
-		else
-			flags = IF_NONE;
+		imageflags_t flags = (info->c.flags & SURF_WARP) ? IF_TURBULENT : IF_NONE;
 
-		char buffer[MAX_QPATH];
-		Q_concat(buffer, sizeof(buffer), "textures/", info->name, ".wal", NULL);
-		FS_NormalizePath(buffer, buffer);
+		Q_concat(names[i], sizeof(names[i]), "textures/", info->name, ".wal", NULL);
+		FS_NormalizePath(names[i], names[i]);
+		reqs[i] = (imagereq_t){ names[i], IT_WALL, flags | IF_SRGB };
+	}
+
+	IMG_FindBatch(reqs, diffuse, count);
+
+	for (int i = 0; i < count; i++) {
+		mtexinfo_t *info = bsp->texinfo + i;
+		imageflags_t flags = (info->c.flags & SURF_WARP) ? IF_TURBULENT : IF_NONE;
+		char *name_n = names[count + num_extra];
+		char *name_light = names[count + num_extra + 1];
+
+		if (diffuse[i] == R_NOTEXTURE)
+			continue;
+
+		Q_concat(name_n, MAX_QPATH, "textures/", info->name, "_n.tga", NULL);
+		FS_NormalizePath(name_n, name_n);
+		reqs[num_extra++] = (imagereq_t){ name_n, IT_WALL, flags };
 
-		pbr_material_t * mat = MAT_FindPBRMaterial(buffer);
+		Q_concat(name_light, MAX_QPATH, "textures/", info->name, "_light.tga", NULL);
+		FS_NormalizePath(name_light, name_light);
+		reqs[num_extra++] = (imagereq_t){ name_light, IT_WALL, flags | IF_SRGB };
+	}
+
+	IMG_FindBatch(reqs, extra, num_extra);
+
+	num_extra = 0;
+	for (int i = 0; i < count; i++) {
+		mtexinfo_t *info = bsp->texinfo + i;
+
+		pbr_material_t * mat = MAT_FindPBRMaterial(names[i]);
 		if (!mat)
-			Com_EPrintf("error finding material '%s'\n", buffer);
+			Com_EPrintf("error finding material '%s'\n", names[i]);
 
-		image_t* image_diffuse = IMG_Find(buffer, IT_WALL, flags | IF_SRGB);
+		image_t* image_diffuse = diffuse[i];
 		image_t* image_normals = NULL;
 		image_t* image_emissive = NULL;
 
 		if (image_diffuse != R_NOTEXTURE)
 		{
-			// attempt loading the second texture
-			Q_concat(buffer, sizeof(buffer), "textures/", info->name, "_n.tga", NULL);
-			FS_NormalizePath(buffer, buffer);
-			image_normals = IMG_Find(buffer, IT_WALL, flags);
+			image_normals = extra[num_extra++];
 			if (image_normals == R_NOTEXTURE) image_normals = NULL;
 
             if (image_normals && !image_normals->processing_complete)
@@ -1874,10 +1933,7 @@ bsp_mesh_register_textures(bsp_t *bsp)
                 vkpt_normalize_normal_map(image_normals);
             }
 
-			// attempt loading the emissive texture
-			Q_concat(buffer, sizeof(buffer), "textures/", info->name, "_light.tga", NULL);
-			FS_NormalizePath(buffer, buffer);
-			image_emissive = IMG_Find(buffer, IT_WALL, flags | IF_SRGB);
+			image_emissive = extra[num_extra++];
 			if (image_emissive == R_NOTEXTURE) image_emissive = NULL;
 
 			if (image_emissive && !image_emissive->processing_complete && (mat->emissive_scale > 0.f) && ((mat->flags & MATERIAL_FLAG_LIGHT) != 0 || MAT_IsKind(mat->flags, MATERIAL_KIND_LAVA)))
@@ -1892,6 +1948,10 @@ bsp_mesh_register_textures(bsp_t *bsp)
 		info->material = mat;
 	}
 
+	Z_Free(names);
+	Z_Free(reqs);
+	Z_Free(diffuse);
+
 	// link the animation sequences
 	for (int i = 0; i < bsp->numtexinfo; i++) 
 	{
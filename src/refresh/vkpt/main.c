@@ -50,6 +50,7 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 cvar_t *cvar_profiler = NULL;
 cvar_t *cvar_vsync = NULL;
 cvar_t *cvar_pt_caustics = NULL;
+cvar_t *cvar_model_cache = NULL;
 cvar_t *cvar_pt_enable_nodraw = NULL;
 cvar_t *cvar_pt_accumulation_rendering = NULL;
 cvar_t *cvar_pt_accumulation_rendering_framenum = NULL;
@@ -906,6 +907,14 @@ init_vulkan()
 
 	qvk.physical_device = devices[picked_device];
 
+	{
+		VkPhysicalDeviceFeatures dev_features;
+		vkGetPhysicalDeviceFeatures(qvk.physical_device, &dev_features);
+		qvk.supports_bc = dev_features.textureCompressionBC ? qtrue : qfalse;
+		if (!qvk.supports_bc)
+			Com_Printf("BC texture compression not supported, cooked textures are uploaded uncompressed\n");
+	}
+
 	{
 		VkPhysicalDeviceProperties dev_properties;
 		vkGetPhysicalDeviceProperties(devices[picked_device], &dev_properties);
@@ -1050,7 +1059,7 @@ init_vulkan()
 			.samplerAnisotropy = 1,
 			.textureCompressionETC2 = 0,
 			.textureCompressionASTC_LDR = 0,
-			.textureCompressionBC = 0,
+			.textureCompressionBC = qvk.supports_bc,
 			.occlusionQueryPrecise = 0,
 			.pipelineStatisticsQuery = 1,
 			.vertexPipelineStoresAndAtomics = 1,
@@ -2904,6 +2913,12 @@ R_Init_RTX(qboolean total)
 	// freecam mode toggle
 	cvar_pt_freecam = Cvar_Get("pt_freecam", "1", CVAR_ARCHIVE);
 
+	// derived model data (tangents) cache:
+	// 0 -> disabled
+	// 1 -> load from modelcache/ when up to date
+	// 2 -> also write missing or stale entries
+	cvar_model_cache = Cvar_Get("r_model_cache", "0", 0);
+
 #ifdef VKPT_DEVICE_GROUPS
 	cvar_sli = Cvar_Get("sli", "1", CVAR_REFRESH | CVAR_ARCHIVE);
 #endif
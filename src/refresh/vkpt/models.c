@@ -43,6 +43,7 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include "format/md3.h"
 #include "format/sp2.h"
 #include "material.h"
+#include "common/mdfour.h"
 #include <assert.h>
 
 #if MAX_ALIAS_VERTS > TESS_MAX_VERTICES
@@ -53,95 +54,402 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #error TESS_MAX_INDICES
 #endif
 
+#define TANCACHE_MAGIC      MakeRawLong('Q', '2', 'T', 'N')
+#define TANCACHE_VERSION    1
+
+// cooked tangents header, followed by the tangents of all meshes in order
+typedef struct {
+    uint32_t    ident;
+    uint32_t    version;
+    uint32_t    checksum;   // of the source model file
+    uint32_t    length;
+    uint32_t    numframes;
+    uint32_t    numverts;   // summed over all meshes
+} dtancache_t;
+
+#define MAX_TANGENT_THREADS     16
+
+// smaller models (in triangles times frames) are done on the calling thread
+#define MIN_THREADED_TANGENTS   (32 * 1024)
+
+extern cvar_t *cvar_model_cache;
+
+typedef struct {
+    model_t         *model;
+    int             maxverts;
+    SDL_atomic_t    next;
+} tangentjob_t;
+
+static void computeFrameTangents(maliasmesh_t * mesh, int idx_frame, float * stangents)
+{
+    float * ttangents = stangents + (mesh->numverts * 3);
+
+    memset(stangents, 0, mesh->numverts * 2 * 3 * sizeof(float));
+
+    uint32_t ntriangles = mesh->numindices / 3,
+             offset = idx_frame * mesh->numverts;
+    
+    for (int idx_tri = 0; idx_tri < mesh->numtris; ++idx_tri)
+    {
+        uint32_t iA = mesh->indices[idx_tri * 3 + 0];
+        uint32_t iB = mesh->indices[idx_tri * 3 + 1];
+        uint32_t iC = mesh->indices[idx_tri * 3 + 2];
+
+        float const * pA = (float const *)mesh->positions + ((offset + iA) * 3);
+        float const * pB = (float const *)mesh->positions + ((offset + iB) * 3);
+        float const * pC = (float const *)mesh->positions + ((offset + iC) * 3);
+
+        float const * tA = (float const *)mesh->tex_coords + ((offset + iA) * 2);
+        float const * tB = (float const *)mesh->tex_coords + ((offset + iB) * 2);
+        float const * tC = (float const *)mesh->tex_coords + ((offset + iC) * 2);
+
+        vec3_t dP0, dP1;
+        VectorSubtract(pB, pA, dP0);
+        VectorSubtract(pC, pA, dP1);
+
+        vec2_t dt0, dt1;
+        Vector2Subtract(tB, tA, dt0);
+        Vector2Subtract(tC, tA, dt1);
+
+        float r = 1.f / (dt0[0] * dt1[1] - dt1[0] * dt0[1]);
+
+        vec3_t sdir = {
+            (dt1[1] * dP0[0] - dt0[1] * dP1[0]) * r,
+            (dt1[1] * dP0[1] - dt0[1] * dP1[1]) * r,
+            (dt1[1] * dP0[2] - dt0[1] * dP1[2]) * r };
+
+        vec3_t tdir = {
+            (dt0[0] * dP1[0] - dt1[0] * dP0[0]) * r,
+            (dt0[0] * dP1[1] - dt1[0] * dP0[1]) * r,
+            (dt0[0] * dP1[2] - dt1[0] * dP0[2]) * r };
+
+        VectorAdd(stangents + (iA * 3), sdir, stangents + (iA * 3));
+        VectorAdd(stangents + (iB * 3), sdir, stangents + (iB * 3));
+        VectorAdd(stangents + (iC * 3), sdir, stangents + (iC * 3));
+
+        VectorAdd(ttangents + (iA * 3), tdir, ttangents + (iA * 3));
+        VectorAdd(ttangents + (iB * 3), tdir, ttangents + (iB * 3));
+        VectorAdd(ttangents + (iC * 3), tdir, ttangents + (iC * 3));
+    }
+
+    for (int idx_vert = 0; idx_vert < mesh->numverts; ++idx_vert)
+    {
+        float const * normal = (float const *)mesh->normals + ((offset + idx_vert) * 3);
+        float const * stan = stangents + (idx_vert * 3);
+        float const * ttan = ttangents + (idx_vert * 3);
+
+        float * tangent = (float *)mesh->tangents + ((offset+idx_vert) * 4);
+
+        vec3_t t;
+        VectorScale(normal, DotProduct(normal, stan), t);
+        VectorSubtract(stan, t, t);
+        VectorNormalize2(t, tangent); // Graham-Schmidt : t = normalize(t - n * (n.t))
+
+        vec3_t cross;
+        CrossProduct(normal, t, cross);
+        float dot = DotProduct(cross, ttan);
+        tangent[3] = dot < 0.0f ? -1.0f : 1.0f; // handedness
+    }
+}
+
+static int SDLCALL tangentThread(void *arg)
+{
+    tangentjob_t * job = arg;
+    model_t * model = job->model;
+    float * stangents = Z_Malloc(job->maxverts * 2 * 3 * sizeof(float));
+    int i;
+
+    // one work item per frame of each mesh
+    while ((i = SDL_AtomicAdd(&job->next, 1)) < model->nummeshes * model->numframes)
+    {
+        computeFrameTangents(&model->meshes[i / model->numframes], i % model->numframes, stangents);
+    }
+
+    Z_Free(stangents);
+    return 0;
+}
+
 static void computeTangents(model_t * model)
 {
+    SDL_Thread * threads[MAX_TANGENT_THREADS];
+    tangentjob_t job;
+    int numtris = 0, numthreads = 1;
+
+    job.model = model;
+    job.maxverts = 0;
+    SDL_AtomicSet(&job.next, 0);
+
     for (int idx_mesh = 0; idx_mesh < model->nummeshes; ++idx_mesh)
     {
         maliasmesh_t * mesh = &model->meshes[idx_mesh];
 
         assert(mesh->tangents);
-        float * stangents = Z_Malloc(mesh->numverts * 2 * 3 * sizeof(float));
-        float * ttangents = stangents + (mesh->numverts * 3);
- 
-        for (int idx_frame = 0; idx_frame < model->numframes; ++idx_frame)
-        {
-            memset(stangents, 0, mesh->numverts * 2 * 3 * sizeof(float));
+        job.maxverts = max(job.maxverts, mesh->numverts);
+        numtris += mesh->numtris;
+    }
 
-            uint32_t ntriangles = mesh->numindices / 3,
-                     offset = idx_frame * mesh->numverts;
-            
-            for (int idx_tri = 0; idx_tri < mesh->numtris; ++idx_tri)
-            {
-                uint32_t iA = mesh->indices[idx_tri * 3 + 0];
-                uint32_t iB = mesh->indices[idx_tri * 3 + 1];
-                uint32_t iC = mesh->indices[idx_tri * 3 + 2];
+    if (numtris * model->numframes >= MIN_THREADED_TANGENTS)
+    {
+        numthreads = SDL_GetCPUCount();
+        clamp(numthreads, 1, MAX_TANGENT_THREADS);
+        numthreads = min(numthreads, model->nummeshes * model->numframes);
+    }
 
-                float const * pA = (float const *)mesh->positions + ((offset + iA) * 3);
-                float const * pB = (float const *)mesh->positions + ((offset + iB) * 3);
-                float const * pC = (float const *)mesh->positions + ((offset + iC) * 3);
+    // this thread takes part as well
+    for (int i = 1; i < numthreads; i++)
+        threads[i] = SDL_CreateThread(tangentThread, "tangents", &job);
 
-                float const * tA = (float const *)mesh->tex_coords + ((offset + iA) * 2);
-                float const * tB = (float const *)mesh->tex_coords + ((offset + iB) * 2);
-                float const * tC = (float const *)mesh->tex_coords + ((offset + iC) * 2);
+    tangentThread(&job);
 
-                vec3_t dP0, dP1;
-                VectorSubtract(pB, pA, dP0);
-                VectorSubtract(pC, pA, dP1);
+    for (int i = 1; i < numthreads; i++)
+    {
+        if (threads[i])
+            SDL_WaitThread(threads[i], NULL);
+    }
+}
 
-                vec2_t dt0, dt1;
-                Vector2Subtract(tB, tA, dt0);
-                Vector2Subtract(tC, tA, dt1);
+static size_t tangentCachePath(char * buffer, size_t size, const model_t * model)
+{
+    return Q_concat(buffer, size, "modelcache/", model->name, ".tan", NULL);
+}
 
-                float r = 1.f / (dt0[0] * dt1[1] - dt1[0] * dt0[1]);
+static size_t tangentCacheVerts(const model_t * model)
+{
+    size_t numverts = 0;
 
-                vec3_t sdir = {
-                    (dt1[1] * dP0[0] - dt0[1] * dP1[0]) * r,
-                    (dt1[1] * dP0[1] - dt0[1] * dP1[1]) * r,
-                    (dt1[1] * dP0[2] - dt0[1] * dP1[2]) * r };
+    for (int idx_mesh = 0; idx_mesh < model->nummeshes; ++idx_mesh)
+        numverts += model->meshes[idx_mesh].numverts;
 
-                vec3_t tdir = {
-                    (dt0[0] * dP1[0] - dt1[0] * dP0[0]) * r,
-                    (dt0[0] * dP1[1] - dt1[0] * dP0[1]) * r,
-                    (dt0[0] * dP1[2] - dt1[0] * dP0[2]) * r };
+    return numverts;
+}
+
+static qboolean loadCachedTangents(model_t * model, uint32_t checksum, size_t length)
+{
+    char path[MAX_OSPATH];
+    dtancache_t * header;
+    byte * data, * src;
+    ssize_t len;
+    size_t numverts = tangentCacheVerts(model);
+
+    if (tangentCachePath(path, sizeof(path), model) >= sizeof(path))
+        return qfalse;
+
+    len = FS_LoadFile(path, (void **)&data);
+    if (!data)
+        return qfalse;
+
+    header = (dtancache_t *)data;
+    if (len != sizeof(*header) + numverts * model->numframes * sizeof(vec4_t) ||
+        LittleLong(header->ident) != TANCACHE_MAGIC ||
+        LittleLong(header->version) != TANCACHE_VERSION ||
+        LittleLong(header->checksum) != checksum ||
+        LittleLong(header->length) != length ||
+        LittleLong(header->numframes) != model->numframes ||
+        LittleLong(header->numverts) != numverts)
+    {
+        FS_FreeFile(data);
+        return qfalse;
+    }
+
+    src = data + sizeof(*header);
+    for (int idx_mesh = 0; idx_mesh < model->nummeshes; ++idx_mesh)
+    {
+        maliasmesh_t * mesh = &model->meshes[idx_mesh];
+        size_t size = mesh->numverts * model->numframes * sizeof(vec4_t);
+
+        memcpy(mesh->tangents, src, size);
+        src += size;
+    }
 
-                VectorAdd(stangents + (iA * 3), sdir, stangents + (iA * 3));
-                VectorAdd(stangents + (iB * 3), sdir, stangents + (iB * 3));
-                VectorAdd(stangents + (iC * 3), sdir, stangents + (iC * 3));
+    FS_FreeFile(data);
+    return qtrue;
+}
 
-                VectorAdd(ttangents + (iA * 3), tdir, ttangents + (iA * 3));
-                VectorAdd(ttangents + (iB * 3), tdir, ttangents + (iB * 3));
-                VectorAdd(ttangents + (iC * 3), tdir, ttangents + (iC * 3));
+static void saveCachedTangents(model_t * model, uint32_t checksum, size_t length)
+{
+    char path[MAX_OSPATH];
+    dtancache_t * header;
+    byte * data, * dst;
+    size_t numverts = tangentCacheVerts(model);
+    size_t size = sizeof(*header) + numverts * model->numframes * sizeof(vec4_t);
+
+    if (tangentCachePath(path, sizeof(path), model) >= sizeof(path))
+        return;
+
+    data = Z_Malloc(size);
+
+    header = (dtancache_t *)data;
+    header->ident = LittleLong(TANCACHE_MAGIC);
+    header->version = LittleLong(TANCACHE_VERSION);
+    header->checksum = LittleLong(checksum);
+    header->length = LittleLong(length);
+    header->numframes = LittleLong(model->numframes);
+    header->numverts = LittleLong(numverts);
+
+    dst = data + sizeof(*header);
+    for (int idx_mesh = 0; idx_mesh < model->nummeshes; ++idx_mesh)
+    {
+        maliasmesh_t * mesh = &model->meshes[idx_mesh];
+        size_t meshsize = mesh->numverts * model->numframes * sizeof(vec4_t);
+
+        memcpy(dst, mesh->tangents, meshsize);
+        dst += meshsize;
+    }
+
+    if (FS_WriteFile(path, data, size) < 0)
+        Com_WPrintf("Couldn't write %s\n", path);
+
+    Z_Free(data);
+}
+
+// fills in the tangents of all frames, from the model cache when possible
+static void loadTangents(model_t * model, const void * rawdata, size_t length)
+{
+    uint32_t checksum = 0;
+
+    if (cvar_model_cache->integer)
+    {
+        checksum = Com_BlockChecksum((void *)rawdata, length);
+        if (loadCachedTangents(model, checksum, length))
+            return;
+    }
+
+    computeTangents(model);
+
+    if (cvar_model_cache->integer > 1)
+        saveCachedTangents(model, checksum, length);
+}
+
+// frees the full precision frames of all meshes
+static void freeAliasFrames(model_t * model)
+{
+    for (int idx_mesh = 0; idx_mesh < model->nummeshes; ++idx_mesh)
+    {
+        maliasmesh_t * mesh = &model->meshes[idx_mesh];
+
+        Z_Free(mesh->positions);
+        Z_Free(mesh->normals);
+        Z_Free(mesh->tex_coords);
+        Z_Free(mesh->tangents);
+        mesh->positions = NULL;
+        mesh->normals = NULL;
+        mesh->tex_coords = NULL;
+        mesh->tangents = NULL;
+    }
+}
+
+// converts the full precision frames into the resident format: positions
+// quantized to 16 bits within the bounds of each frame, octahedral normals
+// and tangents, and a single set of texture coordinates
+static void packAliasModel(model_t * model)
+{
+    for (int idx_mesh = 0; idx_mesh < model->nummeshes; ++idx_mesh)
+    {
+        maliasmesh_t * mesh = &model->meshes[idx_mesh];
+
+        mesh->verts = MOD_Malloc(mesh->numverts * model->numframes * sizeof(maliasvert_t));
+        mesh->quant = MOD_Malloc(model->numframes * sizeof(maliasquant_t));
+        mesh->st = MOD_Malloc(mesh->numverts * sizeof(vec2_t));
+
+        memcpy(mesh->st, mesh->tex_coords, mesh->numverts * sizeof(vec2_t));
+
+        for (int idx_frame = 0; idx_frame < model->numframes; ++idx_frame)
+        {
+            maliasquant_t * quant = &mesh->quant[idx_frame];
+            int offset = idx_frame * mesh->numverts;
+            vec3_t mins, maxs, inv;
+
+            ClearBounds(mins, maxs);
+            for (int idx_vert = 0; idx_vert < mesh->numverts; ++idx_vert)
+                AddPointToBounds(mesh->positions[offset + idx_vert], mins, maxs);
+
+            VectorCopy(mins, quant->offset);
+            for (int k = 0; k < 3; k++)
+            {
+                quant->scale[k] = (maxs[k] - mins[k]) / 65535.0f;
+                inv[k] = quant->scale[k] > 0.0f ? 1.0f / quant->scale[k] : 0.0f;
             }
 
             for (int idx_vert = 0; idx_vert < mesh->numverts; ++idx_vert)
             {
-                float const * normal = (float const *)mesh->normals + ((offset + idx_vert) * 3);
-                float const * stan = stangents + (idx_vert * 3);
-                float const * ttan = ttangents + (idx_vert * 3);
+                maliasvert_t * vert = &mesh->verts[offset + idx_vert];
+                const float * position = mesh->positions[offset + idx_vert];
+                const float * tangent = mesh->tangents[offset + idx_vert];
+
+                for (int k = 0; k < 3; k++)
+                {
+                    int q = (int)((position[k] - mins[k]) * inv[k] + 0.5f);
+                    clamp(q, 0, 65535);
+                    vert->pos[k] = q;
+                }
+
+                vert->flags = tangent[3] < 0.0f ? MAV_MIRRORED : 0;
+                vert->normal = encode_normal(mesh->normals[offset + idx_vert]);
+                vert->tangent = encode_normal(tangent);
+            }
+        }
+    }
+
+    freeAliasFrames(model);
+}
 
-                float * tangent = (float *)mesh->tangents + ((offset+idx_vert) * 4);
+// expands the resident format back to the float layout of the vertex buffer
+void MOD_UnpackAliasMesh_RTX(const model_t * model, const maliasmesh_t * mesh,
+    float * positions, float * normals, float * tex_coords, float * tangents)
+{
+    const maliasvert_t * vert = mesh->verts;
 
-                vec3_t t;
-                VectorScale(normal, DotProduct(normal, stan), t);
-                VectorSubtract(stan, t, t);
-                VectorNormalize2(t, tangent); // Graham-Schmidt : t = normalize(t - n * (n.t))
+    for (int idx_frame = 0; idx_frame < model->numframes; ++idx_frame)
+    {
+        const maliasquant_t * quant = &mesh->quant[idx_frame];
 
-                vec3_t cross;
-                CrossProduct(normal, t, cross);
-                float dot = DotProduct(cross, ttan);
-                tangent[3] = dot < 0.0f ? -1.0f : 1.0f; // handedness
-            }
+        for (int idx_vert = 0; idx_vert < mesh->numverts; ++idx_vert, ++vert)
+        {
+            positions[0] = quant->offset[0] + vert->pos[0] * quant->scale[0];
+            positions[1] = quant->offset[1] + vert->pos[1] * quant->scale[1];
+            positions[2] = quant->offset[2] + vert->pos[2] * quant->scale[2];
+
+            decode_normal(vert->normal, normals);
+            decode_normal(vert->tangent, tangents);
+            tangents[3] = (vert->flags & MAV_MIRRORED) ? -1.0f : 1.0f;
+
+            tex_coords[0] = mesh->st[idx_vert][0];
+            tex_coords[1] = mesh->st[idx_vert][1];
+
+            positions += 3;
+            normals += 3;
+            tex_coords += 2;
+            tangents += 4;
         }
-        Z_Free(stangents);
     }
 }
 
+// debug helper, reads back the packed vertices so it has to run after packAliasModel
 static void export_obj_frames(model_t* model, const char* path_pattern)
 {
+	float** positions = Z_Malloc(model->nummeshes * sizeof(float*));
+	float** normals = Z_Malloc(model->nummeshes * sizeof(float*));
+	float** tex_coords = Z_Malloc(model->nummeshes * sizeof(float*));
+	float** tangents = Z_Malloc(model->nummeshes * sizeof(float*));
+
+	for (int idx_mesh = 0; idx_mesh < model->nummeshes; ++idx_mesh)
+	{
+		maliasmesh_t * mesh = &model->meshes[idx_mesh];
+		size_t count = (size_t)model->numframes * mesh->numverts;
+
+		positions[idx_mesh] = Z_Malloc(count * 3 * sizeof(float));
+		normals[idx_mesh] = Z_Malloc(count * 3 * sizeof(float));
+		tex_coords[idx_mesh] = Z_Malloc(count * 2 * sizeof(float));
+		tangents[idx_mesh] = Z_Malloc(count * 4 * sizeof(float));
+
+		MOD_UnpackAliasMesh_RTX(model, mesh, positions[idx_mesh], normals[idx_mesh],
+			tex_coords[idx_mesh], tangents[idx_mesh]);
+	}
+
 	for (int idx_frame = 0; idx_frame < model->numframes; ++idx_frame)
 	{
 		char path[MAX_OSPATH];
-		sprintf(path, path_pattern, idx_frame);
+		Q_snprintf(path, sizeof(path), path_pattern, idx_frame);
 		FILE* file = fopen(path, "w");
 
 		if (!file)
@@ -152,14 +460,13 @@ static void export_obj_frames(model_t* model, const char* path_pattern)
 		for (int idx_mesh = 0; idx_mesh < model->nummeshes; ++idx_mesh)
 		{
 			maliasmesh_t * mesh = &model->meshes[idx_mesh];
-			uint32_t ntriangles = mesh->numindices / 3,
-				offset = idx_frame * mesh->numverts;
+			uint32_t offset = idx_frame * mesh->numverts;
 
 			for (int idx_vert = 0; idx_vert < mesh->numverts; ++idx_vert)
 			{
-				float const * p = (float const*)mesh->positions + (offset + idx_vert) * 3;
-				float const * n = (float const*)mesh->normals + (offset + idx_vert) * 3;
-				float const * t = (float const*)mesh->tex_coords + (offset + idx_vert) * 2;
+				float const * p = positions[idx_mesh] + (offset + idx_vert) * 3;
+				float const * n = normals[idx_mesh] + (offset + idx_vert) * 3;
+				float const * t = tex_coords[idx_mesh] + (offset + idx_vert) * 2;
 				fprintf(file, "v %.3f %.3f %.3f\n", p[0], p[1], p[2]);
 				fprintf(file, "vn %.3f %.3f %.3f\n", n[0], n[1], n[2]);
 				fprintf(file, "vt %.3f %.3f\n", t[0], t[1]);
@@ -181,6 +488,19 @@ static void export_obj_frames(model_t* model, const char* path_pattern)
 
 		fclose(file);
 	}
+
+	for (int idx_mesh = 0; idx_mesh < model->nummeshes; ++idx_mesh)
+	{
+		Z_Free(positions[idx_mesh]);
+		Z_Free(normals[idx_mesh]);
+		Z_Free(tex_coords[idx_mesh]);
+		Z_Free(tangents[idx_mesh]);
+	}
+
+	Z_Free(positions);
+	Z_Free(normals);
+	Z_Free(tex_coords);
+	Z_Free(tangents);
 }
 
 qerror_t MOD_LoadMD2_RTX(model_t *model, const void *rawdata, size_t length)
@@ -307,6 +627,7 @@ qerror_t MOD_LoadMD2_RTX(model_t *model, const void *rawdata, size_t length)
 	model->nummeshes = 1;
 	model->numframes = header.num_frames;
 	model->meshes = MOD_Malloc(sizeof(maliasmesh_t));
+	memset(model->meshes, 0, sizeof(maliasmesh_t));
 	model->frames = MOD_Malloc(header.num_frames * sizeof(maliasframe_t));
 
 	dst_mesh = model->meshes;
@@ -314,10 +635,10 @@ qerror_t MOD_LoadMD2_RTX(model_t *model, const void *rawdata, size_t length)
 	dst_mesh->numindices = numindices;
 	dst_mesh->numverts   = numverts;
 	dst_mesh->numskins   = header.num_skins;
-	dst_mesh->positions  = MOD_Malloc(numverts   * header.num_frames * sizeof(vec3_t));
-	dst_mesh->normals    = MOD_Malloc(numverts   * header.num_frames * sizeof(vec3_t));
-	dst_mesh->tex_coords = MOD_Malloc(numverts   * header.num_frames * sizeof(vec2_t));
-    dst_mesh->tangents   = MOD_Malloc(numverts   * header.num_frames * sizeof(vec4_t));
+	dst_mesh->positions  = Z_Malloc(numverts   * header.num_frames * sizeof(vec3_t));
+	dst_mesh->normals    = Z_Malloc(numverts   * header.num_frames * sizeof(vec3_t));
+	dst_mesh->tex_coords = Z_Malloc(numverts   * header.num_frames * sizeof(vec2_t));
+    dst_mesh->tangents   = Z_Malloc(numverts   * header.num_frames * sizeof(vec4_t));
 	dst_mesh->indices    = MOD_Malloc(numindices * sizeof(int));
 
 	if (dst_mesh->numtris != header.num_tris) {
@@ -349,8 +670,10 @@ qerror_t MOD_LoadMD2_RTX(model_t *model, const void *rawdata, size_t length)
 		if (image_diffuse != R_NOTEXTURE)
 		{
 			// attempt loading the normals texture
-			if (!Q_strlcpy(skinname, src_skin, strlen(src_skin) - 3))
-				return Q_ERR_STRING_TRUNCATED;
+			if (!Q_strlcpy(skinname, src_skin, strlen(src_skin) - 3)) {
+				ret = Q_ERR_STRING_TRUNCATED;
+				goto fail;
+			}
 
 			Q_concat(skinname, sizeof(skinname), skinname, "_n.tga", NULL);
 			FS_NormalizePath(skinname, skinname);
@@ -358,8 +681,10 @@ qerror_t MOD_LoadMD2_RTX(model_t *model, const void *rawdata, size_t length)
 			if (image_normals == R_NOTEXTURE) image_normals = NULL;
 
 			// attempt loading the emissive texture
-			if (!Q_strlcpy(skinname, src_skin, strlen(src_skin) - 3))
-				return Q_ERR_STRING_TRUNCATED;
+			if (!Q_strlcpy(skinname, src_skin, strlen(src_skin) - 3)) {
+				ret = Q_ERR_STRING_TRUNCATED;
+				goto fail;
+			}
 
 			Q_concat(skinname, sizeof(skinname), skinname, "_light.tga", NULL);
 			FS_NormalizePath(skinname, skinname);
@@ -470,12 +795,14 @@ qerror_t MOD_LoadMD2_RTX(model_t *model, const void *rawdata, size_t length)
 		dst_mesh->indices[i + 2] = tmp;
 	}
 
-    computeTangents(model);
+    loadTangents(model, rawdata, length);
+    packAliasModel(model);
 
 	Hunk_End(&model->hunk);
 	return Q_ERR_SUCCESS;
 
 fail:
+	freeAliasFrames(model);
 	Hunk_Free(&model->hunk);
 	return ret;
 }
@@ -539,10 +866,10 @@ static qerror_t MOD_LoadMD3Mesh(model_t *model, maliasmesh_t *mesh,
 	mesh->numindices = header.num_tris * 3;
 	mesh->numverts = header.num_verts;
 	mesh->numskins = header.num_skins;
-	mesh->positions = MOD_Malloc(header.num_verts * model->numframes * sizeof(vec3_t));
-	mesh->normals = MOD_Malloc(header.num_verts * model->numframes * sizeof(vec3_t));
-	mesh->tex_coords = MOD_Malloc(header.num_verts * model->numframes * sizeof(vec2_t));
-    mesh->tangents = MOD_Malloc(header.num_verts * header.num_frames * sizeof(vec4_t));
+	mesh->positions = Z_Malloc(header.num_verts * model->numframes * sizeof(vec3_t));
+	mesh->normals = Z_Malloc(header.num_verts * model->numframes * sizeof(vec3_t));
+	mesh->tex_coords = Z_Malloc(header.num_verts * model->numframes * sizeof(vec2_t));
+    mesh->tangents = Z_Malloc(header.num_verts * header.num_frames * sizeof(vec4_t));
 	mesh->indices = MOD_Malloc(sizeof(int) * header.num_tris * 3);
 
 	// load all skins
@@ -687,6 +1014,7 @@ qerror_t MOD_LoadMD3_RTX(model_t *model, const void *rawdata, size_t length)
 	model->numframes = header.num_frames;
 	model->nummeshes = header.num_meshes;
 	model->meshes = MOD_Malloc(sizeof(maliasmesh_t) * header.num_meshes);
+	memset(model->meshes, 0, sizeof(maliasmesh_t) * header.num_meshes);
 	model->frames = MOD_Malloc(sizeof(maliasframe_t) * header.num_frames);
 
 	// load all frames
@@ -714,7 +1042,9 @@ qerror_t MOD_LoadMD3_RTX(model_t *model, const void *rawdata, size_t length)
 		remaining -= offset;
 	}
 
-    computeTangents(model);
+    loadTangents(model, rawdata, length);
+
+    packAliasModel(model);
 
 	//if (strstr(model->name, "v_blast"))
 	//	export_obj_frames(model, "export/v_blast_%d.obj");
@@ -723,6 +1053,7 @@ qerror_t MOD_LoadMD3_RTX(model_t *model, const void *rawdata, size_t length)
 	return Q_ERR_SUCCESS;
 
 fail:
+	freeAliasFrames(model);
 	Hunk_Free(&model->hunk);
 	return ret;
 }
@@ -20,6 +20,7 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include "vkpt.h"
 #include "vk_util.h"
 #include "refresh/images.h"
+#include "refresh/bcn.h"
 #include "device_memory_allocator.h"
 
 #include <assert.h>
@@ -496,12 +497,7 @@ IMG_Load
 
 static inline float decode_srgb(byte pix)
 {
-	float x = (float)pix / 255.f;
-	
-	if (x < 0.04045f)
-		return x / 12.92f;
-
-	return powf((x + 0.055f) / 1.055f, 2.4f);
+	return srgb_to_linear[pix];
 }
 
 static inline byte encode_srgb(float x)
@@ -641,6 +637,9 @@ IMG_Unload_RTX(image_t *image)
 	if(image->pix_data)
 		Z_Free(image->pix_data);
 	image->pix_data = NULL;
+	if(image->pix_bcn)
+		Z_Free(image->pix_bcn);
+	image->pix_bcn = NULL;
 
 	const uint32_t index = image - r_images;
 
@@ -690,12 +689,16 @@ void IMG_ReloadAll(void)
             continue; // skip if file has not been modified since last read
 
         // image has been modified : try loading in new_image
-        image_t new_image;
+        image_t new_image = { .type = image->type };
         if (load_img(filepath, &new_image) == Q_ERR_SUCCESS)
         {
             Z_Free(image->pix_data);
+            Z_Free(image->pix_bcn);
 
             image->pix_data = new_image.pix_data;
+            image->pix_bcn = new_image.pix_bcn;
+            image->pix_bcn_size = new_image.pix_bcn_size;
+            image->pix_bcn_format = new_image.pix_bcn_format;
             image->width = new_image.width;
             image->height = new_image.width;
             image->upload_width = new_image.upload_width;
@@ -1083,6 +1086,38 @@ static VkMemoryAllocateFlagsInfoKHR mem_alloc_flags_broadcast = {
 };
 #endif
 
+// cooked blocks are only uploaded when the device can sample them,
+// otherwise the decoded RGBA copy in pix_data is used
+static qboolean
+use_bcn(const image_t *q_img)
+{
+	return q_img->pix_bcn && qvk.supports_bc;
+}
+
+static VkFormat
+get_image_format(const image_t *q_img)
+{
+	if (use_bcn(q_img))
+	{
+		if (q_img->pix_bcn_format == BCN_BC1)
+			return q_img->is_srgb ? VK_FORMAT_BC1_RGB_SRGB_BLOCK : VK_FORMAT_BC1_RGB_UNORM_BLOCK;
+		return q_img->is_srgb ? VK_FORMAT_BC3_SRGB_BLOCK : VK_FORMAT_BC3_UNORM_BLOCK;
+	}
+
+	return q_img->is_srgb ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM;
+}
+
+// staging space for one texture, the device size of a compressed image
+// is not guaranteed to cover the packed blocks of all its mips
+static size_t
+get_staging_size(const image_t *q_img, const VkMemoryRequirements *mem_req)
+{
+	if (use_bcn(q_img))
+		return max(mem_req->size, q_img->pix_bcn_size);
+
+	return mem_req->size;
+}
+
 VkResult
 vkpt_textures_end_registration()
 {
@@ -1147,7 +1182,7 @@ vkpt_textures_end_registration()
 		img_info.extent.width = q_img->upload_width;
 		img_info.extent.height = q_img->upload_height;
 		img_info.mipLevels = get_num_miplevels(q_img->upload_width, q_img->upload_height);
-		img_info.format = q_img->is_srgb ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM;
+		img_info.format = get_image_format(q_img);
 
 		_VK(vkCreateImage(qvk.device, &img_info, NULL, tex_images + i));
 		ATTACH_LABEL_VARIABLE(tex_images[i], IMAGE);
@@ -1158,7 +1193,7 @@ vkpt_textures_end_registration()
 		assert(!(mem_req.alignment & (mem_req.alignment - 1)));
 		total_size += mem_req.alignment - 1;
 		total_size &= ~(mem_req.alignment - 1);
-		total_size += mem_req.size;
+		total_size += get_staging_size(q_img, &mem_req);
 
 		DeviceMemory* image_memory = tex_image_memory + i;
 		image_memory->size = mem_req.size;
@@ -1224,105 +1259,146 @@ vkpt_textures_end_registration()
 				.newLayout        = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL
 		);
 
+		if (use_bcn(q_img))
 		{
-			memcpy(staging_buffer + offset, q_img->pix_data, wd * ht * 4);
-
-			VkBufferImageCopy cpy_info = {
-				.bufferOffset = offset,
-				.imageSubresource = { 
-					.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT,
-					.mipLevel       = 0,
-					.baseArrayLayer = 0,
-					.layerCount     = 1,
-				},
-				.imageOffset    = { 0, 0, 0 },
-				.imageExtent    = { wd, ht, 1 }
-			};
-
-			vkCmdCopyBufferToImage(cmd_buf, buf_img_upload.buffer, tex_images[i],
-				VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &cpy_info);
-		}
+			// cooked textures carry all of their mips, copy them as they are
+			size_t level_offset = offset;
 
-		subresource_range.levelCount = 1;
+			memcpy(staging_buffer + offset, q_img->pix_bcn, q_img->pix_bcn_size);
 
-		for (int mip = 1; mip < num_mip_levels; mip++) 
-		{
-			subresource_range.baseMipLevel = mip - 1;
+			for (int mip = 0; mip < num_mip_levels; mip++)
+			{
+				VkBufferImageCopy cpy_info = {
+					.bufferOffset = level_offset,
+					.imageSubresource = {
+						.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT,
+						.mipLevel       = mip,
+						.baseArrayLayer = 0,
+						.layerCount     = 1,
+					},
+					.imageOffset    = { 0, 0, 0 },
+					.imageExtent    = { wd, ht, 1 }
+				};
+
+				vkCmdCopyBufferToImage(cmd_buf, buf_img_upload.buffer, tex_images[i],
+					VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &cpy_info);
+
+				level_offset += BCN_ImageSize(q_img->pix_bcn_format, wd, ht);
+				wd = (wd > 1) ? (wd >> 1) : wd;
+				ht = (ht > 1) ? (ht >> 1) : ht;
+			}
 
 			IMAGE_BARRIER(cmd_buf,
 				.image = tex_images[i],
 				.subresourceRange = subresource_range,
 				.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
-				.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT,
+				.dstAccessMask = VK_ACCESS_SHADER_READ_BIT,
 				.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-				.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+				.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
 				);
+		}
+		else
+		{
+			{
+				memcpy(staging_buffer + offset, q_img->pix_data, wd * ht * 4);
+
+				VkBufferImageCopy cpy_info = {
+					.bufferOffset = offset,
+					.imageSubresource = { 
+						.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT,
+						.mipLevel       = 0,
+						.baseArrayLayer = 0,
+						.layerCount     = 1,
+					},
+					.imageOffset    = { 0, 0, 0 },
+					.imageExtent    = { wd, ht, 1 }
+				};
+
+				vkCmdCopyBufferToImage(cmd_buf, buf_img_upload.buffer, tex_images[i],
+					VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &cpy_info);
+			}
+
+			subresource_range.levelCount = 1;
+
+			for (int mip = 1; mip < num_mip_levels; mip++) 
+			{
+				subresource_range.baseMipLevel = mip - 1;
+
+				IMAGE_BARRIER(cmd_buf,
+					.image = tex_images[i],
+					.subresourceRange = subresource_range,
+					.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+					.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT,
+					.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+					.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+					);
+
+				int nwd = (wd > 1) ? (wd >> 1) : wd;
+				int nht = (ht > 1) ? (ht >> 1) : ht;
+
+				VkImageBlit region = {
+					.srcSubresource = {
+						.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+						.mipLevel = mip - 1,
+						.baseArrayLayer = 0,
+						.layerCount = 1
+					},
+					.srcOffsets = { 
+						{ 0, 0, 0 }, 
+						{ wd, ht, 1 } },
+
+					.dstSubresource = {
+						.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+						.mipLevel = mip,
+						.baseArrayLayer = 0,
+						.layerCount = 1
+					},
+					.dstOffsets = { 
+						{ 0, 0, 0 }, 
+						{ nwd, nht, 1 } }
+				};
 
-			int nwd = (wd > 1) ? (wd >> 1) : wd;
-			int nht = (ht > 1) ? (ht >> 1) : ht;
-
-			VkImageBlit region = {
-				.srcSubresource = {
-					.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
-					.mipLevel = mip - 1,
-					.baseArrayLayer = 0,
-					.layerCount = 1
-				},
-				.srcOffsets = { 
-					{ 0, 0, 0 }, 
-					{ wd, ht, 1 } },
-
-				.dstSubresource = {
-					.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
-					.mipLevel = mip,
-					.baseArrayLayer = 0,
-					.layerCount = 1
-				},
-				.dstOffsets = { 
-					{ 0, 0, 0 }, 
-					{ nwd, nht, 1 } }
-			};
-
-			vkCmdBlitImage(
-				cmd_buf, 
-				tex_images[i], VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, 
-				tex_images[i], VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 
-				1, &region, 
-				VK_FILTER_LINEAR);
-
-			subresource_range.baseMipLevel = mip - 1;
+				vkCmdBlitImage(
+					cmd_buf, 
+					tex_images[i], VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, 
+					tex_images[i], VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 
+					1, &region, 
+					VK_FILTER_LINEAR);
+
+				subresource_range.baseMipLevel = mip - 1;
+
+				IMAGE_BARRIER(cmd_buf,
+					.image = tex_images[i],
+					.subresourceRange = subresource_range,
+					.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT,
+					.dstAccessMask = VK_ACCESS_SHADER_READ_BIT,
+					.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+					.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+					);
+
+				wd = nwd;
+				ht = nht;
+			}
+
+			subresource_range.baseMipLevel = num_mip_levels - 1;
 
 			IMAGE_BARRIER(cmd_buf,
 				.image = tex_images[i],
 				.subresourceRange = subresource_range,
 				.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT,
 				.dstAccessMask = VK_ACCESS_SHADER_READ_BIT,
-				.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+				.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
 				.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
 				);
-
-			wd = nwd;
-			ht = nht;
 		}
 
-		subresource_range.baseMipLevel = num_mip_levels - 1;
-
-		IMAGE_BARRIER(cmd_buf,
-			.image = tex_images[i],
-			.subresourceRange = subresource_range,
-			.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT,
-			.dstAccessMask = VK_ACCESS_SHADER_READ_BIT,
-			.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-			.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-			);
-
 		img_view_info.image = tex_images[i];
 		img_view_info.subresourceRange.levelCount = num_mip_levels;
-		img_view_info.format = q_img->is_srgb ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM;
+		img_view_info.format = get_image_format(q_img);
 		_VK(vkCreateImageView(qvk.device, &img_view_info, NULL, tex_image_views + i));
 		ATTACH_LABEL_VARIABLE(tex_image_views[i], IMAGE_VIEW);
 
-		offset += mem_req.size;
+		offset += get_staging_size(q_img, &mem_req);
 	}
 
 	buffer_unmap(&buf_img_upload);
@@ -466,10 +466,11 @@ vkpt_vertex_buffer_upload_models_to_staging()
 			fclose(f);
 #endif
 
-			memcpy(vbo->positions_model + vertex_offset * 3, m->positions, sizeof(float) * 3 * num_verts);
-			memcpy(vbo->normals_model + vertex_offset * 3, m->normals, sizeof(float) * 3 * num_verts);
-			memcpy(vbo->tex_coords_model + vertex_offset * 2, m->tex_coords, sizeof(float) * 2 * num_verts);
-            memcpy(vbo->tangents_model + vertex_offset * 4, m->tangents, sizeof(float) * 4 * num_verts);
+			MOD_UnpackAliasMesh_RTX(&r_models[i], m,
+				vbo->positions_model + vertex_offset * 3,
+				vbo->normals_model + vertex_offset * 3,
+				vbo->tex_coords_model + vertex_offset * 2,
+				vbo->tangents_model + vertex_offset * 4);
 			memcpy(vbo->idx_model + idx_offset, m->indices, sizeof(uint32_t) * m->numindices);
 
 			vertex_offset += num_verts;
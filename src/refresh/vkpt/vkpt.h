@@ -162,6 +162,7 @@ typedef struct QVK_s {
 	VkInstance                  instance;
 	VkPhysicalDevice            physical_device;
 	VkPhysicalDeviceMemoryProperties mem_properties;
+	qboolean                    supports_bc; // cooked BCn textures can be uploaded as is
 
 	// number of GPUs we're rendering to --- if DG is disabled, this is 1
 	int							device_count;
@@ -689,6 +690,21 @@ typedef struct maliasframe_s {
     vec_t   radius;
 } maliasframe_t;
 
+// resident alias model vertex, one per vertex and frame
+typedef struct {
+    uint16_t        pos[3];     // quantized within the frame, see maliasquant_t
+    uint16_t        flags;      // MAV_MIRRORED
+    uint32_t        normal;     // octahedral, see encode_normal()
+    uint32_t        tangent;
+} maliasvert_t;
+
+#define MAV_MIRRORED    1       // tangent handedness is negative
+
+typedef struct {
+    vec3_t          offset;
+    vec3_t          scale;      // position = offset + pos * scale
+} maliasquant_t;
+
 typedef struct maliasmesh_s {
     int             numverts;
     int             numtris;
@@ -696,6 +712,10 @@ typedef struct maliasmesh_s {
     int             idx_offset;    /* offset in vertex buffer on device */
     int             vertex_offset; /* offset in vertex buffer on device */
     int             *indices;
+    maliasvert_t    *verts;        /* numverts * numframes */
+    maliasquant_t   *quant;        /* numframes */
+    vec2_t          *st;           /* numverts, same in every frame */
+    /* full precision frames, only valid while loading */
     vec3_t          *positions;
     vec3_t          *normals;
     vec2_t          *tex_coords;
@@ -765,6 +785,11 @@ byte *IMG_ReadPixels_RTX(int *width, int *height, int *rowbytes);
 qerror_t MOD_LoadMD2_RTX(model_t *model, const void *rawdata, size_t length);
 qerror_t MOD_LoadMD3_RTX(model_t *model, const void *rawdata, size_t length);
 void MOD_Reference_RTX(model_t *model);
+void MOD_UnpackAliasMesh_RTX(const model_t *model, const maliasmesh_t *mesh,
+	float *positions, float *normals, float *tex_coords, float *tangents);
+
+uint32_t encode_normal(const vec3_t normal);
+void decode_normal(uint32_t enc, vec3_t normal);
 
 #endif  /*__VKPT_H__*/
 
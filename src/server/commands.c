@@ -1499,6 +1499,206 @@ static void SV_ListFilterCmds_f(void)
     }
 }
 
+/*
+==================
+SV_GameBench_f
+
+Runs the game module for a number of frames as fast as possible and
+reports how long each frame took. Optional bots are connected straight
+to the game (they have no client_t) and driven by a fixed usercmd
+script, so results are reproducible on a dedicated server without any
+network clients.
+==================
+*/
+#define GAMEBENCH_MAX_BOTS  8
+
+static int gamebench_cmp(const void *p1, const void *p2)
+{
+    uint64_t a = *(const uint64_t *)p1;
+    uint64_t b = *(const uint64_t *)p2;
+
+    return a < b ? -1 : a > b;
+}
+
+static void SV_GameBench_f(void)
+{
+    edict_t     *bots[GAMEBENCH_MAX_BOTS];
+    char        userinfo[MAX_INFO_STRING];
+    usercmd_t   cmd;
+    uint64_t    *times, start, total;
+    unsigned    traces, maxtraces, allocs;
+    int         i, j, frames, numbots;
+
+    if (sv.state != ss_game) {
+        Com_Printf("No game running.\n");
+        return;
+    }
+
+    if (Cmd_Argc() < 2) {
+        Com_Printf("Usage: %s <frames> [bots]\n", Cmd_Argv(0));
+        return;
+    }
+
+    frames = atoi(Cmd_Argv(1));
+    if (frames < 1) {
+        Com_Printf("Bad number of frames.\n");
+        return;
+    }
+
+    // bots take free client slots only
+    numbots = 0;
+    for (i = atoi(Cmd_Argv(2)), j = 0; i > 0 && j < sv_maxclients->integer; j++) {
+        if (svs.client_pool[j].state != cs_free || EDICT_NUM(j + 1)->inuse) {
+            continue;
+        }
+        if (numbots == GAMEBENCH_MAX_BOTS) {
+            break;
+        }
+        Q_snprintf(userinfo, sizeof(userinfo),
+                   "\\name\\bot%d\\skin\\male/grunt\\hand\\2\\ip\\loopback", numbots);
+        if (!ge->ClientConnect(EDICT_NUM(j + 1), userinfo)) {
+            Com_Printf("Game rejected bot %d.\n", numbots);
+            break;
+        }
+        ge->ClientBegin(EDICT_NUM(j + 1));
+        bots[numbots++] = EDICT_NUM(j + 1);
+        i--;
+    }
+
+    times = Z_Malloc(sizeof(*times) * frames);
+    total = 0;
+    maxtraces = 0;
+    traces = 0;
+    sv.alloccount = 0;
+
+    X86_PUSH_FPCW;
+    X86_SINGLE_FPCW;
+
+    for (i = 0; i < frames; i++) {
+        start = Sys_Microseconds();
+        sv.tracecount = 0;
+
+        // run forward while turning, fire every second
+        for (j = 0; j < numbots; j++) {
+            memset(&cmd, 0, sizeof(cmd));
+            cmd.msec = BASE_FRAMETIME;
+            cmd.forwardmove = 200;
+            cmd.angles[YAW] = ANGLE2SHORT((i * (j + 1) * 3) % 360);
+            if (i % BASE_FRAMERATE == 0) {
+                cmd.buttons = BUTTON_ATTACK;
+            }
+            ge->ClientThink(bots[j], &cmd);
+        }
+
+        ge->RunFrame();
+        SZ_Clear(&msg_write);
+
+        times[i] = Sys_Microseconds() - start;
+        total += times[i];
+        traces += sv.tracecount;
+        maxtraces = max(maxtraces, sv.tracecount);
+    }
+
+    X86_POP_FPCW;
+
+    allocs = sv.alloccount;
+    for (j = 0; j < numbots; j++) {
+        ge->ClientDisconnect(bots[j]);
+    }
+    SZ_Clear(&msg_write);
+
+    qsort(times, frames, sizeof(*times), gamebench_cmp);
+
+    Com_Printf("%d frames, %d bots, %.3f ms total\n", frames, numbots, total * 1e-3);
+    Com_Printf("frame time: avg %.3f, min %.3f, median %.3f, 99%% %.3f, max %.3f ms\n",
+               total * 1e-3 / frames, times[0] * 1e-3, times[frames / 2] * 1e-3,
+               times[frames * 99 / 100] * 1e-3, times[frames - 1] * 1e-3);
+    Com_Printf("traces: avg %.1f, max %u per frame\n", (float)traces / frames, maxtraces);
+    Com_Printf("allocations: %u total, %.1f per frame\n", allocs, (float)allocs / frames);
+
+    Z_Free(times);
+}
+
+/*
+==================
+SV_TraceBench_f
+
+Runs random world traces (half of them points, half player boxes) once
+serially with CM_BoxTrace and once with CM_BoxTraceBatch, checks that the
+results match and reports traces per second for both.
+==================
+*/
+static void SV_TraceBench_f(void)
+{
+    static const vec3_t boxmins = { -16, -16, -24 };
+    static const vec3_t boxmaxs = { 16, 16, 32 };
+    mmodel_t    *world;
+    mnode_t     *headnode;
+    cmtrace_t   *traces, *t;
+    trace_t     tr;
+    uint64_t    start, serial, batched;
+    int         i, j, count, numthreads, mismatches;
+
+    if (!sv.cm.cache || !sv.cm.cache->nummodels) {
+        Com_Printf("No map loaded.\n");
+        return;
+    }
+
+    count = Cmd_Argc() > 1 ? atoi(Cmd_Argv(1)) : 100000;
+    clamp(count, 1, 10000000);
+    numthreads = atoi(Cmd_Argv(2));
+
+    world = &sv.cm.cache->models[0];
+    headnode = world->headnode;
+
+    traces = Z_Malloc(sizeof(*traces) * count);
+    srand(count);
+    for (i = 0, t = traces; i < count; i++, t++) {
+        for (j = 0; j < 3; j++) {
+            t->start[j] = world->mins[j] + frand() * (world->maxs[j] - world->mins[j]);
+            t->end[j] = world->mins[j] + frand() * (world->maxs[j] - world->mins[j]);
+        }
+        if (i & 1) {
+            VectorCopy(boxmins, t->mins);
+            VectorCopy(boxmaxs, t->maxs);
+            t->brushmask = MASK_PLAYERSOLID;
+        } else {
+            VectorClear(t->mins);
+            VectorClear(t->maxs);
+            t->brushmask = MASK_SHOT;
+        }
+    }
+
+    X86_PUSH_FPCW;
+    X86_SINGLE_FPCW;
+
+    start = Sys_Microseconds();
+    CM_BoxTraceBatch(&sv.cm, traces, count, headnode, numthreads);
+    batched = Sys_Microseconds() - start;
+
+    mismatches = 0;
+    start = Sys_Microseconds();
+    for (i = 0, t = traces; i < count; i++, t++) {
+        CM_BoxTrace(&tr, t->start, t->end, t->mins, t->maxs, headnode, t->brushmask);
+        if (tr.fraction != t->trace.fraction || tr.startsolid != t->trace.startsolid ||
+            tr.allsolid != t->trace.allsolid || tr.plane.dist != t->trace.plane.dist) {
+            mismatches++;
+        }
+    }
+    serial = Sys_Microseconds() - start;
+
+    X86_POP_FPCW;
+
+    Z_Free(traces);
+
+    Com_Printf("%d traces, %d mismatches\n", count, mismatches);
+    Com_Printf("serial:  %.1f ms, %.0f traces/sec\n", serial * 1e-3,
+               serial ? count * 1e6 / serial : 0);
+    Com_Printf("batched: %.1f ms, %.0f traces/sec (%.2fx)\n", batched * 1e-3,
+               batched ? count * 1e6 / batched : 0,
+               batched ? (double)serial / batched : 0);
+}
+
 #if USE_MVD_CLIENT || USE_MVD_SERVER
 
 const cmd_option_t o_record[] = {
@@ -1559,6 +1759,8 @@ static const cmdreg_t c_server[] = {
     { "demomap", SV_DemoMap_f },
     { "gamemap", SV_GameMap_f, SV_Map_c },
     { "dumpents", SV_DumpEnts_f },
+    { "gamebench", SV_GameBench_f },
+    { "tracebench", SV_TraceBench_f },
     { "setmaster", SV_SetMaster_f },
     { "listmasters", SV_ListMasters_f },
     { "killserver", SV_KillServer_f },
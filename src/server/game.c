@@ -424,10 +424,53 @@ static void PF_WriteFloat(float f)
     Com_Error(ERR_DROP, "PF_WriteFloat not implemented");
 }
 
+/*
+=================
+PF_ClusterVis
+
+Monsters ask the same few clusters for PVS/PHS many times each frame,
+so decompressed rows are kept in a small direct mapped cache. Rows
+never change while a map is loaded.
+=================
+*/
+#define VIS_CACHE_SIZE  16
+
+typedef struct {
+    bsp_t       *bsp;
+    unsigned    checksum;
+    int         cluster;
+    int         vis;
+    byte        mask[VIS_MAX_BYTES];
+} viscache_t;
+
+static viscache_t   sv_viscache[VIS_CACHE_SIZE];
+
+static const byte *PF_ClusterVis(bsp_t *bsp, int cluster, int vis)
+{
+    viscache_t *c;
+    const char *row;
+
+    if (vis == DVIS_PVS && (row = BSP_GetPvs(bsp, cluster)) != NULL) {
+        return (const byte *)row;
+    }
+
+    c = &sv_viscache[(cluster ^ (vis << 3)) & (VIS_CACHE_SIZE - 1)];
+    if (c->bsp != bsp || c->checksum != bsp->checksum ||
+        c->cluster != cluster || c->vis != vis) {
+        BSP_ClusterVis(bsp, c->mask, cluster, vis);
+        c->bsp = bsp;
+        c->checksum = bsp->checksum;
+        c->cluster = cluster;
+        c->vis = vis;
+    }
+
+    return c->mask;
+}
+
 static qboolean PF_inVIS(vec3_t p1, vec3_t p2, int vis)
 {
     mleaf_t *leaf1, *leaf2;
-    byte mask[VIS_MAX_BYTES];
+    const byte *mask;
     bsp_t *bsp = sv.cm.cache;
 
     if (!bsp) {
@@ -435,13 +478,17 @@ static qboolean PF_inVIS(vec3_t p1, vec3_t p2, int vis)
     }
 
     leaf1 = BSP_PointLeaf(bsp->nodes, p1);
-    BSP_ClusterVis(bsp, mask, leaf1->cluster, vis);
-
     leaf2 = BSP_PointLeaf(bsp->nodes, p2);
     if (leaf2->cluster == -1)
         return qfalse;
-    if (!Q_IsBitSet(mask, leaf2->cluster))
+    if (leaf1->cluster == -1)
         return qfalse;
+
+    if (bsp->vis) {
+        mask = PF_ClusterVis(bsp, leaf1->cluster, vis);
+        if (!Q_IsBitSet(mask, leaf2->cluster))
+            return qfalse;
+    }
     if (!CM_AreasConnected(&sv.cm, leaf1->area, leaf2->area))
         return qfalse;        // a door blocks it
     return qtrue;
@@ -753,6 +800,7 @@ static void *PF_TagMalloc(size_t size, unsigned tag)
     if (!size) {
         return NULL;
     }
+    sv.alloccount++;
     return memset(Z_TagMalloc(size, tag + TAG_MAX), 0, size);
 }
 
@@ -77,6 +77,7 @@ typedef struct gtv_s {
     int             demoloop, demoskip;
     string_entry_t  *demohead, *demoentry;
     size_t          demosize, demopos;
+    size_t          demobase;   // offset of first frame, 0 if not indexable
     qboolean        demowait;
 } gtv_t;
 
@@ -138,12 +139,9 @@ void MVD_StopRecord(mvd_t *mvd)
 
 static void MVD_Free(mvd_t *mvd)
 {
-    mvd_snap_t *snap, *next;
     int i;
 
-    LIST_FOR_EACH_SAFE(mvd_snap_t, snap, next, &mvd->snapshots, entry) {
-        Z_Free(snap);
-    }
+    DEMO_FreeSnapshots(&mvd->snapshots);
 
     // stop demo recording
     if (mvd->demorecording) {
@@ -562,7 +560,7 @@ static ssize_t demo_read_first(qhandle_t f)
 // state, configstrings and layouts at the given server frame.
 static void demo_emit_snapshot(mvd_t *mvd)
 {
-    mvd_snap_t *snap;
+    demosnap_t *snap;
     gtv_t *gtv;
     off_t pos;
     char *from, *to;
@@ -624,16 +622,16 @@ static void demo_emit_snapshot(mvd_t *mvd)
     mvd->last_snapshot = mvd->framenum;
 }
 
-static mvd_snap_t *demo_find_snapshot(mvd_t *mvd, int framenum)
+static demosnap_t *demo_find_snapshot(mvd_t *mvd, int framenum)
 {
-    mvd_snap_t *snap, *prev;
+    demosnap_t *snap, *prev;
 
     if (LIST_EMPTY(&mvd->snapshots))
         return NULL;
 
-    prev = LIST_FIRST(mvd_snap_t, &mvd->snapshots, entry);
+    prev = LIST_FIRST(demosnap_t, &mvd->snapshots, entry);
 
-    LIST_FOR_EACH(mvd_snap_t, snap, &mvd->snapshots, entry) {
+    LIST_FOR_EACH(demosnap_t, snap, &mvd->snapshots, entry) {
         if (snap->framenum > framenum)
             break;
         prev = snap;
@@ -642,6 +640,61 @@ static mvd_snap_t *demo_find_snapshot(mvd_t *mvd, int framenum)
     return prev;
 }
 
+/*
+Snapshots of the first map in a demo file can be saved to a sidecar index,
+so that seeking doesn't need to parse everything in between. The format
+is shared with client demo indexes.
+*/
+
+static qboolean demo_index_name(gtv_t *gtv, char *buffer, size_t size)
+{
+    return gtv->demoentry && gtv->demobase &&
+        Q_concat(buffer, size, gtv->demoentry->string, ".idx", NULL) < size;
+}
+
+static void demo_load_index(gtv_t *gtv)
+{
+    char buffer[MAX_OSPATH];
+    mvd_t *mvd = gtv->mvd;
+    int ret;
+
+    if (!demo_index_name(gtv, buffer, sizeof(buffer)))
+        return;
+
+    ret = DEMO_LoadIndex(buffer, &mvd->snapshots, TAG_MVD,
+                         gtv->demosize, gtv->demobase);
+    if (ret == Q_ERR_NOENT)
+        return;
+
+    if (ret < 0) {
+        mvd->last_snapshot = INT_MIN;
+        Com_WPrintf("[%s] Ignoring invalid demo index %s: %s\n",
+                    mvd->name, buffer, Q_ErrorString(ret));
+        return;
+    }
+
+    if (ret)
+        mvd->last_snapshot = LIST_LAST(demosnap_t, &mvd->snapshots, entry)->framenum;
+    Com_DPrintf("Loaded %d snaps from %s\n", ret, buffer);
+}
+
+static void demo_write_index(gtv_t *gtv)
+{
+    char buffer[MAX_OSPATH];
+    mvd_t *mvd = gtv->mvd;
+    int ret;
+
+    if (!demo_index_name(gtv, buffer, sizeof(buffer)))
+        return;
+
+    ret = DEMO_WriteIndex(buffer, &mvd->snapshots,
+                          gtv->demosize, gtv->demobase);
+    if (ret < 0)
+        Com_EPrintf("[%s] Couldn't write %s: %s\n", mvd->name, buffer, Q_ErrorString(ret));
+    else
+        Com_Printf("[%s] Wrote %d snapshots to %s\n", mvd->name, ret, buffer);
+}
+
 static void demo_update(gtv_t *gtv)
 {
     if (gtv->demosize) {
@@ -697,7 +750,10 @@ static qboolean demo_read_frame(mvd_t *mvd)
 
     demo_update(gtv);
 
-    MVD_ParseMessage(mvd);
+    if (MVD_ParseMessage(mvd)) {
+        // new map doesn't start at the indexed offset
+        gtv->demobase = 0;
+    }
     demo_emit_snapshot(mvd);
     return qtrue;
 
@@ -765,11 +821,15 @@ static void demo_play_next(gtv_t *gtv, string_entry_t *entry)
     ret = FS_Tell(gtv->demoplayback);
     if (len > 0 && ret > 0) {
         gtv->demosize = len;
-        gtv->demopos = ret;
+        gtv->demopos = gtv->demobase = ret;
     } else {
-        gtv->demosize = gtv->demopos = 0;
+        gtv->demosize = gtv->demopos = gtv->demobase = 0;
     }
 
+    // pick up snapshots saved by mvdindex
+    if (LIST_EMPTY(&gtv->mvd->snapshots))
+        demo_load_index(gtv);
+
     demo_emit_snapshot(gtv->mvd);
 }
 
@@ -2155,15 +2215,14 @@ static void MVD_Skip_f(void)
     mvd->gtv->demoskip = count;
 }
 
+static qboolean demo_seek(mvd_t *mvd, int dest, qboolean stop_at_eof);
+
 static void MVD_Seek_f(void)
 {
     mvd_t *mvd;
     gtv_t *gtv;
-    mvd_snap_t *snap;
-    int i, j, ret, index, frames, dest;
-    char *from, *to;
-    edict_t *ent;
-    qboolean gamestate;
+    int frames, dest;
+    char *to;
 
     if (Cmd_Argc() < 2) {
         Com_Printf("Usage: %s [+-]<timespec> [chanid]\n", Cmd_Argv(0));
@@ -2204,15 +2263,71 @@ static void MVD_Seek_f(void)
             Com_Printf("Invalid absolute timespec.\n");
             return;
         }
-        frames = dest - mvd->framenum;
     }
 
+    demo_seek(mvd, dest, qfalse);
+}
+
+static void MVD_Index_f(void)
+{
+    mvd_t *mvd;
+    gtv_t *gtv;
+    unsigned start;
+    int framenum, total;
+
+    mvd = MVD_SetChannel(1);
+    if (!mvd) {
+        return;
+    }
+
+    gtv = mvd->gtv;
+    if (!gtv || !gtv->demoplayback) {
+        Com_Printf("[%s] Indexing is only supported on demo channels.\n", mvd->name);
+        return;
+    }
+
+    if (mvd->demorecording) {
+        Com_Printf("[%s] Indexing is not supported during demo recording.\n", mvd->name);
+        return;
+    }
+
+    if (!gtv->demobase || mvd_snaps->integer <= 0) {
+        Com_Printf("[%s] Only the first map of a demo can be indexed.\n", mvd->name);
+        return;
+    }
+
+    start = Sys_Milliseconds();
+    framenum = mvd->framenum;
+
+    if (!demo_seek(mvd, INT_MAX, qtrue))
+        return;
+
+    total = mvd->framenum;
+    demo_write_index(gtv);
+    demo_seek(mvd, framenum, qfalse);
+
+    Com_Printf("[%s] Indexed %d frames in %u ms\n", mvd->name, total,
+               Sys_Milliseconds() - start);
+}
+
+// returns qfalse if the channel moved on to another demo or map
+static qboolean demo_seek(mvd_t *mvd, int dest, qboolean stop_at_eof)
+{
+    gtv_t *gtv = mvd->gtv;
+    demosnap_t *snap;
+    int i, j, ret, index, frames;
+    char *from, *to;
+    edict_t *ent;
+    qboolean gamestate;
+
+    frames = dest - mvd->framenum;
+
     if (!frames)
         // already there
-        return;
+        return qtrue;
 
     if (setjmp(mvd_jmpbuf))
-        return;
+        return qfalse;
 
     // disable effects processing
     mvd->demoseeking = qtrue;
@@ -2226,6 +2341,10 @@ static void MVD_Seek_f(void)
     if (frames < 0 || mvd->last_snapshot > mvd->framenum) {
         snap = demo_find_snapshot(mvd, dest);
 
+        // don't go back when seeking forward past the last snapshot
+        if (snap && frames > 0 && snap->framenum <= mvd->framenum)
+            snap = NULL;
+
         if (snap) {
             Com_DPrintf("found snap at %d\n", snap->framenum);
             ret = FS_Seek(gtv->demoplayback, snap->filepos);
@@ -2266,9 +2385,12 @@ static void MVD_Seek_f(void)
     // skip forward to destination frame
     while (mvd->framenum < dest) {
         ret = demo_read_message(gtv->demoplayback);
+        if (ret == 0 && stop_at_eof) {
+            break;
+        }
         if (ret <= 0) {
             demo_finish(gtv, ret);
-            return;
+            return qfalse;
         }
 
         gamestate = MVD_ParseMessage(mvd);
@@ -2278,7 +2400,9 @@ static void MVD_Seek_f(void)
         if (gamestate) {
             // got a gamestate, abort seek
             Com_DPrintf("got gamestate while seeking!\n");
-            goto done;
+            gtv->demobase = 0;
+            mvd->demoseeking = qfalse;
+            return qfalse;
         }
     }
 
@@ -2330,6 +2454,7 @@ static void MVD_Seek_f(void)
 
 done:
     mvd->demoseeking = qfalse;
+    return qtrue;
 }
 
 static void MVD_Control_f(void)
@@ -2569,6 +2694,7 @@ static const cmdreg_t c_mvd[] = {
     { "mvdpause", MVD_Pause_f },
     { "mvdskip", MVD_Skip_f },
     { "mvdseek", MVD_Seek_f },
+    { "mvdindex", MVD_Index_f },
 
     { NULL }
 };
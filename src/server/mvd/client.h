@@ -17,6 +17,7 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 */
 
 #include "../server.h"
+#include "common/demoindex.h"
 #include <setjmp.h>
 
 #define MVD_Malloc(size)    Z_TagMalloc(size, TAG_MVD)
@@ -112,14 +113,6 @@ typedef enum {
     MVD_NUM_STATES
 } mvd_state_t;
 
-typedef struct {
-    list_t entry;
-    int framenum;
-    off_t filepos;
-    size_t msglen;
-    byte data[1];
-} mvd_snap_t;
-
 struct gtv_s;
 
 // FIXME: entire struct is > 500 kB in size!
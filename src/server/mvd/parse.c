@@ -856,7 +856,6 @@ static void MVD_ParseFrame(mvd_t *mvd)
 void MVD_ClearState(mvd_t *mvd, qboolean full)
 {
     mvd_player_t *player;
-    mvd_snap_t *snap, *next;
     int i;
 
     // clear all entities, don't trust num_edicts as it is possible
@@ -877,11 +876,7 @@ void MVD_ClearState(mvd_t *mvd, qboolean full)
         return;
 
     // free all snapshots
-    LIST_FOR_EACH_SAFE(mvd_snap_t, snap, next, &mvd->snapshots, entry) {
-        Z_Free(snap);
-    }
-
-    List_Init(&mvd->snapshots);
+    DEMO_FreeSnapshots(&mvd->snapshots);
 
     // free current map
     CM_FreeMap(&mvd->cm);
@@ -166,6 +166,7 @@ typedef struct {
     server_entity_t entities[MAX_EDICTS];
 
     unsigned    tracecount;
+    unsigned    alloccount;     // game allocations, for gamebench
 } server_t;
 
 #define EDICT_POOL(c, n) ((edict_t *)((byte *)(c)->pool->edicts + (c)->pool->edict_size*(n)))
@@ -76,6 +76,14 @@ unsigned Sys_Milliseconds(void)
     return time;
 }
 
+uint64_t Sys_Microseconds(void)
+{
+    struct timeval tp;
+
+    gettimeofday(&tp, NULL);
+    return (uint64_t)tp.tv_sec * 1000000 + tp.tv_usec;
+}
+
 /*
 =================
 Sys_Quit
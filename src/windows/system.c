@@ -646,6 +646,19 @@ unsigned Sys_Milliseconds(void)
     return timeGetTime();
 }
 
+uint64_t Sys_Microseconds(void)
+{
+    static LARGE_INTEGER freq;
+    LARGE_INTEGER count;
+
+    if (!freq.QuadPart) {
+        QueryPerformanceFrequency(&freq);
+    }
+    QueryPerformanceCounter(&count);
+    return count.QuadPart / freq.QuadPart * 1000000 +
+           count.QuadPart % freq.QuadPart * 1000000 / freq.QuadPart;
+}
+
 void Sys_AddDefaultConfig(void)
 {
 }